@@ -0,0 +1,194 @@
+#include "batch.hpp"
+#include "definitions.h"
+#include "scheme.hpp"
+#include "utility.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	template <typename VALUE_T>
+	class BatchBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const VALUE_T beta	 = 1.0 * (1 << 10);
+		const int dimensions = 100;
+		const int rows		 = 1 << 12;
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			srand(TEST_SEED);
+
+			scheme = std::make_unique<Scheme<VALUE_T>>(beta);
+			key	   = scheme->keygen();
+
+			messages.resize(rows * dimensions);
+			for (auto &&value : messages)
+			{
+				value = static_cast<VALUE_T>(rand()) / static_cast<double>(RAND_MAX);
+			}
+
+			// the way callers keep ciphertexts without a batch: a vector per record, allocated one by one
+			scattered.clear();
+			scattered_nonces.clear();
+			for (auto i = 0; i < rows; i++)
+			{
+				scattered.emplace_back(dimensions);
+				scattered_nonces.push_back(scheme->encrypt(key, TO_ARRAY(messages) + i * dimensions, dimensions, TO_ARRAY(scattered.back())));
+			}
+
+			batch = std::make_unique<CiphertextBatch<VALUE_T>>(rows, dimensions);
+			encrypt_batch(*scheme, key, TO_ARRAY(messages), batch->view());
+
+			query	  = scattered[0];
+			distances.resize(rows);
+		}
+
+		protected:
+		std::unique_ptr<Scheme<VALUE_T>> scheme;
+		DCPE::key<VALUE_T> key;
+		std::vector<VALUE_T> messages;
+
+		std::vector<std::vector<VALUE_T>> scattered;
+		std::vector<std::pair<ull, ull>> scattered_nonces;
+		std::unique_ptr<CiphertextBatch<VALUE_T>> batch;
+
+		std::vector<VALUE_T> query;
+		std::vector<VALUE_T> distances;
+	};
+
+#define B_EncryptScattered(type)                                                                                                       \
+	BENCHMARK_TEMPLATE_DEFINE_F(BatchBenchmark, EncryptScattered_##type, type)                                                         \
+	(benchmark::State & state)                                                                                                         \
+	{                                                                                                                                  \
+		for (auto _ : state)                                                                                                           \
+		{                                                                                                                              \
+			std::vector<std::vector<type>> ciphertexts;                                                                                \
+			std::vector<std::pair<ull, ull>> nonces;                                                                                   \
+			for (auto i = 0; i < rows; i++)                                                                                            \
+			{                                                                                                                          \
+				ciphertexts.emplace_back(dimensions);                                                                                  \
+				nonces.push_back(scheme->encrypt(key, TO_ARRAY(messages) + i * dimensions, dimensions, TO_ARRAY(ciphertexts.back()))); \
+			}                                                                                                                          \
+			benchmark::DoNotOptimize(ciphertexts);                                                                                     \
+		}                                                                                                                              \
+		state.SetItemsProcessed(state.iterations() * rows);                                                                            \
+	}
+
+	B_EncryptScattered(float);
+	B_EncryptScattered(double);
+
+	// the argument is the number of threads
+#define B_EncryptBatch(type)                                                             \
+	BENCHMARK_TEMPLATE_DEFINE_F(BatchBenchmark, EncryptBatch_##type, type)               \
+	(benchmark::State & state)                                                           \
+	{                                                                                    \
+		for (auto _ : state)                                                             \
+		{                                                                                \
+			CiphertextBatch<type> out(rows, dimensions);                                 \
+			encrypt_batch(*scheme, key, TO_ARRAY(messages), out.view(), state.range(0)); \
+			benchmark::DoNotOptimize(out.row(0));                                        \
+		}                                                                                \
+		state.SetItemsProcessed(state.iterations() * rows);                              \
+	}
+
+	B_EncryptBatch(float);
+	B_EncryptBatch(double);
+
+#define B_ScanScattered(type)                                                                         \
+	BENCHMARK_TEMPLATE_DEFINE_F(BatchBenchmark, ScanScattered_##type, type)                           \
+	(benchmark::State & state)                                                                        \
+	{                                                                                                 \
+		for (auto _ : state)                                                                          \
+		{                                                                                             \
+			for (auto i = 0; i < rows; i++)                                                           \
+			{                                                                                         \
+				distances[i] = squared_distance(TO_ARRAY(scattered[i]), TO_ARRAY(query), dimensions); \
+			}                                                                                         \
+			benchmark::DoNotOptimize(distances.data());                                               \
+		}                                                                                             \
+		state.SetItemsProcessed(state.iterations() * rows);                                           \
+	}
+
+	B_ScanScattered(float);
+	B_ScanScattered(double);
+
+#define B_ScanBatch(type)                                                           \
+	BENCHMARK_TEMPLATE_DEFINE_F(BatchBenchmark, ScanBatch_##type, type)             \
+	(benchmark::State & state)                                                      \
+	{                                                                               \
+		for (auto _ : state)                                                        \
+		{                                                                           \
+			squared_distances(batch->view(), TO_ARRAY(query), TO_ARRAY(distances)); \
+			benchmark::DoNotOptimize(distances.data());                             \
+		}                                                                           \
+		state.SetItemsProcessed(state.iterations() * rows);                         \
+	}
+
+	B_ScanBatch(float);
+	B_ScanBatch(double);
+
+#define B_Serialize(type)                                                                                               \
+	BENCHMARK_TEMPLATE_DEFINE_F(BatchBenchmark, Serialize_##type, type)                                                 \
+	(benchmark::State & state)                                                                                          \
+	{                                                                                                                   \
+		for (auto _ : state)                                                                                            \
+		{                                                                                                               \
+			auto serialized = batch->view().serialize();                                                                \
+			auto restored	= CiphertextBatch<type>::deserialize(serialized);                                           \
+			benchmark::DoNotOptimize(restored.row(0));                                                                  \
+		}                                                                                                               \
+		state.SetBytesProcessed(state.iterations() * rows * (dimensions * sizeof(type) + sizeof(std::pair<ull, ull>))); \
+	}
+
+	B_Serialize(float);
+	B_Serialize(double);
+
+#define R_EncryptScattered(type)                                  \
+	BENCHMARK_REGISTER_F(BatchBenchmark, EncryptScattered_##type) \
+		->Iterations(1 << 2)                                      \
+		->Unit(benchmark::kMillisecond);
+
+	R_EncryptScattered(float);
+	R_EncryptScattered(double);
+
+#define R_EncryptBatch(type)                                  \
+	BENCHMARK_REGISTER_F(BatchBenchmark, EncryptBatch_##type) \
+		->Arg(1)                                              \
+		->Arg(0)                                              \
+		->Iterations(1 << 2)                                  \
+		->Unit(benchmark::kMillisecond)                       \
+		->UseRealTime();
+
+	R_EncryptBatch(float);
+	R_EncryptBatch(double);
+
+#define R_ScanScattered(type)                                  \
+	BENCHMARK_REGISTER_F(BatchBenchmark, ScanScattered_##type) \
+		->Iterations(1 << 8)                                   \
+		->Unit(benchmark::kMicrosecond);
+
+	R_ScanScattered(float);
+	R_ScanScattered(double);
+
+#define R_ScanBatch(type)                                  \
+	BENCHMARK_REGISTER_F(BatchBenchmark, ScanBatch_##type) \
+		->Iterations(1 << 8)                               \
+		->Unit(benchmark::kMicrosecond);
+
+	R_ScanBatch(float);
+	R_ScanBatch(double);
+
+#define R_Serialize(type)                                  \
+	BENCHMARK_REGISTER_F(BatchBenchmark, Serialize_##type) \
+		->Iterations(1 << 6)                               \
+		->Unit(benchmark::kMicrosecond);
+
+	R_Serialize(float);
+	R_Serialize(double);
+
+}
+BENCHMARK_MAIN();
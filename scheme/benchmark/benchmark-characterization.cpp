@@ -0,0 +1,87 @@
+#include "characterization.hpp"
+#include "definitions.h"
+
+#include <benchmark/benchmark.h>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	template <typename VALUE_T>
+	class CharacterizationBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		void SetUp(const ::benchmark::State& state)
+		{
+			srand(TEST_SEED);
+
+			CharacterizationConfig config;
+			config.dimensions = state.range(0);
+			config.records	  = 1000;
+			config.queries	  = 20;
+			config.k		  = 10;
+
+			characterization = std::make_unique<Characterization<VALUE_T>>(config);
+		}
+
+		protected:
+		std::unique_ptr<Characterization<VALUE_T>> characterization;
+	};
+
+#define B_Measure(type)                                                            \
+	BENCHMARK_TEMPLATE_DEFINE_F(CharacterizationBenchmark, Measure_##type, type)   \
+	(benchmark::State & state)                                                     \
+	{                                                                              \
+		CharacterizationResult result;                                             \
+		for (auto _ : state)                                                       \
+		{                                                                          \
+			result = characterization->measure(1 << 4, 1000.0);                    \
+		}                                                                          \
+		state.counters["recall"]	 = result.recall;                              \
+		state.counters["mean_error"] = result.mean_error;                          \
+	}
+
+	B_Measure(float);
+	B_Measure(double);
+
+#define B_Sweep(type)                                                                    \
+	BENCHMARK_TEMPLATE_DEFINE_F(CharacterizationBenchmark, Sweep_##type, type)           \
+	(benchmark::State & state)                                                           \
+	{                                                                                    \
+		std::vector<type> betas = {1.0, 16.0, 256.0};                                    \
+		std::vector<type> max_s = {10.0, 1000.0};                                        \
+		auto threads			= state.range(1);                                        \
+		for (auto _ : state)                                                             \
+		{                                                                                \
+			benchmark::DoNotOptimize(characterization->sweep(betas, max_s, threads));    \
+		}                                                                                \
+	}
+
+	B_Sweep(float);
+	B_Sweep(double);
+
+#define R_Measure(type)                                             \
+	BENCHMARK_REGISTER_F(CharacterizationBenchmark, Measure_##type) \
+		->Args({32})                                                \
+		->Args({128})                                               \
+		->Iterations(1 << 3)                                        \
+		->Unit(benchmark::kMillisecond);
+
+	R_Measure(float);
+	R_Measure(double);
+
+#define R_Sweep(type)                                             \
+	BENCHMARK_REGISTER_F(CharacterizationBenchmark, Sweep_##type) \
+		->Args({32, 1})                                           \
+		->Args({32, 2})                                           \
+		->Args({32, 4})                                           \
+		->Iterations(1 << 2)                                      \
+		->Unit(benchmark::kMillisecond)                           \
+		->UseRealTime();
+
+	R_Sweep(float);
+	R_Sweep(double);
+
+}
+BENCHMARK_MAIN();
@@ -0,0 +1,182 @@
+#include "codec.hpp"
+#include "definitions.h"
+#include "scheme.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	template <typename VALUE_T>
+	class CodecBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const VALUE_T beta	 = 1.0 * (1 << 10);
+		const int dimensions = 128;
+		const int rows		 = 1 << 14;
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			srand(TEST_SEED);
+
+			Scheme<VALUE_T> scheme(beta);
+			auto key = scheme.keygen();
+
+			std::vector<VALUE_T> message;
+			message.resize(dimensions);
+			ciphertexts.resize(rows * dimensions);
+			nonces.resize(rows);
+			ids.resize(rows);
+			for (auto i = 0; i < rows; i++)
+			{
+				for (auto &&value : message)
+				{
+					value = static_cast<VALUE_T>(rand()) / static_cast<double>(RAND_MAX);
+				}
+				nonces[i] = scheme.encrypt(key, TO_ARRAY(message), dimensions, TO_ARRAY(ciphertexts) + i * dimensions);
+				ids[i]	  = i;
+			}
+
+			codec	= std::make_unique<ColumnarCodec<VALUE_T>>(dimensions);
+			archive = codec->encode(TO_ARRAY(ciphertexts), TO_ARRAY(nonces), TO_ARRAY(ids), rows);
+		}
+
+		protected:
+		std::vector<VALUE_T> ciphertexts;
+		std::vector<std::pair<ull, ull>> nonces;
+		std::vector<ull> ids;
+
+		std::unique_ptr<ColumnarCodec<VALUE_T>> codec;
+		bytes archive;
+
+		size_t raw_size()
+		{
+			return rows * (dimensions * sizeof(VALUE_T) + sizeof(std::pair<ull, ull>) + sizeof(ull));
+		}
+	};
+
+	// the argument is the number of threads (0 means all the scheduler's workers plus the caller)
+#define B_Encode(type)                                                                                                             \
+	BENCHMARK_TEMPLATE_DEFINE_F(CodecBenchmark, Encode_##type, type)                                                               \
+	(benchmark::State & state)                                                                                                     \
+	{                                                                                                                              \
+		for (auto _ : state)                                                                                                       \
+		{                                                                                                                          \
+			benchmark::DoNotOptimize(codec->encode(TO_ARRAY(ciphertexts), TO_ARRAY(nonces), TO_ARRAY(ids), rows, state.range(0))); \
+		}                                                                                                                          \
+		state.SetBytesProcessed(state.iterations() * raw_size());                                                                  \
+		state.counters["ratio"] = (double)raw_size() / archive.size();                                                             \
+	}
+
+	B_Encode(float);
+	B_Encode(double);
+
+	// bytes processed are those of the decoded records, so the rate is the decode throughput
+#define B_Decode(type)                                                                                                  \
+	BENCHMARK_TEMPLATE_DEFINE_F(CodecBenchmark, Decode_##type, type)                                                    \
+	(benchmark::State & state)                                                                                          \
+	{                                                                                                                   \
+		std::vector<type> decoded(rows * dimensions);                                                                   \
+		std::vector<std::pair<ull, ull>> decoded_nonces(rows);                                                          \
+		std::vector<ull> decoded_ids(rows);                                                                             \
+		for (auto _ : state)                                                                                            \
+		{                                                                                                               \
+			codec->decode(archive, TO_ARRAY(decoded), TO_ARRAY(decoded_nonces), TO_ARRAY(decoded_ids), state.range(0)); \
+			benchmark::DoNotOptimize(decoded.data());                                                                   \
+		}                                                                                                               \
+		state.SetBytesProcessed(state.iterations() * raw_size());                                                       \
+		state.counters["ratio"] = (double)raw_size() / archive.size();                                                  \
+	}
+
+	B_Decode(float);
+	B_Decode(double);
+
+	// the argument is the number of rows per block, so small values make archives of many small blocks
+	// (the header is read once per decode, so the time per byte should not grow with the number of blocks)
+#define B_DecodeBlocks(type)                                                                             \
+	BENCHMARK_TEMPLATE_DEFINE_F(CodecBenchmark, DecodeBlocks_##type, type)                               \
+	(benchmark::State & state)                                                                           \
+	{                                                                                                    \
+		ColumnarCodec<type> small(dimensions, state.range(0));                                           \
+		auto blocks = small.encode(TO_ARRAY(ciphertexts), TO_ARRAY(nonces), TO_ARRAY(ids), rows);        \
+		std::vector<type> decoded(rows * dimensions);                                                    \
+		std::vector<std::pair<ull, ull>> decoded_nonces(rows);                                           \
+		std::vector<ull> decoded_ids(rows);                                                              \
+		for (auto _ : state)                                                                             \
+		{                                                                                                \
+			small.decode(blocks, TO_ARRAY(decoded), TO_ARRAY(decoded_nonces), TO_ARRAY(decoded_ids), 1); \
+			benchmark::DoNotOptimize(decoded.data());                                                    \
+		}                                                                                                \
+		state.SetBytesProcessed(state.iterations() * raw_size());                                        \
+		state.counters["blocks"] = ColumnarCodec<type>::inspect(blocks).blocks;                          \
+	}
+
+	B_DecodeBlocks(float);
+	B_DecodeBlocks(double);
+
+	// decoding straight into a store
+#define B_Load(type)                                               \
+	BENCHMARK_TEMPLATE_DEFINE_F(CodecBenchmark, Load_##type, type) \
+	(benchmark::State & state)                                     \
+	{                                                              \
+		for (auto _ : state)                                       \
+		{                                                          \
+			EncryptedStore<type> store(dimensions);                \
+			codec->load(archive, store, state.range(0));           \
+			benchmark::DoNotOptimize(store.size());                \
+		}                                                          \
+		state.SetBytesProcessed(state.iterations() * raw_size());  \
+	}
+
+	B_Load(float);
+	B_Load(double);
+
+#define R_Encode(type)                                  \
+	BENCHMARK_REGISTER_F(CodecBenchmark, Encode_##type) \
+		->Arg(1)                                        \
+		->Arg(0)                                        \
+		->Iterations(1 << 3)                            \
+		->Unit(benchmark::kMillisecond)                 \
+		->UseRealTime();
+
+	R_Encode(float);
+	R_Encode(double);
+
+#define R_Decode(type)                                  \
+	BENCHMARK_REGISTER_F(CodecBenchmark, Decode_##type) \
+		->Arg(1)                                        \
+		->Arg(0)                                        \
+		->Iterations(1 << 3)                            \
+		->Unit(benchmark::kMillisecond)                 \
+		->UseRealTime();
+
+	R_Decode(float);
+	R_Decode(double);
+
+#define R_DecodeBlocks(type)                                  \
+	BENCHMARK_REGISTER_F(CodecBenchmark, DecodeBlocks_##type) \
+		->Arg(1 << 6)                                         \
+		->Arg(1 << 2)                                         \
+		->Arg(1)                                              \
+		->Iterations(1 << 3)                                  \
+		->Unit(benchmark::kMillisecond)                       \
+		->UseRealTime();
+
+	R_DecodeBlocks(float);
+	R_DecodeBlocks(double);
+
+#define R_Load(type)                                  \
+	BENCHMARK_REGISTER_F(CodecBenchmark, Load_##type) \
+		->Arg(1)                                      \
+		->Arg(0)                                      \
+		->Iterations(1 << 3)                          \
+		->Unit(benchmark::kMillisecond)               \
+		->UseRealTime();
+
+	R_Load(float);
+	R_Load(double);
+
+}
+BENCHMARK_MAIN();
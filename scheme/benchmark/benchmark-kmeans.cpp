@@ -0,0 +1,179 @@
+#include "batch.hpp"
+#include "definitions.h"
+#include "kmeans.hpp"
+#include "scheme.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	template <typename VALUE_T>
+	class KMeansBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const VALUE_T beta	 = 1.0 * (1 << 8);
+		const int dimensions = 128;
+		const int rows		 = 1 << 13;
+		const int clusters	 = 32;
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			srand(TEST_SEED);
+
+			auto uniform = [](double min, double max)
+			{ return min + (static_cast<VALUE_T>(rand()) / static_cast<double>(RAND_MAX)) * (max - min); };
+
+			std::vector<VALUE_T> centers(clusters * dimensions);
+			for (auto &&value : centers)
+			{
+				value = uniform(-1000.0, 1000.0);
+			}
+			messages.resize(rows * dimensions);
+			for (auto i = 0; i < rows; i++)
+			{
+				auto cluster = rand() % clusters;
+				for (auto j = 0; j < dimensions; j++)
+				{
+					messages[i * dimensions + j] = centers[cluster * dimensions + j] + uniform(-200.0, 200.0);
+				}
+			}
+
+			ciphertexts = encrypt(beta);
+		}
+
+		protected:
+		std::vector<VALUE_T> messages;
+		std::unique_ptr<CiphertextBatch<VALUE_T>> ciphertexts;
+
+		std::unique_ptr<CiphertextBatch<VALUE_T>> encrypt(VALUE_T beta)
+		{
+			Scheme<VALUE_T> scheme(beta);
+			auto key   = scheme.keygen();
+			auto batch = std::make_unique<CiphertextBatch<VALUE_T>>(rows, dimensions);
+			encrypt_batch(scheme, key, TO_ARRAY(messages), batch->view());
+
+			// keep what decrypting gives, for the plaintext baseline
+			decrypted.resize(rows * dimensions);
+			decrypt_batch(scheme, key, batch->view(), TO_ARRAY(decrypted));
+
+			return batch;
+		}
+
+		std::vector<VALUE_T> decrypted;
+
+		/**
+		 * @brief feeds all rows to k-means a mini-batch at a time
+		 */
+		void pass(StreamingKMeans<VALUE_T>& kmeans, CiphertextBatch<VALUE_T>& batch, size_t batch_rows, uint threads = 0)
+		{
+			for (size_t first = 0; first < batch.size(); first += batch_rows)
+			{
+				kmeans.update(batch.slice(first, std::min(first + batch_rows, batch.size())), threads);
+			}
+		}
+
+		/**
+		 * @brief the sum of squared distances of the plaintexts to the plaintext mean of their cluster
+		 */
+		double plaintext_inertia(const std::vector<int>& labels)
+		{
+			std::vector<double> sums(clusters * dimensions);
+			std::vector<double> counts(clusters);
+			for (auto i = 0; i < rows; i++)
+			{
+				counts[labels[i]]++;
+				for (auto j = 0; j < dimensions; j++)
+				{
+					sums[labels[i] * dimensions + j] += decrypted[i * dimensions + j];
+				}
+			}
+
+			auto result = 0.0;
+			for (auto i = 0; i < rows; i++)
+			{
+				for (auto j = 0; j < dimensions; j++)
+				{
+					auto difference = decrypted[i * dimensions + j] - sums[labels[i] * dimensions + j] / counts[labels[i]];
+					result += difference * difference;
+				}
+			}
+			return result;
+		}
+	};
+
+	// one pass over the ciphertexts; arguments: the mini-batch size and the number of threads
+#define B_Update(type)                                                  \
+	BENCHMARK_TEMPLATE_DEFINE_F(KMeansBenchmark, Update_##type, type)   \
+	(benchmark::State & state)                                          \
+	{                                                                   \
+		for (auto _ : state)                                            \
+		{                                                               \
+			StreamingKMeans<type> kmeans(clusters, dimensions);         \
+			pass(kmeans, *ciphertexts, state.range(0), state.range(1)); \
+			benchmark::DoNotOptimize(kmeans.centroid(0));               \
+		}                                                               \
+		state.SetItemsProcessed(state.iterations() * rows);             \
+	}
+
+	B_Update(float);
+	B_Update(double);
+
+	// clusters ciphertexts encrypted with beta = 2^argument and the decrypted plaintexts the same way;
+	// inertia_ratio compares, in plaintext space, the clustering found over ciphertexts with the one found over plaintexts (1 is as good, below 1 when the plaintext run lands in a worse local minimum)
+#define B_Quality(type)                                                                                                     \
+	BENCHMARK_TEMPLATE_DEFINE_F(KMeansBenchmark, Quality_##type, type)                                                      \
+	(benchmark::State & state)                                                                                              \
+	{                                                                                                                       \
+		auto encrypted = encrypt((type)(1 << state.range(0)));                                                              \
+		CiphertextBatch<type> plaintexts(rows, dimensions);                                                                 \
+		for (auto i = 0; i < rows; i++)                                                                                     \
+		{                                                                                                                   \
+			std::copy(TO_ARRAY(decrypted) + i * dimensions, TO_ARRAY(decrypted) + (i + 1) * dimensions, plaintexts.row(i)); \
+		}                                                                                                                   \
+		std::vector<int> encrypted_labels(rows), plaintext_labels(rows);                                                    \
+		for (auto _ : state)                                                                                                \
+		{                                                                                                                   \
+			StreamingKMeans<type> over_ciphertexts(clusters, dimensions);                                                   \
+			StreamingKMeans<type> over_plaintexts(clusters, dimensions);                                                    \
+			for (auto epoch = 0; epoch < 3; epoch++)                                                                        \
+			{                                                                                                               \
+				pass(over_ciphertexts, *encrypted, 1 << 10);                                                                \
+				pass(over_plaintexts, plaintexts, 1 << 10);                                                                 \
+			}                                                                                                               \
+			over_ciphertexts.assign(encrypted->view(), TO_ARRAY(encrypted_labels));                                         \
+			over_plaintexts.assign(plaintexts.view(), TO_ARRAY(plaintext_labels));                                          \
+		}                                                                                                                   \
+		state.counters["inertia_ratio"] = plaintext_inertia(encrypted_labels) / plaintext_inertia(plaintext_labels);        \
+	}
+
+	B_Quality(float);
+	B_Quality(double);
+
+#define R_Update(type)                                   \
+	BENCHMARK_REGISTER_F(KMeansBenchmark, Update_##type) \
+		->Args({256, 1})                                 \
+		->Args({1024, 1})                                \
+		->Args({1024, 0})                                \
+		->Iterations(1 << 2)                             \
+		->Unit(benchmark::kMillisecond)                  \
+		->UseRealTime();
+
+	R_Update(float);
+	R_Update(double);
+
+#define R_Quality(type)                                   \
+	BENCHMARK_REGISTER_F(KMeansBenchmark, Quality_##type) \
+		->Arg(4)                                          \
+		->Arg(8)                                          \
+		->Arg(12)                                         \
+		->Iterations(1)                                   \
+		->Unit(benchmark::kMillisecond);
+
+	R_Quality(float);
+	R_Quality(double);
+
+}
+BENCHMARK_MAIN();
@@ -0,0 +1,150 @@
+#include "definitions.h"
+#include "pool.hpp"
+#include "scheme.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <chrono>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	template <typename VALUE_T>
+	class PoolBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const VALUE_T beta	  = 1.0 * (1 << 10);
+		const int dimensions  = 128;
+		const size_t capacity = 1 << 12;
+		const int encryptions = 1 << 10;
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			srand(TEST_SEED);
+
+			scheme = std::make_unique<Scheme<VALUE_T>>(beta);
+			key	   = scheme->keygen();
+
+			message.resize(dimensions);
+			ciphertext.resize(dimensions);
+			for (auto j = 0; j < dimensions; j++)
+			{
+				message[j] = static_cast<VALUE_T>(rand()) / static_cast<double>(RAND_MAX);
+			}
+		}
+
+		protected:
+		std::unique_ptr<Scheme<VALUE_T>> scheme;
+		DCPE::key<VALUE_T> key;
+		std::vector<VALUE_T> message;
+		std::vector<VALUE_T> ciphertext;
+
+		/**
+		 * @brief times each call of encrypt separately and reports the median and tail latency in nanoseconds
+		 */
+		template <typename ENCRYPT>
+		void measure(benchmark::State& state, ENCRYPT encrypt)
+		{
+			std::vector<double> latencies;
+			latencies.reserve(encryptions);
+			for (auto i = 0; i < encryptions; i++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				encrypt();
+				latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			std::sort(latencies.begin(), latencies.end());
+			state.counters["p50_ns"] = latencies[latencies.size() / 2];
+			state.counters["p99_ns"] = latencies[latencies.size() * 99 / 100];
+		}
+	};
+
+	// the baseline: the noise is computed on the request path
+#define B_OnDemand(type)                                                                                                       \
+	BENCHMARK_TEMPLATE_DEFINE_F(PoolBenchmark, OnDemand_##type, type)                                                          \
+	(benchmark::State & state)                                                                                                 \
+	{                                                                                                                          \
+		for (auto _ : state)                                                                                                   \
+		{                                                                                                                      \
+			measure(state, [&]()                                                                                               \
+					{ benchmark::DoNotOptimize(scheme->encrypt(key, TO_ARRAY(message), dimensions, TO_ARRAY(ciphertext))); }); \
+		}                                                                                                                      \
+		state.SetItemsProcessed(state.iterations() * encryptions);                                                             \
+	}
+
+	B_OnDemand(float);
+	B_OnDemand(double);
+
+	// the noise comes from a pool filled ahead of time, the argument is the number of filler threads
+#define B_Pooled(type)                                                                                        \
+	BENCHMARK_TEMPLATE_DEFINE_F(PoolBenchmark, Pooled_##type, type)                                           \
+	(benchmark::State & state)                                                                                \
+	{                                                                                                         \
+		NoisePool<type> pool(*scheme, key, dimensions, capacity, 0, 0, state.range(0));                       \
+		for (auto _ : state)                                                                                  \
+		{                                                                                                     \
+			state.PauseTiming();                                                                              \
+			pool.fill();                                                                                      \
+			state.ResumeTiming();                                                                             \
+			measure(state, [&]()                                                                              \
+					{ benchmark::DoNotOptimize(pool.encrypt(TO_ARRAY(message), TO_ARRAY(ciphertext))); });    \
+		}                                                                                                     \
+		state.SetItemsProcessed(state.iterations() * encryptions);                                            \
+		state.counters["misses"] = benchmark::Counter(pool.get_misses(), benchmark::Counter::kAvgIterations); \
+	}
+
+	B_Pooled(float);
+	B_Pooled(double);
+
+	// a burst longer than the pool; once it runs dry, requests pay for the noise again
+#define B_Drain(type)                                                                                         \
+	BENCHMARK_TEMPLATE_DEFINE_F(PoolBenchmark, Drain_##type, type)                                            \
+	(benchmark::State & state)                                                                                \
+	{                                                                                                         \
+		NoisePool<type> pool(*scheme, key, dimensions, encryptions / 4, 0, 0, 1);                             \
+		for (auto _ : state)                                                                                  \
+		{                                                                                                     \
+			state.PauseTiming();                                                                              \
+			pool.fill();                                                                                      \
+			state.ResumeTiming();                                                                             \
+			measure(state, [&]()                                                                              \
+					{ benchmark::DoNotOptimize(pool.encrypt(TO_ARRAY(message), TO_ARRAY(ciphertext))); });    \
+		}                                                                                                     \
+		state.SetItemsProcessed(state.iterations() * encryptions);                                            \
+		state.counters["misses"] = benchmark::Counter(pool.get_misses(), benchmark::Counter::kAvgIterations); \
+	}
+
+	B_Drain(float);
+	B_Drain(double);
+
+#define R_OnDemand(type)                                 \
+	BENCHMARK_REGISTER_F(PoolBenchmark, OnDemand_##type) \
+		->Iterations(1 << 3)                             \
+		->Unit(benchmark::kMicrosecond);
+
+	R_OnDemand(float);
+	R_OnDemand(double);
+
+#define R_Pooled(type)                                 \
+	BENCHMARK_REGISTER_F(PoolBenchmark, Pooled_##type) \
+		->Arg(0)                                       \
+		->Arg(1)                                       \
+		->Iterations(1 << 3)                           \
+		->Unit(benchmark::kMicrosecond);
+
+	R_Pooled(float);
+	R_Pooled(double);
+
+#define R_Drain(type)                                 \
+	BENCHMARK_REGISTER_F(PoolBenchmark, Drain_##type) \
+		->Iterations(1 << 3)                          \
+		->Unit(benchmark::kMicrosecond);
+
+	R_Drain(float);
+	R_Drain(double);
+
+}
+BENCHMARK_MAIN();
@@ -0,0 +1,181 @@
+#include "definitions.h"
+#include "scheduler.hpp"
+#include "scheme.hpp"
+#include "utility.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	// the cost of a task: submit that many empty tasks and wait for them
+	static void TaskOverhead(benchmark::State& state)
+	{
+		auto& scheduler = Scheduler::global();
+		auto tasks		= state.range(0);
+		for (auto _ : state)
+		{
+			TaskGroup group(scheduler);
+			for (auto i = 0; i < tasks; i++)
+			{
+				group.run([]() {});
+			}
+			group.wait();
+		}
+		state.SetItemsProcessed(state.iterations() * tasks);
+	}
+
+	// the cost of a parallel_for call with a trivial body
+	static void ParallelForOverhead(benchmark::State& state)
+	{
+		std::vector<int> values(state.range(0));
+		for (auto _ : state)
+		{
+			parallel_for(0, values.size(), [&](size_t i)
+						 { values[i]++; });
+			benchmark::DoNotOptimize(values.data());
+		}
+	}
+
+	// the same with a fresh set of threads per call, which is what parallel_for did before the scheduler
+	static void SpawnThreadsOverhead(benchmark::State& state)
+	{
+		std::vector<int> values(state.range(0));
+		auto workers = std::max(std::thread::hardware_concurrency(), 1u);
+		for (auto _ : state)
+		{
+			std::atomic<size_t> next = 0;
+			auto work				 = [&]()
+			{
+				for (auto i = next++; i < values.size(); i = next++)
+				{
+					values[i]++;
+				}
+			};
+			std::vector<std::thread> pool;
+			for (uint i = 1; i < workers; i++)
+			{
+				pool.emplace_back(work);
+			}
+			work();
+			for (auto &&thread : pool)
+			{
+				thread.join();
+			}
+			benchmark::DoNotOptimize(values.data());
+		}
+	}
+
+	BENCHMARK(TaskOverhead)->Arg(1 << 4)->Arg(1 << 10)->Iterations(1 << 8)->Unit(benchmark::kMicrosecond)->UseRealTime();
+	BENCHMARK(ParallelForOverhead)->Arg(1 << 4)->Arg(1 << 10)->Iterations(1 << 8)->Unit(benchmark::kMicrosecond)->UseRealTime();
+	BENCHMARK(SpawnThreadsOverhead)->Arg(1 << 4)->Arg(1 << 10)->Iterations(1 << 8)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+	// a batch of vectors to encrypt where a few are much larger than the rest, the large ones coming first
+	template <typename VALUE_T>
+	class SchedulerBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const VALUE_T beta	   = 1.0 * (1 << 10);
+		const int batch		   = 1 << 10;
+		const int small		   = 16;
+		const int large		   = 1 << 12;
+		const int large_stride = 16; // one in large_stride of the first half is large
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			srand(TEST_SEED);
+
+			scheme = std::make_unique<Scheme<VALUE_T>>(beta);
+			key	   = scheme->keygen();
+
+			messages.resize(batch);
+			ciphertexts.resize(batch);
+			for (auto i = 0; i < batch; i++)
+			{
+				auto dimensions = i < batch / 2 && i % large_stride == 0 ? large : small;
+				messages[i].resize(dimensions);
+				ciphertexts[i].resize(dimensions);
+				for (auto &&value : messages[i])
+				{
+					value = static_cast<VALUE_T>(rand()) / static_cast<double>(RAND_MAX);
+				}
+			}
+		}
+
+		protected:
+		std::unique_ptr<Scheme<VALUE_T>> scheme;
+		DCPE::key<VALUE_T> key;
+		std::vector<std::vector<VALUE_T>> messages;
+		std::vector<std::vector<VALUE_T>> ciphertexts;
+
+		void encrypt(size_t i)
+		{
+			scheme->encrypt(key, TO_ARRAY(messages[i]), messages[i].size(), TO_ARRAY(ciphertexts[i]));
+		}
+	};
+
+	// dynamic load balancing: indices are handed out one at a time to the scheduler's workers
+#define B_Skewed(type)                                                   \
+	BENCHMARK_TEMPLATE_DEFINE_F(SchedulerBenchmark, Skewed_##type, type) \
+	(benchmark::State & state)                                           \
+	{                                                                    \
+		for (auto _ : state)                                             \
+		{                                                                \
+			parallel_for(0, batch, [&](size_t i)                         \
+						 { encrypt(i); });                               \
+		}                                                                \
+		state.SetItemsProcessed(state.iterations() * batch);             \
+	}
+
+	B_Skewed(float);
+	B_Skewed(double);
+
+	// the baseline: the batch is split into equal contiguous parts upfront, one per thread
+#define B_SkewedStatic(type)                                                                                   \
+	BENCHMARK_TEMPLATE_DEFINE_F(SchedulerBenchmark, SkewedStatic_##type, type)                                 \
+	(benchmark::State & state)                                                                                 \
+	{                                                                                                          \
+		auto workers = Scheduler::global().size() + 1;                                                         \
+		for (auto _ : state)                                                                                   \
+		{                                                                                                      \
+			TaskGroup group;                                                                                   \
+			for (uint worker = 0; worker < workers; worker++)                                                  \
+			{                                                                                                  \
+				group.run([&, worker]()                                                                        \
+						  {                                                                                    \
+							  for (auto i = worker * batch / workers; i < (worker + 1) * batch / workers; i++) \
+							  {                                                                                \
+								  encrypt(i);                                                                  \
+							  }                                                                                \
+						  });                                                                                  \
+			}                                                                                                  \
+			group.wait();                                                                                      \
+		}                                                                                                      \
+		state.SetItemsProcessed(state.iterations() * batch);                                                   \
+	}
+
+	B_SkewedStatic(float);
+	B_SkewedStatic(double);
+
+#define R_Skewed(type)                                      \
+	BENCHMARK_REGISTER_F(SchedulerBenchmark, Skewed_##type) \
+		->Iterations(1 << 4)                                \
+		->Unit(benchmark::kMillisecond)                     \
+		->UseRealTime();
+
+	R_Skewed(float);
+	R_Skewed(double);
+
+#define R_SkewedStatic(type)                                      \
+	BENCHMARK_REGISTER_F(SchedulerBenchmark, SkewedStatic_##type) \
+		->Iterations(1 << 4)                                      \
+		->Unit(benchmark::kMillisecond)                           \
+		->UseRealTime();
+
+	R_SkewedStatic(float);
+	R_SkewedStatic(double);
+
+}
+BENCHMARK_MAIN();
@@ -36,6 +36,24 @@ namespace DCPE
 	B_KeyGen(float);
 	B_KeyGen(double);
 
+#define B_KeyGenBatch(type)                                                \
+	BENCHMARK_TEMPLATE_DEFINE_F(SchemeBenchmark, KeyGenBatch_##type, type) \
+	(benchmark::State & state)                                             \
+	{                                                                      \
+		auto n = (size_t)state.range(0);                                   \
+		std::vector<key<type>> keys;                                       \
+		keys.resize(n);                                                    \
+		for (auto _ : state)                                               \
+		{                                                                  \
+			scheme->keygen_batch(n, TO_ARRAY(keys));                       \
+			benchmark::DoNotOptimize(keys);                                \
+		}                                                                  \
+		state.SetItemsProcessed(state.iterations() * n);                   \
+	}
+
+	B_KeyGenBatch(float);
+	B_KeyGenBatch(double);
+
 #define B_Encrypt(type)                                                                                          \
 	BENCHMARK_TEMPLATE_DEFINE_F(SchemeBenchmark, Encrypt_##type, type)                                           \
 	(benchmark::State & state)                                                                                   \
@@ -63,6 +81,35 @@ namespace DCPE
 	B_Encrypt(float);
 	B_Encrypt(double);
 
+#define B_EncryptQuantized(type, input, name)                                                                                \
+	BENCHMARK_TEMPLATE_DEFINE_F(SchemeBenchmark, Encrypt_##name##_##type, type)                                              \
+	(benchmark::State & state)                                                                                               \
+	{                                                                                                                        \
+		auto key = scheme->keygen();                                                                                         \
+                                                                                                                             \
+		auto dimensions = state.range(0);                                                                                    \
+                                                                                                                             \
+		std::vector<input> message;                                                                                          \
+		message.resize(dimensions);                                                                                          \
+		for (auto i = 0; i < dimensions; i++)                                                                                \
+		{                                                                                                                    \
+			message[i] = input(rand() % 100);                                                                                \
+		}                                                                                                                    \
+                                                                                                                             \
+		std::vector<type> ciphertext;                                                                                        \
+		ciphertext.resize(dimensions);                                                                                       \
+                                                                                                                             \
+		for (auto _ : state)                                                                                                 \
+		{                                                                                                                    \
+			benchmark::DoNotOptimize(scheme->encrypt(key, TO_ARRAY(message), dimensions, TO_ARRAY(ciphertext), 0.01, -0.5)); \
+		}                                                                                                                    \
+	}
+
+	B_EncryptQuantized(float, int8_t, int8);
+	B_EncryptQuantized(float, uint8_t, uint8);
+	B_EncryptQuantized(float, half, half);
+	B_EncryptQuantized(double, uint8_t, uint8);
+
 #define B_Decrypt(type)                                                                         \
 	BENCHMARK_TEMPLATE_DEFINE_F(SchemeBenchmark, Decrypt_##type, type)                          \
 	(benchmark::State & state)                                                                  \
@@ -100,6 +147,17 @@ namespace DCPE
 	R_KeyGen(float);
 	R_KeyGen(double);
 
+#define R_KeyGenBatch(type)                                   \
+	BENCHMARK_REGISTER_F(SchemeBenchmark, KeyGenBatch_##type) \
+		->Args({1 << 10})                                     \
+		->Args({1 << 20})                                     \
+		->Iterations(1 << 4)                                  \
+		->Unit(benchmark::kMicrosecond)                       \
+		->UseRealTime();
+
+	R_KeyGenBatch(float);
+	R_KeyGenBatch(double);
+
 #define R_Encrypt(type)                                   \
 	BENCHMARK_REGISTER_F(SchemeBenchmark, Encrypt_##type) \
 		->Args({1})                                       \
@@ -112,6 +170,18 @@ namespace DCPE
 	R_Encrypt(float);
 	R_Encrypt(double);
 
+#define R_EncryptQuantized(type, name)                             \
+	BENCHMARK_REGISTER_F(SchemeBenchmark, Encrypt_##name##_##type) \
+		->Args({100})                                              \
+		->Args({768})                                              \
+		->Iterations(1 << 15)                                      \
+		->Unit(benchmark::kMicrosecond);
+
+	R_EncryptQuantized(float, int8);
+	R_EncryptQuantized(float, uint8);
+	R_EncryptQuantized(float, half);
+	R_EncryptQuantized(double, uint8);
+
 #define R_Decrypt(type)                                   \
 	BENCHMARK_REGISTER_F(SchemeBenchmark, Decrypt_##type) \
 		->Args({1})                                       \
@@ -0,0 +1,158 @@
+#include "definitions.h"
+#include "shard.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <unistd.h>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	template <typename VALUE_T>
+	class ShardBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const int dimensions = 128;
+		const int records	 = 1 << 14;
+		const int k			 = 10;
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			// with several client threads the fixture is shared, and the first thread builds it before the others start
+			if (state.thread_index() != 0)
+			{
+				return;
+			}
+
+			srand(TEST_SEED);
+
+			auto count			= state.range(0);
+			auto use_processes	= state.range(1) == 1;
+			auto server_threads = state.range(2);
+
+			std::vector<std::unique_ptr<Transport>> shards;
+			for (auto i = 0; i < count; i++)
+			{
+				if (use_processes)
+				{
+					auto path = (boost::format("/tmp/dcpe-benchmark-shard-%d-%d.sock") % getpid() % i).str();
+					processes.push_back(std::make_unique<ShardProcess<VALUE_T>>(path, dimensions));
+					shards.push_back(std::make_unique<UnixSocketTransport>(path));
+				}
+				else
+				{
+					shards.push_back(std::make_unique<InProcessTransport<VALUE_T>>(dimensions, 1 << 14, server_threads));
+				}
+			}
+			store = std::make_unique<ShardedStore<VALUE_T>>(dimensions, std::move(shards));
+
+			for (auto i = 0; i < records; i++)
+			{
+				auto ciphertext = random_vector();
+				store->insert(i, TO_ARRAY(ciphertext), {i, i});
+			}
+
+			queries.clear();
+			for (auto i = 0; i < 1 << 6; i++)
+			{
+				queries.push_back(random_vector());
+			}
+		}
+
+		void TearDown(const ::benchmark::State& state)
+		{
+			if (state.thread_index() != 0)
+			{
+				return;
+			}
+
+			store.reset();
+			processes.clear();
+		}
+
+		protected:
+		std::unique_ptr<ShardedStore<VALUE_T>> store;
+		std::vector<std::unique_ptr<ShardProcess<VALUE_T>>> processes;
+		std::vector<std::vector<VALUE_T>> queries;
+
+		std::vector<VALUE_T> random_vector()
+		{
+			std::vector<VALUE_T> result;
+			result.resize(dimensions);
+			for (auto i = 0; i < dimensions; i++)
+			{
+				result[i] = static_cast<VALUE_T>(rand()) / static_cast<double>(RAND_MAX);
+			}
+			return result;
+		}
+	};
+
+	// arguments are the number of shards, the transport (0 for in-process, 1 for worker processes over Unix sockets)
+	// and the number of threads serving each in-process shard
+#define B_Search(type)                                                                                    \
+	BENCHMARK_TEMPLATE_DEFINE_F(ShardBenchmark, Search_##type, type)                                      \
+	(benchmark::State & state)                                                                            \
+	{                                                                                                     \
+		auto query = random_vector();                                                                     \
+		std::vector<double> latencies;                                                                    \
+		for (auto _ : state)                                                                              \
+		{                                                                                                 \
+			auto start = std::chrono::steady_clock::now();                                                \
+			benchmark::DoNotOptimize(store->search(TO_ARRAY(query), k));                                  \
+			std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start; \
+			latencies.push_back(elapsed.count());                                                         \
+		}                                                                                                 \
+		std::sort(latencies.begin(), latencies.end());                                                    \
+		state.counters["p50_us"] = latencies[latencies.size() / 2];                                       \
+		state.counters["p99_us"] = latencies[latencies.size() * 99 / 100];                                \
+		state.SetItemsProcessed(state.iterations());                                                      \
+	}
+
+	B_Search(float);
+	B_Search(double);
+
+	// the same arguments, with searches issued from several client threads at once; qps is the total over all clients
+#define B_Throughput(type)                                                                           \
+	BENCHMARK_TEMPLATE_DEFINE_F(ShardBenchmark, Throughput_##type, type)                             \
+	(benchmark::State & state)                                                                       \
+	{                                                                                                \
+		size_t i = state.thread_index();                                                             \
+		for (auto _ : state)                                                                         \
+		{                                                                                            \
+			benchmark::DoNotOptimize(store->search(TO_ARRAY(queries[i++ % queries.size()]), k));     \
+		}                                                                                            \
+		state.SetItemsProcessed(state.iterations());                                                 \
+		state.counters["qps"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate); \
+	}
+
+	B_Throughput(float);
+	B_Throughput(double);
+
+#define R_Search(type)                                  \
+	BENCHMARK_REGISTER_F(ShardBenchmark, Search_##type) \
+		->ArgsProduct({{1, 2, 4, 8}, {0, 1}, {1}})      \
+		->Iterations(1 << 9)                            \
+		->Unit(benchmark::kMicrosecond)                 \
+		->UseRealTime();
+
+	R_Search(float);
+	R_Search(double);
+
+#define R_Throughput(type)                                  \
+	BENCHMARK_REGISTER_F(ShardBenchmark, Throughput_##type) \
+		->Args({4, 0, 1})                                   \
+		->Args({4, 0, 4})                                   \
+		->Args({4, 1, 1})                                   \
+		->ThreadRange(1, 8)                                 \
+		->Iterations(1 << 7)                                \
+		->Unit(benchmark::kMicrosecond)                     \
+		->UseRealTime();
+
+	R_Throughput(float);
+	R_Throughput(double);
+
+}
+BENCHMARK_MAIN();
@@ -0,0 +1,185 @@
+#include "batch.hpp"
+#include "definitions.h"
+#include "scheme.hpp"
+#include "sketch.hpp"
+#include "utility.hpp"
+
+#include <benchmark/benchmark.h>
+#include <set>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	/**
+	 * @brief clustered records and queries encrypted with \f$ \beta = 2^{\text{range}(0)} \f$
+	 *
+	 * Recall is reported against the true \f$ k \f$ nearest neighbors in plaintext space (recall)
+	 * and against a full scan over the ciphertexts (filter_recall), which is what the prefilter alone costs.
+	 */
+	template <typename VALUE_T>
+	class SketchBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const int dimensions = 512;
+		const int rows		 = 1 << 12;
+		const int clusters	 = 64;
+		const int queries	 = 16;
+		const int k			 = 10;
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			srand(TEST_SEED);
+
+			scheme = std::make_unique<Scheme<VALUE_T>>((VALUE_T)(1 << state.range(0)));
+			key	   = scheme->keygen();
+
+			auto uniform = [](double min, double max)
+			{ return min + (static_cast<VALUE_T>(rand()) / static_cast<double>(RAND_MAX)) * (max - min); };
+
+			std::vector<VALUE_T> centers(clusters * dimensions);
+			for (auto &&value : centers)
+			{
+				value = uniform(-1000.0, 1000.0);
+			}
+			messages.resize(rows * dimensions);
+			for (auto i = 0; i < rows; i++)
+			{
+				auto cluster = rand() % clusters;
+				for (auto j = 0; j < dimensions; j++)
+				{
+					messages[i * dimensions + j] = centers[cluster * dimensions + j] + uniform(-300.0, 300.0);
+				}
+			}
+			batch = std::make_unique<CiphertextBatch<VALUE_T>>(rows, dimensions);
+			encrypt_batch(*scheme, key, TO_ARRAY(messages), batch->view());
+
+			// queries are perturbed copies of records, encrypted on their own
+			query_ciphertexts.resize(queries * dimensions);
+			plaintext_truth.clear();
+			ciphertext_truth.clear();
+			for (auto q = 0; q < queries; q++)
+			{
+				std::vector<VALUE_T> query(dimensions);
+				auto source = rand() % rows;
+				for (auto j = 0; j < dimensions; j++)
+				{
+					query[j] = messages[source * dimensions + j] + uniform(-30.0, 30.0);
+				}
+				scheme->encrypt(key, TO_ARRAY(query), dimensions, TO_ARRAY(query_ciphertexts) + q * dimensions);
+
+				std::vector<std::pair<VALUE_T, ull>> plaintext, ciphertext;
+				for (auto i = 0; i < rows; i++)
+				{
+					plaintext.push_back({squared_distance(TO_ARRAY(messages) + i * dimensions, TO_ARRAY(query), dimensions), i});
+					ciphertext.push_back({squared_distance(batch->row(i), TO_ARRAY(query_ciphertexts) + q * dimensions, dimensions), i});
+				}
+				std::partial_sort(plaintext.begin(), plaintext.begin() + k, plaintext.end());
+				std::partial_sort(ciphertext.begin(), ciphertext.begin() + k, ciphertext.end());
+
+				plaintext_truth.emplace_back();
+				ciphertext_truth.emplace_back();
+				for (auto i = 0; i < k; i++)
+				{
+					plaintext_truth.back().insert(plaintext[i].second);
+					ciphertext_truth.back().insert(ciphertext[i].second);
+				}
+			}
+		}
+
+		protected:
+		std::unique_ptr<Scheme<VALUE_T>> scheme;
+		DCPE::key<VALUE_T> key;
+		std::vector<VALUE_T> messages;
+		std::unique_ptr<CiphertextBatch<VALUE_T>> batch;
+
+		std::vector<VALUE_T> query_ciphertexts;
+		std::vector<std::set<ull>> plaintext_truth;
+		std::vector<std::set<ull>> ciphertext_truth;
+
+		/**
+		 * @brief runs all queries with the search function and reports the recall
+		 */
+		template <typename SEARCH>
+		void measure(benchmark::State& state, SEARCH search)
+		{
+			auto found = 0, filtered = 0;
+			for (auto _ : state)
+			{
+				found = filtered = 0;
+				for (auto q = 0; q < queries; q++)
+				{
+					for (auto &&neighbor : search(TO_ARRAY(query_ciphertexts) + q * dimensions))
+					{
+						found += plaintext_truth[q].count(neighbor.id);
+						filtered += ciphertext_truth[q].count(neighbor.id);
+					}
+				}
+			}
+			state.counters["recall"]		= (double)found / (queries * k);
+			state.counters["filter_recall"] = (double)filtered / (queries * k);
+			state.SetItemsProcessed(state.iterations() * queries);
+		}
+	};
+
+	// the baseline: full-dimension distances to every row
+#define B_FullScan(type)                                                                 \
+	BENCHMARK_TEMPLATE_DEFINE_F(SketchBenchmark, FullScan_##type, type)                  \
+	(benchmark::State & state)                                                           \
+	{                                                                                    \
+		std::vector<type> distances(rows);                                               \
+		measure(state, [&](const type* query)                                            \
+				{                                                                        \
+					squared_distances(batch->view(), query, TO_ARRAY(distances));        \
+					std::vector<Neighbor<type>> result;                                  \
+					for (auto i = 0; i < rows; i++)                                      \
+					{                                                                    \
+						result.push_back({(ull)i, distances[i]});                        \
+					}                                                                    \
+					std::partial_sort(result.begin(), result.begin() + k, result.end()); \
+					result.resize(k);                                                    \
+					return result; });                                                   \
+	}
+
+	B_FullScan(float);
+	B_FullScan(double);
+
+	// arguments: log2 of beta, the sketch kind (0 for signs, 1 for projections), its width and the number of candidates
+#define B_Filtered(type)                                                               \
+	BENCHMARK_TEMPLATE_DEFINE_F(SketchBenchmark, Filtered_##type, type)                \
+	(benchmark::State & state)                                                         \
+	{                                                                                  \
+		auto kind = state.range(1) == 0 ? SketchKind::Signs : SketchKind::Projections; \
+		SketchFilter<type> filter(batch->view(), kind, state.range(2));                \
+		measure(state, [&](const type* query)                                          \
+				{ return filter.search(query, k, state.range(3)); });                  \
+		state.counters["sketch_bytes_per_row"] = (double)filter.sketch_bytes() / rows; \
+	}
+
+	B_Filtered(float);
+	B_Filtered(double);
+
+#define R_FullScan(type)                                   \
+	BENCHMARK_REGISTER_F(SketchBenchmark, FullScan_##type) \
+		->Arg(4)                                           \
+		->Arg(8)                                           \
+		->Arg(12)                                          \
+		->Iterations(1 << 2)                               \
+		->Unit(benchmark::kMillisecond);
+
+	R_FullScan(float);
+	R_FullScan(double);
+
+#define R_Filtered(type)                                   \
+	BENCHMARK_REGISTER_F(SketchBenchmark, Filtered_##type) \
+		->ArgsProduct({{4, 8, 12}, {0}, {256}, {64, 256}}) \
+		->ArgsProduct({{4, 8, 12}, {1}, {32}, {64, 256}})  \
+		->Iterations(1 << 2)                               \
+		->Unit(benchmark::kMillisecond);
+
+	R_Filtered(float);
+	R_Filtered(double);
+
+}
+BENCHMARK_MAIN();
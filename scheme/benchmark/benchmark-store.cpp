@@ -0,0 +1,270 @@
+#include "definitions.h"
+#include "scheme.hpp"
+#include "store.hpp"
+
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <thread>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	template <typename VALUE_T>
+	class StoreBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const VALUE_T beta	  = 1.0 * (1 << 10);
+		const int dimensions  = 128;
+		const int records	  = 1 << 14;
+		const int k			  = 10;
+		const size_t capacity = 1 << 10;
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			// with several threads the fixture is shared, and the first thread builds it before the others start
+			if (state.thread_index() != 0)
+			{
+				return;
+			}
+
+			srand(TEST_SEED);
+
+			scheme = std::make_unique<Scheme<VALUE_T>>(beta);
+			key	   = scheme->keygen();
+			store  = std::make_unique<EncryptedStore<VALUE_T>>(dimensions, capacity);
+
+			for (auto i = 0; i < records; i++)
+			{
+				auto ciphertext = random_ciphertext();
+				store->insert(i, TO_ARRAY(ciphertext), {i, i});
+			}
+		}
+
+		void TearDown(const ::benchmark::State& state)
+		{
+			if (state.thread_index() != 0)
+			{
+				return;
+			}
+
+			store.reset();
+		}
+
+		protected:
+		std::unique_ptr<Scheme<VALUE_T>> scheme;
+		DCPE::key<VALUE_T> key;
+		std::unique_ptr<EncryptedStore<VALUE_T>> store;
+
+		std::vector<std::vector<VALUE_T>> queries;
+		std::thread writer;
+		std::atomic<bool> writing = false;
+		std::atomic<ull> updates  = 0;
+
+		std::vector<VALUE_T> random_ciphertext()
+		{
+			std::vector<VALUE_T> message, ciphertext;
+			message.resize(dimensions);
+			ciphertext.resize(dimensions);
+			for (auto i = 0; i < dimensions; i++)
+			{
+				message[i] = static_cast<VALUE_T>(rand()) / static_cast<double>(RAND_MAX);
+			}
+			scheme->encrypt(key, TO_ARRAY(message), dimensions, TO_ARRAY(ciphertext));
+			return ciphertext;
+		}
+	};
+
+#define B_Search(type)                                                   \
+	BENCHMARK_TEMPLATE_DEFINE_F(StoreBenchmark, Search_##type, type)     \
+	(benchmark::State & state)                                           \
+	{                                                                    \
+		auto query = random_ciphertext();                                \
+		for (auto _ : state)                                             \
+		{                                                                \
+			benchmark::DoNotOptimize(store->search(TO_ARRAY(query), k)); \
+		}                                                                \
+	}
+
+	B_Search(float);
+	B_Search(double);
+
+	// the argument is the block size, a block of all the dimensions being a full scan without early exits
+#define B_Radius(type)                                                              \
+	BENCHMARK_TEMPLATE_DEFINE_F(StoreBenchmark, Radius_##type, type)                \
+	(benchmark::State & state)                                                      \
+	{                                                                               \
+		auto block	= state.range(0);                                               \
+		auto query	= random_ciphertext();                                          \
+		auto radius = std::sqrt(store->search(TO_ARRAY(query), k).back().distance); \
+		size_t found = 0;                                                           \
+		for (auto _ : state)                                                        \
+		{                                                                           \
+			auto result = store->search_radius(TO_ARRAY(query), radius, block);     \
+			found		= result.size();                                            \
+			benchmark::DoNotOptimize(result);                                       \
+		}                                                                           \
+		state.counters["found"] = found;                                            \
+	}
+
+	B_Radius(float);
+	B_Radius(double);
+
+	// each iteration is either a search or an update (an insert of a new record plus a delete of the oldest one);
+	// the argument is the percentage of updates
+#define B_Mixed(type)                                                                  \
+	BENCHMARK_TEMPLATE_DEFINE_F(StoreBenchmark, Mixed_##type, type)                    \
+	(benchmark::State & state)                                                         \
+	{                                                                                  \
+		auto ratio = state.range(0);                                                   \
+		auto query = random_ciphertext();                                              \
+		std::vector<std::vector<type>> pool;                                           \
+		for (auto i = 0; i < 100; i++)                                                 \
+		{                                                                              \
+			pool.push_back(random_ciphertext());                                       \
+		}                                                                              \
+                                                                                       \
+		ull next = records, oldest = 0, i = 0;                                         \
+		for (auto _ : state)                                                           \
+		{                                                                              \
+			if ((long)(i++ % 100) < ratio)                                             \
+			{                                                                          \
+				store->insert(next, TO_ARRAY(pool[next % pool.size()]), {next, next}); \
+				store->remove(oldest++);                                               \
+				next++;                                                                \
+			}                                                                          \
+			else                                                                       \
+			{                                                                          \
+				benchmark::DoNotOptimize(store->search(TO_ARRAY(query), k));           \
+			}                                                                          \
+		}                                                                              \
+		state.counters["segments"] = store->segments();                                \
+		state.counters["overhead"] = (double)store->rows() / store->size();            \
+	}
+
+	B_Mixed(float);
+	B_Mixed(double);
+
+	// searches from the benchmark threads while a writer thread keeps inserting new records and deleting the oldest ones,
+	// so background compaction publishes new snapshots under the readers; qps is the total over the readers
+#define B_Concurrent(type)                                                                           \
+	BENCHMARK_TEMPLATE_DEFINE_F(StoreBenchmark, Concurrent_##type, type)                             \
+	(benchmark::State & state)                                                                       \
+	{                                                                                                \
+		if (state.thread_index() == 0)                                                               \
+		{                                                                                            \
+			queries.clear();                                                                         \
+			std::vector<std::vector<type>> churn;                                                    \
+			for (auto i = 0; i < 100; i++)                                                           \
+			{                                                                                        \
+				queries.push_back(random_ciphertext());                                              \
+				churn.push_back(random_ciphertext());                                                \
+			}                                                                                        \
+			updates = 0;                                                                             \
+			writing = true;                                                                          \
+			writer	= std::thread(                                                                   \
+				[this, churn = std::move(churn)]()                                                   \
+				{                                                                                    \
+					ull next = records, oldest = 0;                                                  \
+					while (writing)                                                                  \
+					{                                                                                \
+						store->insert(next, TO_ARRAY(churn[next % churn.size()]), {next, next});     \
+						store->remove(oldest++);                                                     \
+						next++;                                                                      \
+						updates++;                                                                   \
+					}                                                                                \
+				});                                                                                  \
+		}                                                                                            \
+		size_t i = state.thread_index();                                                             \
+		for (auto _ : state)                                                                         \
+		{                                                                                            \
+			benchmark::DoNotOptimize(store->search(TO_ARRAY(queries[i++ % queries.size()]), k));     \
+		}                                                                                            \
+		state.SetItemsProcessed(state.iterations());                                                 \
+		state.counters["qps"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate); \
+		if (state.thread_index() == 0)                                                               \
+		{                                                                                            \
+			writing = false;                                                                         \
+			writer.join();                                                                           \
+			state.counters["updates"]  = benchmark::Counter(updates, benchmark::Counter::kIsRate);   \
+			state.counters["segments"] = store->segments();                                          \
+			state.counters["overhead"] = (double)store->rows() / store->size();                      \
+		}                                                                                            \
+	}
+
+	B_Concurrent(float);
+	B_Concurrent(double);
+
+#define B_Update(type)                                               \
+	BENCHMARK_TEMPLATE_DEFINE_F(StoreBenchmark, Update_##type, type) \
+	(benchmark::State & state)                                       \
+	{                                                                \
+		auto ciphertext = random_ciphertext();                       \
+		ull next = records, oldest = 0;                              \
+		for (auto _ : state)                                         \
+		{                                                            \
+			store->insert(next, TO_ARRAY(ciphertext), {next, next}); \
+			store->remove(oldest++);                                 \
+			next++;                                                  \
+		}                                                            \
+	}
+
+	B_Update(float);
+	B_Update(double);
+
+#define R_Search(type)                                  \
+	BENCHMARK_REGISTER_F(StoreBenchmark, Search_##type) \
+		->Iterations(1 << 8)                            \
+		->Unit(benchmark::kMicrosecond);
+
+	R_Search(float);
+	R_Search(double);
+
+#define R_Radius(type)                                  \
+	BENCHMARK_REGISTER_F(StoreBenchmark, Radius_##type) \
+		->Arg(4)                                        \
+		->Arg(16)                                       \
+		->Arg(32)                                       \
+		->Arg(128)                                      \
+		->Iterations(1 << 8)                            \
+		->Unit(benchmark::kMicrosecond);
+
+	R_Radius(float);
+	R_Radius(double);
+
+#define R_Mixed(type)                                  \
+	BENCHMARK_REGISTER_F(StoreBenchmark, Mixed_##type) \
+		->Args({0})                                    \
+		->Args({10})                                   \
+		->Args({50})                                   \
+		->Args({90})                                   \
+		->Iterations(1 << 8)                           \
+		->Unit(benchmark::kMicrosecond)                \
+		->UseRealTime();
+
+	R_Mixed(float);
+	R_Mixed(double);
+
+#define R_Concurrent(type)                                  \
+	BENCHMARK_REGISTER_F(StoreBenchmark, Concurrent_##type) \
+		->ThreadRange(1, 8)                                 \
+		->Iterations(1 << 8)                                \
+		->Unit(benchmark::kMicrosecond)                     \
+		->UseRealTime();
+
+	R_Concurrent(float);
+	R_Concurrent(double);
+
+#define R_Update(type)                                  \
+	BENCHMARK_REGISTER_F(StoreBenchmark, Update_##type) \
+		->Iterations(1 << 14)                           \
+		->Unit(benchmark::kMicrosecond)                 \
+		->UseRealTime();
+
+	R_Update(float);
+	R_Update(double);
+
+}
+BENCHMARK_MAIN();
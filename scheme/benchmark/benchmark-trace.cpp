@@ -0,0 +1,116 @@
+#include "definitions.h"
+#include "scheme.hpp"
+#include "trace.hpp"
+
+#include <benchmark/benchmark.h>
+#include <sstream>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	// the cost of a single scope, which is what every TRACE_SCOPE adds when tracing is on
+	static void Scope(benchmark::State& state)
+	{
+		for (auto _ : state)
+		{
+			TraceScope scope("benchmark");
+		}
+	}
+
+	// the cost of reading the clock alone
+	static void Now(benchmark::State& state)
+	{
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(Tracer::now());
+		}
+	}
+
+	static void ChromeTrace(benchmark::State& state)
+	{
+		Tracer::clear();
+		for (auto i = 0; i < TRACE_BUFFER_EVENTS; i++)
+		{
+			TraceScope scope("benchmark");
+		}
+		for (auto _ : state)
+		{
+			std::stringstream out;
+			Tracer::write_chrome_trace(out);
+			benchmark::DoNotOptimize(out.str());
+		}
+	}
+
+	static void FoldedStacks(benchmark::State& state)
+	{
+		Tracer::clear();
+		for (auto i = 0; i < TRACE_BUFFER_EVENTS; i++)
+		{
+			TraceScope scope("benchmark");
+		}
+		for (auto _ : state)
+		{
+			std::stringstream out;
+			Tracer::write_folded_stacks(out);
+			benchmark::DoNotOptimize(out.str());
+		}
+	}
+
+	BENCHMARK(Scope)->Iterations(1 << 20);
+	BENCHMARK(Now)->Iterations(1 << 20);
+	BENCHMARK(ChromeTrace)->Iterations(1 << 4)->Unit(benchmark::kMillisecond);
+	BENCHMARK(FoldedStacks)->Iterations(1 << 4)->Unit(benchmark::kMillisecond);
+
+	// encryption as instrumented; compare a build with the trace target to one without to see the overhead
+	template <typename VALUE_T>
+	class TraceBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const VALUE_T beta = 1.0 * (1 << 10);
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			srand(TEST_SEED);
+
+			scheme = std::make_unique<Scheme<VALUE_T>>(beta);
+			key	   = scheme->keygen();
+		}
+
+		protected:
+		std::unique_ptr<Scheme<VALUE_T>> scheme;
+		DCPE::key<VALUE_T> key;
+	};
+
+#define B_Encrypt(type)                                                                                          \
+	BENCHMARK_TEMPLATE_DEFINE_F(TraceBenchmark, Encrypt_##type, type)                                            \
+	(benchmark::State & state)                                                                                   \
+	{                                                                                                            \
+		auto dimensions = state.range(0);                                                                        \
+		std::vector<type> message(dimensions), ciphertext(dimensions);                                           \
+		for (auto &&value : message)                                                                             \
+		{                                                                                                        \
+			value = static_cast<type>(rand()) / static_cast<double>(RAND_MAX);                                   \
+		}                                                                                                        \
+		for (auto _ : state)                                                                                     \
+		{                                                                                                        \
+			benchmark::DoNotOptimize(scheme->encrypt(key, TO_ARRAY(message), dimensions, TO_ARRAY(ciphertext))); \
+		}                                                                                                        \
+	}
+
+	B_Encrypt(float);
+	B_Encrypt(double);
+
+#define R_Encrypt(type)                                  \
+	BENCHMARK_REGISTER_F(TraceBenchmark, Encrypt_##type) \
+		->Arg(4)                                         \
+		->Arg(128)                                       \
+		->Iterations(1 << 14)                            \
+		->Unit(benchmark::kMicrosecond);
+
+	R_Encrypt(float);
+	R_Encrypt(double);
+
+}
+BENCHMARK_MAIN();
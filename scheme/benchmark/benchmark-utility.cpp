@@ -26,6 +26,17 @@ namespace DCPE
 		}
 	}
 
+	BENCHMARK_TEMPLATE_DEFINE_F(UtilityBenchmark, RandomBytes, float)
+	(benchmark::State& state)
+	{
+		auto size = state.range(0);
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(get_random_bytes(size));
+		}
+		state.SetBytesProcessed(state.iterations() * size);
+	}
+
 #define B_Uniform(type)                                                 \
 	BENCHMARK_TEMPLATE_DEFINE_F(UtilityBenchmark, Uniform_##type, type) \
 	(benchmark::State & state)                                          \
@@ -60,6 +71,12 @@ namespace DCPE
 		->Iterations(1 << 20)
 		->Unit(benchmark::kMicrosecond);
 
+	BENCHMARK_REGISTER_F(UtilityBenchmark, RandomBytes)
+		->Args({24})
+		->Args({24 << 10})
+		->Iterations(1 << 10)
+		->Unit(benchmark::kMicrosecond);
+
 #define R_Uniform(type)                                    \
 	BENCHMARK_REGISTER_F(UtilityBenchmark, Uniform_##type) \
 		->Iterations(1 << 20)                              \
@@ -0,0 +1,154 @@
+#include "definitions.h"
+#include "scheme.hpp"
+#include "view.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+
+namespace DCPE
+{
+	// change to run all tests from different seed
+	const auto TEST_SEED = 0x13;
+
+	template <typename VALUE_T>
+	class ViewBenchmark : public ::benchmark::Fixture
+	{
+		public:
+		const VALUE_T beta	 = 1.0 * (1 << 10);
+		const int dimensions = 128;
+		const int rows		 = 1 << 12;
+
+		void SetUp(const ::benchmark::State& state)
+		{
+			srand(TEST_SEED);
+
+			scheme = std::make_unique<Scheme<VALUE_T>>(beta);
+			key	   = scheme->keygen();
+
+			std::vector<VALUE_T> message;
+			message.resize(dimensions);
+			ciphertexts.resize(rows * dimensions);
+			nonces.resize(rows);
+			for (auto i = 0; i < rows; i++)
+			{
+				for (auto j = 0; j < dimensions; j++)
+				{
+					message[j] = static_cast<VALUE_T>(rand()) / static_cast<double>(RAND_MAX);
+				}
+				nonces[i] = scheme->encrypt(key, TO_ARRAY(message), dimensions, TO_ARRAY(ciphertexts) + i * dimensions);
+			}
+		}
+
+		protected:
+		std::unique_ptr<Scheme<VALUE_T>> scheme;
+		DCPE::key<VALUE_T> key;
+		std::vector<VALUE_T> ciphertexts;
+		std::vector<std::pair<ull, ull>> nonces;
+	};
+
+	// the baseline: decrypt everything upfront, then read a handful of rows
+#define B_Eager(type)                                                                                                                     \
+	BENCHMARK_TEMPLATE_DEFINE_F(ViewBenchmark, Eager_##type, type)                                                                        \
+	(benchmark::State & state)                                                                                                            \
+	{                                                                                                                                     \
+		auto touched = state.range(0);                                                                                                    \
+		std::vector<type> messages;                                                                                                       \
+		messages.resize(rows * dimensions);                                                                                               \
+		for (auto _ : state)                                                                                                              \
+		{                                                                                                                                 \
+			for (auto i = 0; i < rows; i++)                                                                                               \
+			{                                                                                                                             \
+				scheme->decrypt(key, TO_ARRAY(ciphertexts) + i * dimensions, dimensions, nonces[i], TO_ARRAY(messages) + i * dimensions); \
+			}                                                                                                                             \
+			type sum = 0;                                                                                                                 \
+			for (auto i = 0; i < touched; i++)                                                                                            \
+			{                                                                                                                             \
+				sum += messages[(rand() % rows) * dimensions];                                                                            \
+			}                                                                                                                             \
+			benchmark::DoNotOptimize(sum);                                                                                                \
+		}                                                                                                                                 \
+	}
+
+	B_Eager(float);
+	B_Eager(double);
+
+	// the same access pattern through a lazy view
+#define B_Lazy(type)                                                                                           \
+	BENCHMARK_TEMPLATE_DEFINE_F(ViewBenchmark, Lazy_##type, type)                                              \
+	(benchmark::State & state)                                                                                 \
+	{                                                                                                          \
+		auto touched = state.range(0);                                                                         \
+		for (auto _ : state)                                                                                   \
+		{                                                                                                      \
+			DecryptedView<type> view(*scheme, key, TO_ARRAY(ciphertexts), TO_ARRAY(nonces), rows, dimensions); \
+			type sum = 0;                                                                                      \
+			for (auto i = 0; i < touched; i++)                                                                 \
+			{                                                                                                  \
+				sum += view.at(rand() % rows, 0);                                                              \
+			}                                                                                                  \
+			benchmark::DoNotOptimize(sum);                                                                     \
+		}                                                                                                      \
+	}
+
+	B_Lazy(float);
+	B_Lazy(double);
+
+	// a sequential scan with some work per row; the argument is the prefetch window (0 disables prefetching)
+#define B_Scan(type)                                                                                                             \
+	BENCHMARK_TEMPLATE_DEFINE_F(ViewBenchmark, Scan_##type, type)                                                                \
+	(benchmark::State & state)                                                                                                   \
+	{                                                                                                                            \
+		auto prefetch = state.range(0);                                                                                          \
+		for (auto _ : state)                                                                                                     \
+		{                                                                                                                        \
+			DecryptedView<type> view(*scheme, key, TO_ARRAY(ciphertexts), TO_ARRAY(nonces), rows, dimensions, 1 << 8, prefetch); \
+			type sum = 0;                                                                                                        \
+			for (auto &&row : view.range(0, rows))                                                                               \
+			{                                                                                                                    \
+				for (auto &&value : *row)                                                                                        \
+				{                                                                                                                \
+					sum += std::sqrt(std::abs(value));                                                                           \
+				}                                                                                                                \
+			}                                                                                                                    \
+			benchmark::DoNotOptimize(sum);                                                                                       \
+		}                                                                                                                        \
+		state.SetItemsProcessed(state.iterations() * rows);                                                                      \
+	}
+
+	B_Scan(float);
+	B_Scan(double);
+
+#define R_Eager(type)                                 \
+	BENCHMARK_REGISTER_F(ViewBenchmark, Eager_##type) \
+		->Arg(16)                                     \
+		->Arg(256)                                    \
+		->Iterations(1 << 3)                          \
+		->Unit(benchmark::kMillisecond);
+
+	R_Eager(float);
+	R_Eager(double);
+
+#define R_Lazy(type)                                 \
+	BENCHMARK_REGISTER_F(ViewBenchmark, Lazy_##type) \
+		->Arg(16)                                    \
+		->Arg(256)                                   \
+		->Iterations(1 << 3)                         \
+		->Unit(benchmark::kMillisecond);
+
+	R_Lazy(float);
+	R_Lazy(double);
+
+#define R_Scan(type)                                 \
+	BENCHMARK_REGISTER_F(ViewBenchmark, Scan_##type) \
+		->Arg(0)                                     \
+		->Arg(16)                                    \
+		->Arg(64)                                    \
+		->Iterations(1 << 3)                         \
+		->Unit(benchmark::kMillisecond)              \
+		->UseRealTime();
+
+	R_Scan(float);
+	R_Scan(double);
+
+}
+BENCHMARK_MAIN();
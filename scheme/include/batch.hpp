@@ -0,0 +1,292 @@
+#pragma once
+
+#include "definitions.h"
+#include "scheme.hpp"
+
+#include <cstdlib>
+#include <memory>
+
+/**
+ * @brief the alignment of the rows of a batch in bytes (a cache line, and the width of the widest SIMD registers)
+ */
+#define BATCH_ALIGNMENT 64
+
+namespace DCPE
+{
+	/**
+	 * @brief a non-owning view of consecutive rows of a CiphertextBatch
+	 *
+	 * It is cheap to copy and stays valid for as long as the batch it was taken from is alive and not moved from.
+	 *
+	 */
+	template <typename VALUE_T>
+	class CiphertextSlice
+	{
+		private:
+		VALUE_T* data;
+		std::pair<ull, ull>* nonce_data;
+		size_t rows;
+		int dimensions;
+		size_t stride;
+
+		public:
+		/**
+		 * @brief Construct a new Ciphertext Slice object
+		 *
+		 * @param data the first value of the first row (aligned to BATCH_ALIGNMENT)
+		 * @param nonces the nonce of the first row
+		 * @param rows the number of rows
+		 * @param dimensions the number of dimensions of each row
+		 * @param stride the distance between the starts of two rows in values
+		 */
+		CiphertextSlice(VALUE_T* data, std::pair<ull, ull>* nonces, size_t rows, int dimensions, size_t stride) :
+			data(data),
+			nonce_data(nonces),
+			rows(rows),
+			dimensions(dimensions),
+			stride(stride) {}
+
+		/**
+		 * @brief the ciphertext of a row (aligned to BATCH_ALIGNMENT)
+		 *
+		 * @param row the row index
+		 * @return VALUE_T* the first value of the row
+		 */
+		VALUE_T* row(size_t row) const
+		{
+			return data + row * stride;
+		}
+
+		/**
+		 * @brief the nonce of a row
+		 *
+		 * @param row the row index
+		 * @return std::pair<ull, ull>& the nonce
+		 */
+		std::pair<ull, ull>& nonce(size_t row) const
+		{
+			return nonce_data[row];
+		}
+
+		/**
+		 * @brief the contiguous nonce column
+		 *
+		 * @return std::pair<ull, ull>* the nonce of the first row
+		 */
+		std::pair<ull, ull>* nonces() const
+		{
+			return nonce_data;
+		}
+
+		/**
+		 * @brief a view of a range of rows of this slice
+		 *
+		 * @param first the first row (inclusive)
+		 * @param last the last row (non-inclusive)
+		 * @return CiphertextSlice<VALUE_T> the view
+		 */
+		CiphertextSlice<VALUE_T> slice(size_t first, size_t last) const;
+
+		/**
+		 * @brief writes the rows and nonces in a self-describing format (the padding is left out)
+		 *
+		 * @return bytes the serialized rows
+		 */
+		bytes serialize() const;
+
+		size_t size() const
+		{
+			return rows;
+		}
+
+		int get_dimensions() const
+		{
+			return dimensions;
+		}
+
+		size_t get_stride() const
+		{
+			return stride;
+		}
+	};
+
+	/**
+	 * @brief an owning, fixed-size batch of ciphertexts and their nonces stored as two columns
+	 *
+	 * Rows are padded to a multiple of BATCH_ALIGNMENT bytes and aligned to it, so each row starts on a cache line and SIMD loads never split one.
+	 * The padding is zeroed on allocation, and the distance kernels rely on it staying zero (write only dimensions values per row).
+	 * Nonces are kept in a separate contiguous column, so that scans over the ciphertexts do not pull them into the cache.
+	 *
+	 * The batch is move-only; pass slices around instead of copies.
+	 *
+	 */
+	template <typename VALUE_T>
+	class CiphertextBatch
+	{
+		private:
+		struct Free
+		{
+			void operator()(VALUE_T* data) const
+			{
+				std::free(data);
+			}
+		};
+
+		size_t rows;
+		int dimensions;
+		size_t stride;
+		std::unique_ptr<VALUE_T[], Free> data;
+		std::vector<std::pair<ull, ull>> nonce_data;
+
+		public:
+		/**
+		 * @brief Construct a new Ciphertext Batch object with zero rows and nonces
+		 *
+		 * @param rows the number of rows
+		 * @param dimensions the number of dimensions of each row
+		 */
+		CiphertextBatch(size_t rows, int dimensions);
+
+		CiphertextBatch(CiphertextBatch&& other) noexcept;
+		CiphertextBatch& operator=(CiphertextBatch&& other) noexcept;
+
+		CiphertextBatch(const CiphertextBatch&) = delete;
+		CiphertextBatch& operator=(const CiphertextBatch&) = delete;
+
+		/**
+		 * @brief reads rows written by CiphertextSlice::serialize into a new batch
+		 *
+		 * @param serialized the serialized rows
+		 * @return CiphertextBatch<VALUE_T> the batch
+		 */
+		static CiphertextBatch<VALUE_T> deserialize(const bytes& serialized);
+
+		/**
+		 * @brief the number of values between the starts of two rows for a number of dimensions
+		 *
+		 * @param dimensions the number of dimensions
+		 * @return size_t dimensions rounded up to a multiple of BATCH_ALIGNMENT bytes
+		 */
+		static size_t stride_for(int dimensions);
+
+		VALUE_T* row(size_t row)
+		{
+			return data.get() + row * stride;
+		}
+
+		const VALUE_T* row(size_t row) const
+		{
+			return data.get() + row * stride;
+		}
+
+		std::pair<ull, ull>& nonce(size_t row)
+		{
+			return nonce_data[row];
+		}
+
+		const std::pair<ull, ull>& nonce(size_t row) const
+		{
+			return nonce_data[row];
+		}
+
+		/**
+		 * @brief a view of all rows
+		 *
+		 * @return CiphertextSlice<VALUE_T> the view
+		 */
+		CiphertextSlice<VALUE_T> view();
+
+		/**
+		 * @brief a view of a range of rows
+		 *
+		 * @param first the first row (inclusive)
+		 * @param last the last row (non-inclusive)
+		 * @return CiphertextSlice<VALUE_T> the view
+		 */
+		CiphertextSlice<VALUE_T> slice(size_t first, size_t last);
+
+		size_t size() const
+		{
+			return rows;
+		}
+
+		int get_dimensions() const
+		{
+			return dimensions;
+		}
+
+		size_t get_stride() const
+		{
+			return stride;
+		}
+	};
+
+	/**
+	 * @brief encrypts many vectors under the same key straight into a batch
+	 *
+	 * All nonces are drawn with a single get_random_bytes call, then the rows are encrypted in parallel.
+	 * Each row decrypts with Scheme::decrypt like one encrypted with Scheme::encrypt.
+	 *
+	 * @param scheme the scheme to encrypt with
+	 * @param key a scheme key generated by keygen
+	 * @param messages the vectors to encrypt, one after another (of length out.size() * out.get_dimensions())
+	 * @param out the rows to write the ciphertexts and nonces to
+	 * @param threads the number of threads to use (0 means all the workers plus the caller)
+	 */
+	template <typename VALUE_T>
+	void encrypt_batch(Scheme<VALUE_T>& scheme, key<VALUE_T>& key, const VALUE_T* messages, const CiphertextSlice<VALUE_T>& out, uint threads = 0);
+
+	/**
+	 * @brief decrypts the rows of a batch in parallel
+	 *
+	 * @param scheme the scheme the rows were encrypted with
+	 * @param key the key the rows were encrypted under
+	 * @param batch the rows to decrypt
+	 * @param messages the decrypted vectors, one after another (has to be allocated of length batch.size() * batch.get_dimensions())
+	 * @param threads the number of threads to use (0 means all the workers plus the caller)
+	 */
+	template <typename VALUE_T>
+	void decrypt_batch(Scheme<VALUE_T>& scheme, key<VALUE_T>& key, const CiphertextSlice<VALUE_T>& batch, VALUE_T* messages, uint threads = 0);
+
+	/**
+	 * @brief computes squared Euclidean distance between two rows aligned and zero-padded like those of a CiphertextBatch
+	 *
+	 * \note
+	 * Keeps one partial sum per SIMD lane, so the compiler can vectorize the loop without reordering the additions.
+	 *
+	 * @param first the first row (aligned to BATCH_ALIGNMENT)
+	 * @param second the second row (aligned to BATCH_ALIGNMENT)
+	 * @param stride the length of both rows including the padding (see CiphertextBatch::stride_for)
+	 * @return VALUE_T the squared Euclidean distance
+	 */
+	template <typename VALUE_T>
+	VALUE_T aligned_squared_distance(const VALUE_T* first, const VALUE_T* second, size_t stride);
+
+	/**
+	 * @brief computes the dot product of two rows aligned and zero-padded like those of a CiphertextBatch
+	 *
+	 * \note
+	 * The same kernel as aligned_squared_distance.
+	 *
+	 * @param first the first row (aligned to BATCH_ALIGNMENT)
+	 * @param second the second row (aligned to BATCH_ALIGNMENT)
+	 * @param stride the length of both rows including the padding (see CiphertextBatch::stride_for)
+	 * @return VALUE_T the dot product
+	 */
+	template <typename VALUE_T>
+	VALUE_T aligned_dot_product(const VALUE_T* first, const VALUE_T* second, size_t stride);
+
+	/**
+	 * @brief computes the squared Euclidean distance from the query to each row of a batch
+	 *
+	 * \note
+	 * The rows are aligned and padded with zeros, so the kernel runs over whole SIMD vectors with no remainder loop.
+	 * The query is copied to a padded buffer once to match.
+	 *
+	 * @param batch the rows
+	 * @param query the query (of length batch.get_dimensions())
+	 * @param distances the distances (has to be allocated of length batch.size())
+	 */
+	template <typename VALUE_T>
+	void squared_distances(const CiphertextSlice<VALUE_T>& batch, const VALUE_T* query, VALUE_T* distances);
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <ostream>
+
+namespace DCPE
+{
+	/**
+	 * @brief the workload used to characterize a parameter point
+	 *
+	 */
+	struct CharacterizationConfig
+	{
+		/**
+		 * @brief the number of dimensions of each vector
+		 */
+		int dimensions = 32;
+
+		/**
+		 * @brief the number of vectors in the corpus that queries are run against
+		 */
+		int records = 1000;
+
+		/**
+		 * @brief the number of kNN queries used to measure recall
+		 */
+		int queries = 50;
+
+		/**
+		 * @brief the \f$ k \f$ in recall@k
+		 */
+		int k = 10;
+
+		/**
+		 * @brief the left endpoint of the range of plaintext coordinates
+		 */
+		double min_value = -1000.0;
+
+		/**
+		 * @brief the right endpoint of the range of plaintext coordinates
+		 */
+		double max_value = +1000.0;
+
+		/**
+		 * @brief the seed for generating the corpus and the queries (not the keys)
+		 */
+		ull seed = 0x13;
+	};
+
+	/**
+	 * @brief the measurements taken for a single \f$ (\beta, \text{max}_s) \f$ point
+	 *
+	 */
+	struct CharacterizationResult
+	{
+		/**
+		 * @brief the value type the scheme was instantiated with ("float" or "double")
+		 */
+		std::string type;
+
+		double beta;
+		double max_s;
+
+		/**
+		 * @brief the largest absolute coordinate error after an encrypt-decrypt round trip
+		 */
+		double max_error;
+
+		/**
+		 * @brief the mean absolute coordinate error after an encrypt-decrypt round trip
+		 */
+		double mean_error;
+
+		/**
+		 * @brief the fraction of the plaintext \f$ k \f$ nearest neighbors found by kNN over ciphertexts
+		 */
+		double recall;
+
+		/**
+		 * @brief the number of vectors encrypted per second
+		 */
+		double throughput;
+	};
+
+	/**
+	 * @brief a harness that measures how \f$ \beta \f$ and \f$ \text{max}_s \f$ affect accuracy and performance of the scheme
+	 *
+	 * The corpus, the queries and the plaintext nearest neighbors are generated once in the constructor and shared by all measurements.
+	 *
+	 */
+	template <typename VALUE_T>
+	class Characterization
+	{
+		private:
+		const CharacterizationConfig config;
+
+		std::vector<VALUE_T> records;
+		std::vector<VALUE_T> queries;
+
+		/**
+		 * @brief the plaintext \f$ k \f$ nearest neighbors of each query (config.k entries per query)
+		 */
+		std::vector<int> neighbors;
+
+		/**
+		 * @brief a helper that finds the \f$ k \f$ nearest records to the query by brute force
+		 *
+		 * @param records the records (config.records of them one after another)
+		 * @param query the query vector
+		 * @return vector<int> the indices of the nearest records, the closest first
+		 */
+		std::vector<int> nearest(const std::vector<VALUE_T>& records, const VALUE_T* query);
+
+		public:
+		/**
+		 * @brief Construct a new Characterization object
+		 *
+		 * @param config the workload to measure each parameter point with
+		 */
+		Characterization(CharacterizationConfig config);
+
+		/**
+		 * @brief measures a single parameter point
+		 *
+		 * @param beta the approximation parameter \f$ \beta \f$
+		 * @param max_s the max value of \f$ s \f$
+		 * @return CharacterizationResult the measurements
+		 */
+		CharacterizationResult measure(VALUE_T beta, VALUE_T max_s);
+
+		/**
+		 * @brief measures every combination of the given values, the points are measured in parallel
+		 *
+		 * \note
+		 * Throughput is measured while other points run, so it is only comparable within one sweep.
+		 *
+		 * @param betas the values of \f$ \beta \f$
+		 * @param max_ss the values of \f$ \text{max}_s \f$
+		 * @param threads the number of points measured concurrently (0 means the number of hardware threads)
+		 * @return vector<CharacterizationResult> the measurements in the order of betas, then max_ss
+		 */
+		std::vector<CharacterizationResult> sweep(const std::vector<VALUE_T>& betas, const std::vector<VALUE_T>& max_ss, uint threads = 0);
+	};
+
+	/**
+	 * @brief selects the results that are not dominated by any other result
+	 *
+	 * A result dominates another one if it is at least as good in recall, mean error and throughput, and strictly better in one of them.
+	 *
+	 * @param results the results to select from
+	 * @return vector<CharacterizationResult> the Pareto frontier, in the order of the input
+	 */
+	std::vector<CharacterizationResult> pareto_frontier(const std::vector<CharacterizationResult>& results);
+
+	/**
+	 * @brief prints the results as CSV with a header line
+	 *
+	 * @param output the stream to print to
+	 * @param results the results to print
+	 */
+	void print_results(std::ostream& output, const std::vector<CharacterizationResult>& results);
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "definitions.h"
+#include "store.hpp"
+
+#include <functional>
+
+namespace DCPE
+{
+	/**
+	 * @brief compresses a byte plane, appending it to the output
+	 *
+	 * The plane is stored as a single repeated byte, with an order-0 rANS entropy coder, or raw, whichever is the smallest.
+	 *
+	 * @param plane the bytes to compress
+	 * @param size the number of bytes
+	 * @param out the buffer to append the compressed plane to
+	 */
+	void encode_plane(const byte* plane, size_t size, bytes& out);
+
+	/**
+	 * @brief decompresses a byte plane written by encode_plane
+	 *
+	 * @param data the compressed plane (and possibly what follows it)
+	 * @param size the number of bytes available at data
+	 * @param plane the decompressed bytes (has to be allocated of length count)
+	 * @param count the number of bytes in the plane
+	 * @return size_t the number of bytes of data the plane took
+	 */
+	size_t decode_plane(const byte* data, size_t size, byte* plane, size_t count);
+
+	/**
+	 * @brief the header of a compressed archive
+	 *
+	 */
+	struct ArchiveInfo
+	{
+		int value_size;
+		int dimensions;
+		size_t rows;
+		size_t block_rows;
+		size_t blocks;
+	};
+
+	/**
+	 * @brief a block of decoded records
+	 *
+	 */
+	template <typename VALUE_T>
+	struct ArchiveBlock
+	{
+		/**
+		 * @brief the index of the first row of the block in the archive
+		 */
+		size_t first;
+		size_t rows;
+
+		std::vector<VALUE_T> ciphertexts;
+		std::vector<std::pair<ull, ull>> nonces;
+		std::vector<ull> ids;
+	};
+
+	/**
+	 * @brief a columnar block format for archiving ciphertexts
+	 *
+	 * Rows are grouped in blocks that are compressed and decompressed independently, so blocks can be decoded in parallel.
+	 * Within a block each ciphertext value is XOR-ed with the one above it in the same column,
+	 * which zeroes most of the sign and exponent bits since the values of a column share the key's scale.
+	 * The results are split into byte planes (all first bytes, then all second bytes, etc.) and each plane is entropy coded on its own,
+	 * so the predictable high bytes compress well and the random low bytes fall back to raw.
+	 * Ids are delta-coded and nonces are stored as planes too.
+	 *
+	 * \note
+	 * A block may decode to at most \f$ 2^{16} \f$ values per byte of its encoding, so that a forged archive cannot force huge allocations.
+	 * Real ciphertexts are nowhere near (their random nonces alone take 16 bytes per row); encode rejects blocks of identical rows past it.
+	 *
+	 */
+	template <typename VALUE_T>
+	class ColumnarCodec
+	{
+		private:
+		const int dimensions;
+		const size_t block_rows;
+
+		/**
+		 * @brief a helper that compresses one block
+		 *
+		 * @param ciphertexts the ciphertexts of the block, one row after another
+		 * @param nonces the nonces of the block
+		 * @param ids the ids of the block
+		 * @param rows the number of rows in the block
+		 * @return bytes the compressed block
+		 */
+		bytes encode_block(const VALUE_T* ciphertexts, const std::pair<ull, ull>* nonces, const ull* ids, size_t rows) const;
+
+		/**
+		 * @brief a helper that decompresses one block into the caller's buffers
+		 *
+		 * The public methods read and validate the header once and call this for each block,
+		 * so that decoding a whole archive is linear in the number of blocks.
+		 *
+		 * @param data the compressed block
+		 * @param size the size of the compressed block in bytes
+		 * @param rows the number of rows in the block
+		 * @param ciphertexts the ciphertexts of the block (has to be allocated of length rows * dimensions)
+		 * @param nonces the nonces of the block (has to be allocated of length rows)
+		 * @param ids the ids of the block (has to be allocated of length rows)
+		 */
+		void decode_block(const byte* data, size_t size, size_t rows, VALUE_T* ciphertexts, std::pair<ull, ull>* nonces, ull* ids) const;
+
+		public:
+		/**
+		 * @brief Construct a new Columnar Codec object
+		 *
+		 * @param dimensions the number of dimensions of each ciphertext
+		 * @param block_rows the number of rows in a block
+		 */
+		ColumnarCodec(int dimensions, size_t block_rows = 1 << 12);
+
+		/**
+		 * @brief compresses records into an archive (blocks are compressed in parallel)
+		 *
+		 * @param ciphertexts the ciphertexts, one row after another
+		 * @param nonces the nonce of each row
+		 * @param ids the id of each row
+		 * @param rows the number of rows
+		 * @param threads the max number of threads (0 means all the scheduler's workers plus the caller)
+		 * @return bytes the archive
+		 */
+		bytes encode(const VALUE_T* ciphertexts, const std::pair<ull, ull>* nonces, const ull* ids, size_t rows, uint threads = 0) const;
+
+		/**
+		 * @brief reads and validates the header of an archive
+		 *
+		 * @param archive the archive
+		 * @return ArchiveInfo the header
+		 */
+		static ArchiveInfo inspect(const bytes& archive);
+
+		/**
+		 * @brief decompresses one block of an archive
+		 *
+		 * @param archive the archive
+		 * @param index the index of the block
+		 * @param block the decoded block (its buffers are reused)
+		 */
+		void decode_block(const bytes& archive, size_t index, ArchiveBlock<VALUE_T>& block) const;
+
+		/**
+		 * @brief decompresses the blocks of an archive in parallel and hands each to a consumer as soon as it is decoded
+		 *
+		 * This streams an archive into a search kernel or a store without materializing all of it.
+		 * The consumer is called concurrently from several threads, in no particular order.
+		 *
+		 * @param archive the archive
+		 * @param consumer the function to call with each decoded block
+		 * @param threads the max number of threads (0 means all the scheduler's workers plus the caller)
+		 */
+		void for_each_block(const bytes& archive, const std::function<void(const ArchiveBlock<VALUE_T>&)>& consumer, uint threads = 0) const;
+
+		/**
+		 * @brief decompresses a whole archive in parallel
+		 *
+		 * @param archive the archive
+		 * @param ciphertexts the ciphertexts (has to be allocated of length rows * dimensions)
+		 * @param nonces the nonces (has to be allocated of length rows)
+		 * @param ids the ids (has to be allocated of length rows)
+		 * @param threads the max number of threads (0 means all the scheduler's workers plus the caller)
+		 */
+		void decode(const bytes& archive, VALUE_T* ciphertexts, std::pair<ull, ull>* nonces, ull* ids, uint threads = 0) const;
+
+		/**
+		 * @brief decompresses an archive straight into a store
+		 *
+		 * @param archive the archive
+		 * @param store the store to insert the records into (of the same dimensions)
+		 * @param threads the max number of threads (0 means all the scheduler's workers plus the caller)
+		 */
+		void load(const bytes& archive, EncryptedStore<VALUE_T>& store, uint threads = 0) const;
+	};
+}
@@ -2,6 +2,8 @@
 
 #include <boost/format.hpp>
 #include <climits>
+#include <cstdint>
+#include <cstring>
 #include <openssl/evp.h>
 #include <string>
 #include <vector>
@@ -19,6 +21,110 @@ namespace DCPE
 	template <typename VALUE_T>
 	using key = std::tuple<ull, ull, VALUE_T>;
 
+	/**
+	 * @brief an IEEE 754 half-precision (binary16) value, stored as its raw bits
+	 *
+	 * Only used as a compact input format, there is no arithmetic on it.
+	 *
+	 */
+	struct half
+	{
+		uint16_t bits = 0;
+
+		half() = default;
+
+		/**
+		 * @brief converts a single-precision value, rounding to nearest even
+		 *
+		 * Values out of range become infinities, values too small become (signed) zeros or subnormals.
+		 */
+		explicit half(float value)
+		{
+			uint32_t x;
+			std::memcpy(&x, &value, sizeof(x));
+
+			uint16_t sign	  = (x >> 16) & 0x8000;
+			uint32_t exponent = (x >> 23) & 0xFF;
+			uint32_t mantissa = x & 0x7FFFFF;
+
+			if (exponent == 0xFF)
+			{
+				bits = sign | 0x7C00 | (mantissa ? 0x200 : 0); // infinity or quiet NaN
+				return;
+			}
+
+			int32_t unbiased = (int32_t)exponent - 127 + 15;
+			if (unbiased >= 0x1F)
+			{
+				bits = sign | 0x7C00;
+				return;
+			}
+
+			if (unbiased <= 0)
+			{
+				if (unbiased < -10)
+				{
+					bits = sign;
+					return;
+				}
+				// subnormal: make the implicit bit explicit and shift it into place
+				mantissa |= 0x800000;
+				auto shift	 = (uint32_t)(14 - unbiased);
+				auto rounded = mantissa >> shift;
+				auto rest	 = mantissa & ((1u << shift) - 1);
+				auto halfway = 1u << (shift - 1);
+				if (rest > halfway || (rest == halfway && (rounded & 1)))
+				{
+					rounded++;
+				}
+				bits = sign | (uint16_t)rounded;
+				return;
+			}
+
+			uint32_t result = ((uint32_t)unbiased << 10) | (mantissa >> 13);
+			auto rest		= mantissa & 0x1FFF;
+			if (rest > 0x1000 || (rest == 0x1000 && (result & 1)))
+			{
+				result++; // may carry into the exponent, up to infinity, which is correct
+			}
+			bits = sign | (uint16_t)result;
+		}
+
+		/**
+		 * @brief converts to single precision (exactly)
+		 */
+		operator float() const
+		{
+			uint32_t sign	  = (uint32_t)(bits & 0x8000) << 16;
+			uint32_t exponent = (bits >> 10) & 0x1F;
+			uint32_t mantissa = bits & 0x3FF;
+
+			uint32_t x;
+			if (exponent == 0x1F)
+			{
+				x = sign | 0x7F800000 | (mantissa << 13);
+			}
+			else if (exponent != 0)
+			{
+				x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+			}
+			else if (mantissa == 0)
+			{
+				x = sign;
+			}
+			else
+			{
+				// subnormal: the value is mantissa * 2^-24, which is exact in single precision
+				float value = (float)mantissa * 0x1.0p-24f;
+				return sign ? -value : value;
+			}
+
+			float value;
+			std::memcpy(&value, &x, sizeof(value));
+			return value;
+		}
+	};
+
 	/**
 	 * @brief Primitive exception class that passes along the excpetion message
 	 *
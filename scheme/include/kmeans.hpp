@@ -0,0 +1,131 @@
+#pragma once
+
+#include "batch.hpp"
+#include "definitions.h"
+
+namespace DCPE
+{
+	/**
+	 * @brief mini-batch k-means that consumes rows as a stream and keeps only the centroids
+	 *
+	 * Each update assigns the rows of a mini-batch to their nearest centroids and moves every centroid to the mean of all rows ever assigned to it,
+	 * which is the per-row learning rate \f$ 1 / n_c \f$ of mini-batch k-means (Sculley, 2010) applied a mini-batch at a time.
+	 * Memory is the \f$ k \times d \f$ centroids plus the counts, whatever the number of rows streamed.
+	 *
+	 * The centroids are seeded with k-means++ on the first mini-batch.
+	 *
+	 * DCPE preserves distances up to \f$ \beta \f$ and scales them by \f$ s \f$, so clustering the ciphertexts approximates clustering the plaintexts.
+	 * All rows have to be encrypted under the same key.
+	 *
+	 * \note
+	 * The object is not thread-safe, but each update runs in parallel on the scheduler.
+	 * To cluster an archive, decode its blocks one at a time (ColumnarCodec::decode_block) and feed them in turn;
+	 * do not call update from for_each_block consumers.
+	 *
+	 */
+	template <typename VALUE_T>
+	class StreamingKMeans
+	{
+		private:
+		const int k;
+		const int dimensions;
+		const ull seed;
+
+		/**
+		 * @brief the centroids, a padded row each
+		 */
+		CiphertextBatch<VALUE_T> centroids;
+
+		/**
+		 * @brief the number of rows assigned to each centroid so far
+		 */
+		std::vector<ull> counts;
+
+		size_t seen		 = 0;
+		bool initialized = false;
+
+		/**
+		 * @brief a helper that picks the initial centroids from a mini-batch with k-means++
+		 *
+		 * @param batch the rows to pick from (at least k)
+		 */
+		void seed_centroids(const CiphertextSlice<VALUE_T>& batch);
+
+		public:
+		/**
+		 * @brief Construct a new Streaming KMeans object
+		 *
+		 * @param k the number of clusters
+		 * @param dimensions the number of dimensions of the rows
+		 * @param seed the seed for the k-means++ choices
+		 */
+		StreamingKMeans(int k, int dimensions, ull seed = 0);
+
+		/**
+		 * @brief feeds a mini-batch of rows
+		 *
+		 * Assignment is parallel over the rows and the centroid update is parallel over the centroids.
+		 *
+		 * @param batch the rows (the first mini-batch has to have at least k rows)
+		 * @param threads the number of threads to use (0 means all the workers plus the caller)
+		 */
+		void update(const CiphertextSlice<VALUE_T>& batch, uint threads = 0);
+
+		/**
+		 * @brief feeds rows stored one after another (as in ArchiveBlock or Segment), copying them to padded rows a mini-batch at a time
+		 *
+		 * @param rows the rows (of length count * dimensions)
+		 * @param count the number of rows
+		 * @param batch_rows the number of rows per mini-batch
+		 * @param threads the number of threads to use (0 means all the workers plus the caller)
+		 */
+		void update(const VALUE_T* rows, size_t count, size_t batch_rows = 1 << 10, uint threads = 0);
+
+		/**
+		 * @brief assigns rows to their nearest centroids
+		 *
+		 * @param batch the rows
+		 * @param labels the index of the nearest centroid of each row (has to be allocated of length batch.size())
+		 * @param distances the squared distance to it (nullptr, or allocated of length batch.size())
+		 * @param threads the number of threads to use (0 means all the workers plus the caller)
+		 */
+		void assign(const CiphertextSlice<VALUE_T>& batch, int* labels, VALUE_T* distances = nullptr, uint threads = 0) const;
+
+		/**
+		 * @brief the sum of squared distances from rows to their nearest centroids
+		 *
+		 * @param batch the rows
+		 * @param threads the number of threads to use (0 means all the workers plus the caller)
+		 * @return double the inertia
+		 */
+		double inertia(const CiphertextSlice<VALUE_T>& batch, uint threads = 0) const;
+
+		/**
+		 * @brief a centroid
+		 *
+		 * @param cluster the index of the cluster
+		 * @return const VALUE_T* the centroid (of length dimensions, aligned and padded like a CiphertextBatch row)
+		 */
+		const VALUE_T* centroid(int cluster) const;
+
+		/**
+		 * @brief the number of rows assigned to a cluster over all updates
+		 *
+		 * @param cluster the index of the cluster
+		 * @return ull the number of rows
+		 */
+		ull count(int cluster) const;
+
+		/**
+		 * @brief the number of rows fed so far
+		 *
+		 * @return size_t the number of rows
+		 */
+		size_t get_seen() const;
+
+		int get_k() const
+		{
+			return k;
+		}
+	};
+}
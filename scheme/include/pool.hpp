@@ -0,0 +1,123 @@
+#pragma once
+
+#include "definitions.h"
+#include "scheme.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace DCPE
+{
+	/**
+	 * @brief a pool of precomputed \f$ (\text{nonce}, \lambda_m) \f$ pairs for one key and dimension, kept filled by background threads
+	 *
+	 * \f$ \lambda_m \f$ does not depend on the message, so it can be computed before the message arrives.
+	 * Encryption with the pool is then a single multiply-add pass over the message.
+	 *
+	 * The pool holds at most capacity pairs in a ring of slots.
+	 * Pairs are swapped into and out of the slots, so the lock is only held for constant work;
+	 * computing \f$ \lambda_m \f$ and the multiply-add of encryption run outside of it, and concurrent encryptions overlap.
+	 * Refilling starts when the pool drops below the low watermark and stops once it reaches the high one,
+	 * so the fillers work in bursts rather than waking up on every encryption.
+	 * If the pool is empty, encryption falls back to computing \f$ \lambda_m \f$ on demand (a miss).
+	 *
+	 */
+	template <typename VALUE_T>
+	class NoisePool
+	{
+		private:
+		Scheme<VALUE_T>& scheme;
+		DCPE::key<VALUE_T> key;
+		const int dimensions;
+		const size_t capacity;
+		const size_t low_watermark;
+		const size_t high_watermark;
+
+		std::vector<std::vector<VALUE_T>> lambdas;
+		std::vector<std::pair<ull, ull>> nonces;
+		size_t head = 0; // the slot to fill next
+		size_t size = 0;
+
+		std::mutex mutex;
+		std::condition_variable refill;
+		bool refilling = false;
+		bool stopping  = false;
+		std::vector<std::thread> fillers;
+
+		size_t hits	  = 0;
+		size_t misses = 0;
+
+		/**
+		 * @brief the body of a filler thread
+		 */
+		void fill_loop();
+
+		/**
+		 * @brief a helper that computes a fresh pair and adds it to the pool, unless the pool is full
+		 *
+		 * @param nonce scratch space for the nonce
+		 * @param lambda_m scratch space for \f$ \lambda_m \f$ (swapped with the slot it goes to)
+		 * @return true if the pair was added
+		 */
+		bool produce(std::pair<ull, ull>& nonce, std::vector<VALUE_T>& lambda_m);
+
+		public:
+		/**
+		 * @brief Construct a new Noise Pool object and start the filler threads
+		 *
+		 * The pool starts empty, call fill to have it full before the first encryption.
+		 *
+		 * @param scheme the scheme to encrypt with
+		 * @param key the key to encrypt under
+		 * @param dimensions the number of dimensions of the messages
+		 * @param capacity the max number of precomputed pairs
+		 * @param low_watermark refilling starts when fewer pairs than this are left (0 means a quarter of capacity)
+		 * @param high_watermark refilling stops when this many pairs are ready (0 means capacity)
+		 * @param threads the number of filler threads
+		 */
+		NoisePool(Scheme<VALUE_T>& scheme, const DCPE::key<VALUE_T>& key, int dimensions, size_t capacity = 1 << 10, size_t low_watermark = 0, size_t high_watermark = 0, uint threads = 1);
+
+		~NoisePool();
+
+		NoisePool(const NoisePool&) = delete;
+		NoisePool& operator=(const NoisePool&) = delete;
+
+		/**
+		 * @brief encrypts the vector with a precomputed pair (or a fresh one if the pool is empty)
+		 *
+		 * The result is the same as that of Scheme::encrypt and decrypts with Scheme::decrypt.
+		 *
+		 * @param message a user-supplied vector to encrypt (of length dimensions)
+		 * @param ciphertext the encrypted vector (has to be allocated of length dimensions)
+		 * @return std::pair<ull, ull> the nonce used in encryption
+		 */
+		std::pair<ull, ull> encrypt(const VALUE_T* message, VALUE_T* ciphertext);
+
+		/**
+		 * @brief fills the pool to capacity on the calling thread
+		 */
+		void fill();
+
+		/**
+		 * @brief the number of precomputed pairs ready
+		 *
+		 * @return size_t the number of pairs
+		 */
+		size_t available();
+
+		/**
+		 * @brief the number of encryptions served from the pool
+		 *
+		 * @return size_t the number of hits
+		 */
+		size_t get_hits();
+
+		/**
+		 * @brief the number of encryptions that found the pool empty
+		 *
+		 * @return size_t the number of misses
+		 */
+		size_t get_misses();
+	};
+}
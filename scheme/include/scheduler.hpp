@@ -0,0 +1,197 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace DCPE
+{
+	/**
+	 * @brief a pool of worker threads with one task deque each, where idle workers steal from the busy ones
+	 *
+	 * A worker pushes and pops its own tasks at the back of its deque (most recent first, so nested work stays cache-hot)
+	 * and steals from the front of the others (oldest first, so a steal takes the largest piece of work).
+	 * Victims on the worker's own NUMA node are tried before remote ones.
+	 * Tasks submitted from outside the pool are spread round-robin.
+	 *
+	 * One scheduler (global) is shared by every parallel operation of the library,
+	 * and the embedding application may submit its own tasks to it too.
+	 *
+	 */
+	class Scheduler
+	{
+		public:
+		using Task = std::function<void()>;
+
+		private:
+		struct Worker
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+			std::thread thread;
+
+			/**
+			 * @brief the NUMA node of the CPU the worker is pinned to
+			 */
+			int node = 0;
+
+			/**
+			 * @brief the other workers in the order to steal from them, same node first
+			 */
+			std::vector<size_t> victims;
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers;
+
+		/**
+		 * @brief the number of tasks waiting in all the deques
+		 */
+		std::atomic<size_t> pending = 0;
+		std::atomic<size_t> next	= 0;
+		std::atomic<bool> stopping	= false;
+
+		std::mutex sleep_mutex;
+		std::condition_variable wake;
+
+		/**
+		 * @brief the body of a worker thread
+		 *
+		 * @param index the index of the worker
+		 */
+		void work(size_t index);
+
+		/**
+		 * @brief a helper that takes a task from the back of the worker's own deque or, failing that, steals one
+		 *
+		 * @param index the index of the worker looking for work (or workers.size() for a thread outside the pool)
+		 * @param task the task taken
+		 * @return true if a task was taken
+		 */
+		bool take(size_t index, Task& task);
+
+		/**
+		 * @brief the index of the calling thread's worker in this scheduler, or workers.size() if it is not one of them
+		 */
+		size_t current() const;
+
+		public:
+		/**
+		 * @brief Construct a new Scheduler object and start the workers
+		 *
+		 * @param threads the number of workers (0 means the number of CPUs the process may run on)
+		 * @param pin whether to pin each worker to a CPU, spreading the workers over the NUMA nodes
+		 */
+		Scheduler(uint threads = 0, bool pin = true);
+
+		/**
+		 * @brief runs the remaining tasks and stops the workers
+		 */
+		~Scheduler();
+
+		Scheduler(const Scheduler&) = delete;
+		Scheduler& operator=(const Scheduler&) = delete;
+
+		/**
+		 * @brief queues a task (the caller has to catch its exceptions, TaskGroup does that)
+		 *
+		 * @param task the task to run
+		 */
+		void submit(Task task);
+
+		/**
+		 * @brief runs one queued task on the calling thread, if there is any
+		 *
+		 * This is how a thread waiting for tasks helps the pool instead of blocking it.
+		 *
+		 * @return true if a task was run
+		 */
+		bool run_one();
+
+		/**
+		 * @brief the number of worker threads
+		 *
+		 * @return uint the number of workers
+		 */
+		uint size() const;
+
+		/**
+		 * @brief the NUMA node a worker is pinned to (0 if the machine has a single node or pinning is off)
+		 *
+		 * @param worker the index of the worker
+		 * @return int the node
+		 */
+		int node_of(uint worker) const;
+
+		/**
+		 * @brief the scheduler shared by the library and the embedding application, started on first use
+		 *
+		 * @return Scheduler& the shared scheduler
+		 */
+		static Scheduler& global();
+
+		/**
+		 * @brief sets the number of workers of the shared scheduler
+		 *
+		 * Has to be called before the first use of global().
+		 *
+		 * @param threads the number of workers (0 means the number of CPUs the process may run on)
+		 * @param pin whether to pin the workers
+		 */
+		static void configure_global(uint threads, bool pin = true);
+	};
+
+	/**
+	 * @brief a set of tasks that can be waited for together
+	 *
+	 * The first exception thrown by a task is rethrown by wait.
+	 * While waiting, the calling thread runs queued tasks, so groups may be nested inside tasks without starving the pool.
+	 *
+	 */
+	class TaskGroup
+	{
+		private:
+		Scheduler& scheduler;
+
+		std::atomic<size_t> remaining = 0;
+		std::mutex mutex;
+		std::condition_variable done;
+		std::exception_ptr error = nullptr;
+
+		public:
+		/**
+		 * @brief Construct a new Task Group object
+		 *
+		 * @param scheduler the scheduler to run the tasks on
+		 */
+		TaskGroup(Scheduler& scheduler = Scheduler::global());
+
+		/**
+		 * @brief waits for the tasks still running (discarding their exceptions)
+		 */
+		~TaskGroup();
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		/**
+		 * @brief submits a task as part of the group
+		 *
+		 * @param task the task to run
+		 */
+		void run(Scheduler::Task task);
+
+		/**
+		 * @brief waits for all tasks of the group, running queued tasks meanwhile
+		 *
+		 * Rethrows the first exception thrown by a task.
+		 */
+		void wait();
+	};
+}
@@ -26,9 +26,19 @@ namespace DCPE
 		 */
 		VALUE_T max_s = 1000.0;
 
+		/**
+		 * @brief The min value of \f$ s \f$ part of the key
+		 *
+		 */
+		const VALUE_T min_s = 0.000001;
+
+		public:
 		/**
 		 * @brief a helper that computes \f$ \lambda_m \f$ value
 		 *
+		 * It is the part of encryption and decryption that does not depend on the message,
+		 * so it can be computed ahead of time once the nonce is known.
+		 *
 		 * @param key<VALUE_T> a scheme key
 		 * @param nonce a nonce generated during encryption
 		 * @param dimensions the number of dimensions of the message/ciphertext
@@ -36,7 +46,6 @@ namespace DCPE
 		 */
 		std::vector<VALUE_T> compute_lambda_m(key<VALUE_T>& key, std::pair<ull, ull>& nonce, int dimensions);
 
-		public:
 		/**
 		 * @brief Construct a new Scheme object
 		 *
@@ -51,6 +60,19 @@ namespace DCPE
 		 */
 		key<VALUE_T> keygen();
 
+		/**
+		 * @brief generate many fresh keys at once
+		 *
+		 * Unlike keygen, which seeds a generator for each \f$ s \f$, this draws the randomness for all keys with a single get_random_bytes call
+		 * and maps it to \f$ s \f$ values directly.
+		 * The conversion is split across threads.
+		 *
+		 * @param n the number of keys to generate
+		 * @param out the generated keys (has to be allocated of length n)
+		 * @param threads the number of threads to use (0 means the number of hardware threads)
+		 */
+		void keygen_batch(size_t n, key<VALUE_T>* out, uint threads = 0);
+
 		/**
 		 * @brief encrypts the vector under given key
 		 *
@@ -62,6 +84,26 @@ namespace DCPE
 		 */
 		std::pair<ull, ull> encrypt(key<VALUE_T>& key, const VALUE_T* message, int dimensions, VALUE_T* ciphertext);
 
+		/**
+		 * @brief encrypts a quantized vector under given key, dequantizing it within the encryption loop
+		 *
+		 * The encrypted value of each coordinate is \f$ m_i = \text{scale} \cdot q_i + \text{offset} \f$,
+		 * so the result decrypts (with decrypt) to the dequantized vector without it ever being materialized.
+		 *
+		 * \note
+		 * Instantiated for int8_t, uint8_t and half inputs.
+		 *
+		 * @param key<VALUE_T> a scheme key generated by keygen
+		 * @param message a user-supplied quantized vector to encrypt (pointer to start)
+		 * @param dimensions the number of dimensions of the vector
+		 * @param ciphertext the encrypted vector (has to be allocated of length dimensions)
+		 * @param scale the quantization step
+		 * @param offset the value that the quantized zero stands for
+		 * @return bytes the nonce used in encryption
+		 */
+		template <typename INPUT_T>
+		std::pair<ull, ull> encrypt(key<VALUE_T>& key, const INPUT_T* message, int dimensions, VALUE_T* ciphertext, VALUE_T scale, VALUE_T offset = 0.0);
+
 		/**
 		 * @brief decrypts the encrypted vector under given key
 		 *
@@ -73,6 +115,30 @@ namespace DCPE
 		 */
 		void decrypt(key<VALUE_T>& key, const VALUE_T* ciphertext, int dimensions, std::pair<ull, ull>& nonce, VALUE_T* message);
 
+		/**
+		 * @brief the radius in ciphertext space that contains every record within a radius in plaintext space
+		 *
+		 * A ciphertext is \f$ s \cdot m + \lambda_m \f$ with \f$ \| \lambda_m \| \le s \beta / 4 \f$,
+		 * so the distance between two ciphertexts differs from \f$ s \f$ times the plaintext distance by at most \f$ s \beta / 2 \f$.
+		 * Searching with this radius never misses a match, but may return records up to \f$ \beta \f$ farther than the radius.
+		 *
+		 * @param key<VALUE_T> the key the records and the query were encrypted under
+		 * @param radius the radius in plaintext space
+		 * @return VALUE_T \f$ s \cdot r + s \beta / 2 \f$
+		 */
+		VALUE_T ciphertext_radius(const key<VALUE_T>& key, VALUE_T radius) const;
+
+		/**
+		 * @brief the radius in ciphertext space within which every record is within a radius in plaintext space
+		 *
+		 * Results of a radius search closer than this are certain matches, the rest need decrypting to be sure.
+		 *
+		 * @param key<VALUE_T> the key the records and the query were encrypted under
+		 * @param radius the radius in plaintext space
+		 * @return VALUE_T \f$ s \cdot r - s \beta / 2 \f$, or 0 if that is negative
+		 */
+		VALUE_T certain_radius(const key<VALUE_T>& key, VALUE_T radius) const;
+
 		/**
 		 * @brief Set the max value of \f$ s \f$
 		 *
@@ -0,0 +1,364 @@
+#pragma once
+
+#include "definitions.h"
+#include "store.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace DCPE
+{
+	/**
+	 * @brief a connection to a single shard worker that carries opaque request and response messages
+	 *
+	 * Responses come back in the order the requests were sent, so several requests can be in flight at once.
+	 * One thread may send while another receives, but the caller serializes sends, and receives.
+	 *
+	 */
+	class Transport
+	{
+		public:
+		virtual ~Transport() = default;
+
+		/**
+		 * @brief sends a request to the shard worker without waiting for the response
+		 *
+		 * @param request the encoded request
+		 */
+		virtual void send(const bytes& request) = 0;
+
+		/**
+		 * @brief waits for the response to the oldest request that has not been answered yet
+		 *
+		 * @return bytes the encoded response
+		 */
+		virtual bytes receive() = 0;
+	};
+
+	/**
+	 * @brief the server side of a shard: an encrypted store that executes encoded requests
+	 *
+	 */
+	template <typename VALUE_T>
+	class ShardWorker
+	{
+		private:
+		EncryptedStore<VALUE_T> store;
+
+		public:
+		/**
+		 * @brief Construct a new Shard Worker object
+		 *
+		 * @param dimensions the number of dimensions of each ciphertext
+		 * @param segment_capacity the number of rows in a segment of the underlying store
+		 */
+		ShardWorker(int dimensions, size_t segment_capacity = 1 << 14);
+
+		/**
+		 * @brief executes a request against the store
+		 *
+		 * Errors are reported in the response, so that the client can rethrow them.
+		 *
+		 * @param request the encoded request
+		 * @return bytes the encoded response
+		 */
+		bytes handle(const bytes& request);
+	};
+
+	/**
+	 * @brief a transport to a worker living in the same process, served by its own threads
+	 *
+	 * With several threads, requests in flight are handled concurrently and their responses are still returned in order.
+	 *
+	 */
+	template <typename VALUE_T>
+	class InProcessTransport : public Transport
+	{
+		private:
+		ShardWorker<VALUE_T> worker;
+
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<bytes> requests;
+		bool stopping = false;
+
+		/**
+		 * @brief the number of requests taken by the server threads so far
+		 */
+		ull taken = 0;
+
+		/**
+		 * @brief the responses handled but not received yet, by request number
+		 */
+		std::map<ull, bytes> responses;
+
+		/**
+		 * @brief the number of the next response to receive
+		 */
+		ull delivered = 0;
+
+		std::vector<std::thread> servers;
+
+		/**
+		 * @brief the body of the threads that serve the requests
+		 */
+		void serve();
+
+		public:
+		/**
+		 * @brief Construct a new In Process Transport object with a fresh worker
+		 *
+		 * @param dimensions the number of dimensions of each ciphertext
+		 * @param segment_capacity the number of rows in a segment of the underlying store
+		 * @param threads the number of threads serving the requests
+		 */
+		InProcessTransport(int dimensions, size_t segment_capacity = 1 << 14, uint threads = 1);
+
+		~InProcessTransport();
+
+		void send(const bytes& request) override;
+		bytes receive() override;
+	};
+
+	/**
+	 * @brief a transport to a worker listening on a Unix domain socket
+	 *
+	 */
+	class UnixSocketTransport : public Transport
+	{
+		private:
+		int connection;
+
+		public:
+		/**
+		 * @brief Construct a new Unix Socket Transport object and connect to the worker
+		 *
+		 * @param path the path of the socket the worker listens on
+		 * @param timeout_ms how long to keep retrying while the worker is starting up
+		 */
+		UnixSocketTransport(const std::string& path, int timeout_ms = 5000);
+
+		~UnixSocketTransport();
+
+		UnixSocketTransport(const UnixSocketTransport&) = delete;
+		UnixSocketTransport& operator=(const UnixSocketTransport&) = delete;
+
+		void send(const bytes& request) override;
+		bytes receive() override;
+	};
+
+	/**
+	 * @brief serves a shard worker on a Unix domain socket, one thread per connection
+	 *
+	 */
+	template <typename VALUE_T>
+	class ShardServer
+	{
+		private:
+		const std::string path;
+		ShardWorker<VALUE_T> worker;
+
+		int listener;
+		std::atomic<bool> stopping = false;
+
+		std::thread acceptor;
+		std::mutex connections_mutex;
+		std::vector<int> connections;
+		std::vector<std::thread> handlers;
+		std::vector<std::thread::id> finished;
+
+		/**
+		 * @brief a helper that joins the handlers of clients that have disconnected (connections_mutex must be held)
+		 *
+		 */
+		void reap_handlers();
+
+		/**
+		 * @brief a helper that answers the requests of one client until it disconnects
+		 *
+		 * @param connection the connected socket
+		 */
+		void handle_connection(int connection);
+
+		public:
+		/**
+		 * @brief Construct a new Shard Server object and start listening
+		 *
+		 * @param path the path of the socket to listen on (an existing file is replaced)
+		 * @param dimensions the number of dimensions of each ciphertext
+		 * @param segment_capacity the number of rows in a segment of the underlying store
+		 */
+		ShardServer(const std::string& path, int dimensions, size_t segment_capacity = 1 << 14);
+
+		/**
+		 * @brief stops accepting, disconnects the clients and removes the socket file
+		 */
+		~ShardServer();
+
+		/**
+		 * @brief accepts clients until the server is destroyed (blocks)
+		 */
+		void serve();
+
+		/**
+		 * @brief accepts clients in a background thread
+		 */
+		void start();
+
+		/**
+		 * @brief the number of handler threads not yet joined (those of gone clients are joined when the next client connects)
+		 *
+		 * @return size_t the number of handler threads
+		 */
+		size_t handler_count();
+	};
+
+	/**
+	 * @brief a shard server running in a forked child process
+	 *
+	 */
+	template <typename VALUE_T>
+	class ShardProcess
+	{
+		private:
+		const std::string path;
+		int pid;
+
+		public:
+		/**
+		 * @brief forks a child process that serves a fresh shard worker
+		 *
+		 * @param path the path of the socket the child listens on
+		 * @param dimensions the number of dimensions of each ciphertext
+		 * @param segment_capacity the number of rows in a segment of the underlying store
+		 */
+		ShardProcess(const std::string& path, int dimensions, size_t segment_capacity = 1 << 14);
+
+		/**
+		 * @brief terminates the child process and waits for it
+		 */
+		~ShardProcess();
+
+		ShardProcess(const ShardProcess&) = delete;
+		ShardProcess& operator=(const ShardProcess&) = delete;
+	};
+
+	/**
+	 * @brief an encrypted store partitioned across shard workers
+	 *
+	 * Records are assigned to shards by a hash of their id.
+	 * A search is sent to every shard before waiting for any response, so the shards scan in parallel, then the results are merged.
+	 *
+	 * The store is thread-safe.
+	 * Each shard hands out tickets to the requests sent to it and its responses are received in ticket order,
+	 * so a caller holds a shard only while sending or while receiving its own response, and requests of several callers overlap.
+	 *
+	 */
+	template <typename VALUE_T>
+	class ShardedStore
+	{
+		private:
+		const int dimensions;
+		std::vector<std::unique_ptr<Transport>> shards;
+
+		/**
+		 * @brief the ordering of the requests in flight on one shard
+		 */
+		struct Channel
+		{
+			std::mutex send_mutex;
+			std::mutex receive_mutex;
+			std::condition_variable turn;
+
+			/**
+			 * @brief the tickets of the requests sent, and of the responses received (under their mutexes)
+			 */
+			ull sent = 0, received = 0;
+		};
+
+		std::vector<std::unique_ptr<Channel>> channels;
+
+		/**
+		 * @brief a helper that sends a request to a shard
+		 *
+		 * @param shard the index of the shard
+		 * @param request the encoded request
+		 * @return ull the ticket to receive the response with
+		 */
+		ull send(size_t shard, const bytes& request);
+
+		/**
+		 * @brief a helper that waits for the turn of a ticket and receives its response
+		 *
+		 * Every ticket has to be received, or the later ones wait forever.
+		 *
+		 * @param shard the index of the shard
+		 * @param ticket the ticket returned by send
+		 * @return bytes the encoded response (errors not unwrapped)
+		 */
+		bytes receive(size_t shard, ull ticket);
+
+		/**
+		 * @brief a helper that sends one request and waits for its response
+		 *
+		 * @param shard the index of the shard
+		 * @param request the encoded request
+		 * @return bytes the encoded response (errors rethrown)
+		 */
+		bytes call(size_t shard, const bytes& request);
+
+		public:
+		/**
+		 * @brief Construct a new Sharded Store object
+		 *
+		 * @param dimensions the number of dimensions of each ciphertext
+		 * @param shards the transports to the shard workers
+		 */
+		ShardedStore(int dimensions, std::vector<std::unique_ptr<Transport>> shards);
+
+		/**
+		 * @brief the shard a record belongs to
+		 *
+		 * @param id the record id
+		 * @return size_t the index of the shard
+		 */
+		size_t shard_of(ull id) const;
+
+		/**
+		 * @brief adds a record to its shard, replacing the record with the same id if there is one
+		 *
+		 * @param id the record id
+		 * @param ciphertext the encrypted vector (of length dimensions)
+		 * @param nonce the nonce returned by encryption
+		 */
+		void insert(ull id, const VALUE_T* ciphertext, const std::pair<ull, ull>& nonce);
+
+		/**
+		 * @brief deletes a record from its shard
+		 *
+		 * @param id the record id
+		 * @return true if the record existed
+		 */
+		bool remove(ull id);
+
+		/**
+		 * @brief finds the \f$ k \f$ records closest to the query across all shards
+		 *
+		 * @param query the encrypted query (of length dimensions)
+		 * @param k the number of results
+		 * @return vector<Neighbor<VALUE_T>> the results, closest first
+		 */
+		std::vector<Neighbor<VALUE_T>> search(const VALUE_T* query, const int k);
+
+		/**
+		 * @brief the number of live records across all shards
+		 *
+		 * @return size_t the number of records
+		 */
+		size_t size();
+	};
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "batch.hpp"
+#include "definitions.h"
+#include "store.hpp"
+
+namespace DCPE
+{
+	/**
+	 * @brief what a SketchFilter keeps for each row
+	 *
+	 */
+	enum class SketchKind
+	{
+		/**
+		 * @brief the signs of the projections, one bit each, compared by Hamming distance
+		 */
+		Signs,
+
+		/**
+		 * @brief the projections themselves, compared by squared Euclidean distance
+		 */
+		Projections
+	};
+
+	/**
+	 * @brief a prefilter for kNN over a batch of ciphertexts that scans low-dimensional random-projection sketches first
+	 *
+	 * Each row \f$ c \f$ is sketched as \f$ P (c - \mu) \f$, where \f$ P \f$ is a random Gaussian matrix of width rows and \f$ \mu \f$ is the mean row.
+	 * Projections roughly preserve Euclidean distances (Johnson-Lindenstrauss); signs preserve angles around \f$ \mu \f$,
+	 * so the Hamming distance between two sign sketches grows with the distance between the rows.
+	 * A search picks the candidates with the closest sketches and computes the full-dimension distances only for those.
+	 *
+	 * Ciphertexts are the plaintexts scaled by \f$ s \f$ plus noise, so the sketches work on them as on plaintexts, with the noise (that is, \f$ \beta \f$) costing some recall.
+	 *
+	 * \note
+	 * The filter refers to the rows of the batch, which has to outlive it.
+	 *
+	 */
+	template <typename VALUE_T>
+	class SketchFilter
+	{
+		private:
+		const CiphertextSlice<VALUE_T> batch;
+		const SketchKind kind;
+		const int width;
+
+		/**
+		 * @brief the projection matrix \f$ P \f$, a row per sketch coordinate (padded like the rows of the batch)
+		 */
+		CiphertextBatch<VALUE_T> projection;
+
+		/**
+		 * @brief \f$ P \mu \f$
+		 */
+		std::vector<VALUE_T> offset;
+
+		/**
+		 * @brief the sign sketches, width / 64 words per row (for SketchKind::Signs)
+		 */
+		std::vector<uint64_t> signs;
+
+		/**
+		 * @brief the projection sketches (for SketchKind::Projections)
+		 */
+		CiphertextBatch<VALUE_T> projections;
+
+		/**
+		 * @brief a view of projections for the (const) search path
+		 */
+		CiphertextSlice<VALUE_T> projected_rows;
+
+		/**
+		 * @brief a helper that computes \f$ P (c - \mu) \f$
+		 *
+		 * @param row the row, padded to the stride of the batch
+		 * @param out the projections (has to be allocated of length width)
+		 */
+		void project(const VALUE_T* row, VALUE_T* out) const;
+
+		/**
+		 * @brief a helper that packs the signs of the projections into words
+		 *
+		 * @param projected the projections (of length width)
+		 * @param out the sign bits (has to be allocated of length width / 64)
+		 */
+		void pack(const VALUE_T* projected, uint64_t* out) const;
+
+		public:
+		/**
+		 * @brief Construct a new Sketch Filter object, sketching all rows of the batch
+		 *
+		 * @param batch the rows to index
+		 * @param kind what to keep for each row
+		 * @param width the number of projections per row (a multiple of 64 for SketchKind::Signs)
+		 * @param seed the seed for the projection matrix
+		 * @param threads the number of threads to use (0 means all the workers plus the caller)
+		 */
+		SketchFilter(const CiphertextSlice<VALUE_T>& batch, SketchKind kind = SketchKind::Signs, int width = 256, ull seed = 0, uint threads = 0);
+
+		/**
+		 * @brief the rows whose sketches are the closest to that of the query
+		 *
+		 * Sign sketches are ranked with a histogram of Hamming distances, so the cost is linear in the number of rows.
+		 *
+		 * @param query the encrypted query (of length dimensions)
+		 * @param candidates the number of rows to return
+		 * @return vector<size_t> the row indices, in no particular order
+		 */
+		std::vector<size_t> prefilter(const VALUE_T* query, size_t candidates) const;
+
+		/**
+		 * @brief finds the \f$ k \f$ rows closest to the query among the candidates of prefilter
+		 *
+		 * With candidates equal to the number of rows, the result is that of a full scan.
+		 *
+		 * @param query the encrypted query (of length dimensions)
+		 * @param k the number of results
+		 * @param candidates the number of rows whose full-dimension distance is computed
+		 * @return vector<Neighbor<VALUE_T>> the results (ids are row indices), closest first
+		 */
+		std::vector<Neighbor<VALUE_T>> search(const VALUE_T* query, const int k, size_t candidates) const;
+
+		/**
+		 * @brief the memory taken by the sketches
+		 *
+		 * @return size_t the number of bytes
+		 */
+		size_t sketch_bytes() const;
+	};
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace DCPE
+{
+	/**
+	 * @brief a search result: the record id and its squared distance to the query in ciphertext space
+	 *
+	 */
+	template <typename VALUE_T>
+	struct Neighbor
+	{
+		ull id;
+		VALUE_T distance;
+
+		bool operator<(const Neighbor& other) const
+		{
+			return distance < other.distance || (distance == other.distance && id < other.id);
+		}
+	};
+
+	/**
+	 * @brief merges several sorted result lists into the overall \f$ k \f$ closest
+	 *
+	 * @param results the lists of results, each sorted closest first
+	 * @param k the number of results to keep
+	 * @return vector<Neighbor<VALUE_T>> the merged results, closest first
+	 */
+	template <typename VALUE_T>
+	std::vector<Neighbor<VALUE_T>> merge_neighbors(const std::vector<std::vector<Neighbor<VALUE_T>>>& results, const int k);
+
+	/**
+	 * @brief an append-only block of records
+	 *
+	 * Rows are written once by the store and published by incrementing size, so readers only ever see complete rows.
+	 * Deletes set a bit in the tombstone bitmap and never move data.
+	 *
+	 */
+	template <typename VALUE_T>
+	struct Segment
+	{
+		const int dimensions;
+		const size_t capacity;
+
+		std::vector<VALUE_T> ciphertexts;
+		std::vector<std::pair<ull, ull>> nonces;
+		std::vector<ull> ids;
+		std::unique_ptr<std::atomic<ull>[]> tombstones;
+
+		/**
+		 * @brief the number of published rows
+		 */
+		std::atomic<size_t> size = 0;
+
+		/**
+		 * @brief the number of published rows that are tombstoned
+		 */
+		std::atomic<size_t> deleted = 0;
+
+		Segment(int dimensions, size_t capacity);
+
+		/**
+		 * @brief checks the tombstone bit of a row
+		 *
+		 * @param row the row index
+		 * @return true if the row is deleted
+		 */
+		bool is_deleted(size_t row) const;
+
+		/**
+		 * @brief sets the tombstone bit of a row
+		 *
+		 * @param row the row index
+		 * @return true if the row was not deleted before
+		 */
+		bool mark_deleted(size_t row);
+	};
+
+	/**
+	 * @brief a mutable store of ciphertexts supporting inserts, deletes and kNN search
+	 *
+	 * Records are appended to the active segment; once it is full it is sealed and a new one is started.
+	 * Searches work on an immutable snapshot of the segment list and never take the writer lock.
+	 * Sealed segments with many tombstones are rewritten by a background compaction thread.
+	 *
+	 * \note
+	 * All ciphertexts (and queries) have to be encrypted under the same key for distances to be meaningful.
+	 *
+	 * \note
+	 * A search running concurrently with writes is not isolated from them:
+	 * it sees deletes as they happen, but not the records appended to segments created after it started.
+	 *
+	 */
+	template <typename VALUE_T>
+	class EncryptedStore
+	{
+		private:
+		using SegmentList = std::vector<std::shared_ptr<Segment<VALUE_T>>>;
+
+		const int dimensions;
+		const size_t segment_capacity;
+
+		/**
+		 * @brief the fraction of deleted rows in a sealed segment that triggers its compaction
+		 */
+		const double compaction_threshold;
+
+		/**
+		 * @brief the current list of segments, the last one is active
+		 *
+		 * Replaced as a whole (under write_mutex) whenever the list changes, so readers can hold on to it.
+		 */
+		std::shared_ptr<const SegmentList> snapshot;
+
+		/**
+		 * @brief guards only the copying and replacing of the snapshot pointer, never held while scanning or rewriting
+		 */
+		mutable std::mutex snapshot_mutex;
+
+		/**
+		 * @brief serializes writers: inserts, removes and the swap at the end of compaction
+		 */
+		std::mutex write_mutex;
+
+		/**
+		 * @brief maps the id of each live record to its segment and row (protected by write_mutex)
+		 */
+		std::unordered_map<ull, std::pair<Segment<VALUE_T>*, size_t>> locations;
+
+		/**
+		 * @brief makes sure only one compaction runs at a time
+		 */
+		std::mutex compaction_mutex;
+
+		/**
+		 * @brief the active segment (protected by write_mutex)
+		 */
+		std::shared_ptr<Segment<VALUE_T>> active;
+
+		/**
+		 * @brief the number of live records
+		 */
+		std::atomic<size_t> live = 0;
+
+		std::thread compactor;
+		std::mutex signal_mutex;
+		std::condition_variable compaction_requested;
+		bool compaction_pending = false;
+		bool stopping			= false;
+
+		/**
+		 * @brief takes a reference to the current list of segments
+		 *
+		 * @return shared_ptr<const SegmentList> the list that stays valid for as long as the caller holds it
+		 */
+		std::shared_ptr<const SegmentList> load_snapshot() const;
+
+		/**
+		 * @brief publishes a new list of segments (the caller holds write_mutex)
+		 *
+		 * @param segments the new list
+		 */
+		void store_snapshot(std::shared_ptr<const SegmentList> segments);
+
+		/**
+		 * @brief wakes up the background compaction thread (if there is one)
+		 */
+		void request_compaction();
+
+		/**
+		 * @brief the body of the background compaction thread
+		 */
+		void compaction_loop();
+
+		/**
+		 * @brief a helper that selects sealed segments worth compacting
+		 *
+		 * @param segments the segment list to select from
+		 * @return vector<shared_ptr<Segment<VALUE_T>>> the segments to rewrite
+		 */
+		SegmentList compaction_candidates(const SegmentList& segments) const;
+
+		/**
+		 * @brief a helper that finds the \f$ k \f$ closest live rows of a segment
+		 *
+		 * @param segment the segment to scan
+		 * @param query the query ciphertext
+		 * @param k the number of results
+		 * @return vector<Neighbor<VALUE_T>> the results, closest first
+		 */
+		std::vector<Neighbor<VALUE_T>> search_segment(const Segment<VALUE_T>& segment, const VALUE_T* query, const int k) const;
+
+		/**
+		 * @brief a helper that finds the live rows of a segment within a radius
+		 *
+		 * @param segment the segment to scan
+		 * @param query the query ciphertext
+		 * @param bound the squared radius
+		 * @param block the number of dimensions summed between checks against the bound
+		 * @param result the vector to append the results to
+		 */
+		void search_segment_radius(const Segment<VALUE_T>& segment, const VALUE_T* query, const VALUE_T bound, const int block, std::vector<Neighbor<VALUE_T>>& result) const;
+
+		public:
+		/**
+		 * @brief Construct a new Encrypted Store object
+		 *
+		 * @param dimensions the number of dimensions of each ciphertext
+		 * @param segment_capacity the number of rows in a segment
+		 * @param compaction_threshold the fraction of deleted rows in a sealed segment that triggers its compaction
+		 * @param background whether to run compaction in a background thread (otherwise, call compact)
+		 */
+		EncryptedStore(int dimensions, size_t segment_capacity = 1 << 14, double compaction_threshold = 0.25, bool background = true);
+
+		~EncryptedStore();
+
+		EncryptedStore(const EncryptedStore&) = delete;
+		EncryptedStore& operator=(const EncryptedStore&) = delete;
+
+		/**
+		 * @brief adds a record, replacing the record with the same id if there is one
+		 *
+		 * @param id the record id
+		 * @param ciphertext the encrypted vector (of length dimensions)
+		 * @param nonce the nonce returned by encryption
+		 */
+		void insert(ull id, const VALUE_T* ciphertext, const std::pair<ull, ull>& nonce);
+
+		/**
+		 * @brief deletes a record
+		 *
+		 * @param id the record id
+		 * @return true if the record existed
+		 */
+		bool remove(ull id);
+
+		/**
+		 * @brief reads a record
+		 *
+		 * @param id the record id
+		 * @param ciphertext the encrypted vector (has to be allocated of length dimensions)
+		 * @param nonce the nonce of the record
+		 * @return true if the record exists
+		 */
+		bool get(ull id, VALUE_T* ciphertext, std::pair<ull, ull>& nonce);
+
+		/**
+		 * @brief finds the \f$ k \f$ records closest to the query
+		 *
+		 * @param query the encrypted query (of length dimensions)
+		 * @param k the number of results
+		 * @return vector<Neighbor<VALUE_T>> the results, closest first
+		 */
+		std::vector<Neighbor<VALUE_T>> search(const VALUE_T* query, const int k) const;
+
+		/**
+		 * @brief finds all records within a radius of the query
+		 *
+		 * The squared distance is summed a block of dimensions at a time, and a row is dropped as soon as the partial sum exceeds \f$ R^2 \f$.
+		 * Partial sums only grow, so the result is the same as that of a full scan.
+		 * Use Scheme::ciphertext_radius to turn a radius in plaintext space into \f$ R \f$.
+		 *
+		 * @param query the encrypted query (of length dimensions)
+		 * @param radius the radius \f$ R \f$ in ciphertext space
+		 * @param block the number of dimensions summed between checks against the radius
+		 * @return vector<Neighbor<VALUE_T>> the results, closest first
+		 */
+		std::vector<Neighbor<VALUE_T>> search_radius(const VALUE_T* query, const VALUE_T radius, const int block = 16) const;
+
+		/**
+		 * @brief rewrites sealed segments with many tombstones, dropping the deleted rows
+		 *
+		 * @return size_t the number of rows reclaimed
+		 */
+		size_t compact();
+
+		/**
+		 * @brief the number of live records
+		 *
+		 * @return size_t the number of records
+		 */
+		size_t size() const;
+
+		/**
+		 * @brief the number of stored rows, including deleted ones not yet compacted
+		 *
+		 * @return size_t the number of rows
+		 */
+		size_t rows() const;
+
+		/**
+		 * @brief the number of segments, including the active one
+		 *
+		 * @return size_t the number of segments
+		 */
+		size_t segments() const;
+
+		/**
+		 * @brief the number of dimensions of each ciphertext
+		 *
+		 * @return int the number of dimensions
+		 */
+		int get_dimensions() const;
+	};
+}
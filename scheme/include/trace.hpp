@@ -0,0 +1,130 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <chrono>
+#include <ostream>
+
+/**
+ * @brief the number of event slots per thread (a power of 2); older events are overwritten
+ */
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS (1 << 14)
+#endif
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+/**
+ * @brief records the time from here to the end of the enclosing scope as a trace event
+ *
+ * Compiles to nothing unless TRACING macro is defined (see the trace target of the Makefile).
+ * The name has to be a string literal, only the pointer is stored.
+ */
+#ifdef TRACING
+#define TRACE_SCOPE(name) DCPE::TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
+
+namespace DCPE
+{
+	/**
+	 * @brief a completed scope: its name, the thread it ran on and when it started and ended (nanoseconds since the tracer started)
+	 *
+	 */
+	struct TraceEvent
+	{
+		const char* name;
+		uint32_t thread;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	/**
+	 * @brief collects trace events in a ring buffer per thread and exports them
+	 *
+	 * Recording is wait-free: a thread only ever writes to its own buffer, and readers never block it.
+	 * A buffer holds the last TRACE_BUFFER_EVENTS - 1 events of its thread, and is reused by a new thread once its thread exits.
+	 *
+	 */
+	class Tracer
+	{
+		public:
+		/**
+		 * @brief the current time on the tracer's clock
+		 *
+		 * @return uint64_t nanoseconds since the tracer started
+		 */
+		static uint64_t now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+		}
+
+		/**
+		 * @brief records an event in the calling thread's buffer
+		 *
+		 * @param name the name of the scope (a string literal)
+		 * @param start when the scope started
+		 * @param end when the scope ended
+		 */
+		static void record(const char* name, uint64_t start, uint64_t end);
+
+		/**
+		 * @brief a snapshot of the events of all threads still in the buffers, ordered by start
+		 *
+		 * Safe to call while other threads record; events being overwritten during the call are left out.
+		 *
+		 * @return vector<TraceEvent> the events
+		 */
+		static std::vector<TraceEvent> events();
+
+		/**
+		 * @brief drops all events recorded so far
+		 */
+		static void clear();
+
+		/**
+		 * @brief writes the events in the Chrome trace event format (for chrome://tracing or Perfetto)
+		 *
+		 * @param out the stream to write to
+		 */
+		static void write_chrome_trace(std::ostream& out);
+
+		/**
+		 * @brief writes the events as folded stacks (for flamegraph.pl or speedscope)
+		 *
+		 * Each line is a stack of nested scope names separated by semicolons and the time in nanoseconds spent in the innermost one.
+		 *
+		 * @param out the stream to write to
+		 */
+		static void write_folded_stacks(std::ostream& out);
+
+		private:
+		static const std::chrono::steady_clock::time_point origin;
+	};
+
+	/**
+	 * @brief records the lifetime of the object as a trace event; use TRACE_SCOPE macro rather than this directly
+	 *
+	 */
+	class TraceScope
+	{
+		private:
+		const char* name;
+		uint64_t start;
+
+		public:
+		explicit TraceScope(const char* name) :
+			name(name),
+			start(Tracer::now()) {}
+
+		~TraceScope()
+		{
+			Tracer::record(name, start, Tracer::now());
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+	};
+}
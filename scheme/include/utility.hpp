@@ -2,6 +2,8 @@
 
 #include "definitions.h"
 
+#include <functional>
+
 namespace DCPE
 {
 	/**
@@ -70,4 +72,32 @@ namespace DCPE
 	 */
 	template <typename VALUE_T>
 	VALUE_T distance(std::vector<VALUE_T> first, std::vector<VALUE_T> second);
+
+	/**
+	 * @brief computes squared Euclidean distance between two contiguous vectors
+	 *
+	 * \note
+	 * Skips the square root, so it is the cheaper choice whenever only the order of distances matters.
+	 *
+	 * @param first pointer to the start of the first vector
+	 * @param second pointer to the start of the second vector
+	 * @param dimensions the number of dimensions of both vectors
+	 * @return VALUE_T the squared Euclidean distance
+	 */
+	template <typename VALUE_T>
+	VALUE_T squared_distance(const VALUE_T* first, const VALUE_T* second, const int dimensions);
+
+	/**
+	 * @brief runs body for each index in [begin, end) on the global scheduler
+	 *
+	 * Indices are handed out one at a time, so the work per index may be uneven.
+	 * The calling thread takes part in the work, so parallel_for may be nested inside a scheduler task.
+	 * A task that throws stops taking indices; the first exception is rethrown in the caller once the other tasks are done.
+	 *
+	 * @param begin the first index (inclusive)
+	 * @param end the last index (non-inclusive)
+	 * @param body the function to call with each index
+	 * @param threads the max number of threads working at once (0 means all the workers plus the caller)
+	 */
+	void parallel_for(const size_t begin, const size_t end, const std::function<void(size_t)>& body, const uint threads = 0);
 }
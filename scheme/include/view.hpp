@@ -0,0 +1,213 @@
+#pragma once
+
+#include "definitions.h"
+#include "scheme.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace DCPE
+{
+	/**
+	 * @brief a read-only plaintext view of a ciphertext store that decrypts rows only when they are accessed
+	 *
+	 * Decrypted rows are kept in a bounded LRU cache.
+	 * When iterating over a range, a background thread decrypts the rows ahead of the iterator.
+	 * The view does not own the ciphertexts and nonces, they have to outlive it.
+	 *
+	 */
+	template <typename VALUE_T>
+	class DecryptedView
+	{
+		public:
+		using Row = std::shared_ptr<const std::vector<VALUE_T>>;
+
+		/**
+		 * @brief an input iterator over a range of rows, prefetching the rows ahead of it
+		 *
+		 */
+		class iterator
+		{
+			private:
+			DecryptedView* view;
+			size_t row;
+			size_t end;
+
+			public:
+			iterator(DecryptedView* view, size_t row, size_t end);
+
+			Row operator*() const;
+			iterator& operator++();
+			bool operator!=(const iterator& other) const;
+			bool operator==(const iterator& other) const;
+		};
+
+		/**
+		 * @brief a range of rows that can be used in a range-based for loop
+		 *
+		 */
+		class Range
+		{
+			private:
+			DecryptedView* view;
+			size_t first;
+			size_t last;
+
+			public:
+			Range(DecryptedView* view, size_t first, size_t last);
+
+			iterator begin() const;
+			iterator end() const;
+		};
+
+		private:
+		Scheme<VALUE_T>& scheme;
+		DCPE::key<VALUE_T> key;
+		const VALUE_T* ciphertexts;
+		const std::pair<ull, ull>* nonces;
+		const size_t rows;
+		const int dimensions;
+
+		/**
+		 * @brief the max number of decrypted rows kept in memory
+		 */
+		const size_t capacity;
+
+		/**
+		 * @brief how many rows ahead of an iterator to decrypt in the background
+		 */
+		const size_t prefetch;
+
+		std::mutex mutex;
+		std::condition_variable decrypted;
+
+		/**
+		 * @brief row indices, the most recently used first
+		 */
+		std::list<size_t> recency;
+		std::unordered_map<size_t, std::pair<Row, std::list<size_t>::iterator>> cache;
+
+		/**
+		 * @brief rows being decrypted right now (by any thread)
+		 */
+		std::unordered_set<size_t> in_flight;
+
+		std::deque<size_t> queue;
+		std::unordered_set<size_t> queued;
+		bool stopping = false;
+		std::thread prefetcher;
+
+		size_t hits		  = 0;
+		size_t misses	  = 0;
+		size_t prefetched = 0;
+
+		/**
+		 * @brief a helper that decrypts a row (without touching the cache)
+		 *
+		 * @param row the row index
+		 * @return Row the decrypted row
+		 */
+		Row decrypt(size_t row);
+
+		/**
+		 * @brief a helper that puts a row into the cache, evicting the least recently used ones (the caller holds the mutex)
+		 *
+		 * @param row the row index
+		 * @param value the decrypted row
+		 */
+		void remember(size_t row, Row value);
+
+		/**
+		 * @brief queues rows for background decryption, skipping those already cached or being decrypted
+		 *
+		 * @param first the first row to queue
+		 * @param last the row after the last one to queue
+		 */
+		void schedule(size_t first, size_t last);
+
+		/**
+		 * @brief the body of the background prefetching thread
+		 */
+		void prefetch_loop();
+
+		public:
+		/**
+		 * @brief Construct a new Decrypted View object
+		 *
+		 * @param scheme the scheme the ciphertexts were encrypted with
+		 * @param key the key the ciphertexts were encrypted under
+		 * @param ciphertexts the encrypted rows, one after another
+		 * @param nonces the nonce of each row
+		 * @param rows the number of rows
+		 * @param dimensions the number of dimensions of each row
+		 * @param capacity the max number of decrypted rows kept in memory
+		 * @param prefetch how many rows ahead of an iterator to decrypt in the background (0 disables the background thread)
+		 */
+		DecryptedView(Scheme<VALUE_T>& scheme, const DCPE::key<VALUE_T>& key, const VALUE_T* ciphertexts, const std::pair<ull, ull>* nonces, size_t rows, int dimensions, size_t capacity = 1 << 10, size_t prefetch = 0);
+
+		~DecryptedView();
+
+		DecryptedView(const DecryptedView&) = delete;
+		DecryptedView& operator=(const DecryptedView&) = delete;
+
+		/**
+		 * @brief returns a decrypted row, decrypting it if it is not in the cache
+		 *
+		 * @param row the row index
+		 * @return Row the decrypted row (valid after it is evicted, as long as the caller holds it)
+		 */
+		Row get(size_t row);
+
+		/**
+		 * @brief returns a single decrypted value
+		 *
+		 * @param row the row index
+		 * @param dimension the dimension index
+		 * @return VALUE_T the decrypted value
+		 */
+		VALUE_T at(size_t row, int dimension);
+
+		/**
+		 * @brief a range of rows to iterate over, prefetching ahead of the iterator
+		 *
+		 * @param first the first row
+		 * @param last the row after the last one
+		 * @return Range the range
+		 */
+		Range range(size_t first, size_t last);
+
+		/**
+		 * @brief the number of rows
+		 *
+		 * @return size_t the number of rows
+		 */
+		size_t size() const;
+
+		/**
+		 * @brief the number of accesses served from the cache
+		 *
+		 * @return size_t the number of hits
+		 */
+		size_t get_hits();
+
+		/**
+		 * @brief the number of accesses that had to decrypt (or wait for) the row
+		 *
+		 * @return size_t the number of misses
+		 */
+		size_t get_misses();
+
+		/**
+		 * @brief the number of rows decrypted by the background thread
+		 *
+		 * @return size_t the number of prefetched rows
+		 */
+		size_t get_prefetched();
+	};
+}
@@ -0,0 +1,343 @@
+#include "batch.hpp"
+
+#include "trace.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DCPE
+{
+	namespace
+	{
+		const char MAGIC[4] = {'D', 'C', 'P', 'B'};
+		const byte VERSION	= 1;
+
+		/**
+		 * @brief the number of rows a task of a batch kernel takes at once
+		 */
+		const size_t CHUNK = 1 << 6;
+
+		/**
+		 * @brief sums a term of the values at each position of two aligned, zero-padded rows, with one partial sum per SIMD lane
+		 *
+		 */
+		template <typename VALUE_T, typename TERM>
+		VALUE_T lane_sum(const VALUE_T* first, const VALUE_T* second, size_t stride, TERM term)
+		{
+			const size_t lane = BATCH_ALIGNMENT / sizeof(VALUE_T);
+
+			auto a = static_cast<const VALUE_T*>(__builtin_assume_aligned(first, BATCH_ALIGNMENT));
+			auto b = static_cast<const VALUE_T*>(__builtin_assume_aligned(second, BATCH_ALIGNMENT));
+
+			VALUE_T sums[lane] = {};
+			for (size_t j = 0; j < stride; j += lane)
+			{
+				for (size_t k = 0; k < lane; k++)
+				{
+					sums[k] += term(a[j + k], b[j + k]);
+				}
+			}
+
+			VALUE_T result = 0.0;
+			for (size_t k = 0; k < lane; k++)
+			{
+				result += sums[k];
+			}
+			return result;
+		}
+
+		/**
+		 * @brief appends the raw bytes of values to the buffer
+		 *
+		 */
+		template <typename T>
+		void put(bytes& buffer, const T* values, size_t count = 1)
+		{
+			auto start = reinterpret_cast<const byte*>(values);
+			buffer.insert(buffer.end(), start, start + count * sizeof(T));
+		}
+
+		/**
+		 * @brief reads values from the buffer at offset and moves the offset past them, throwing if the buffer is too short
+		 *
+		 */
+		template <typename T>
+		void get(const bytes& buffer, size_t& offset, T* values, size_t count = 1)
+		{
+			if (offset + count * sizeof(T) > buffer.size())
+			{
+				throw Exception(boost::format("CiphertextBatch: truncated buffer (%d bytes)") % buffer.size());
+			}
+			std::memcpy(static_cast<void*>(values), buffer.data() + offset, count * sizeof(T));
+			offset += count * sizeof(T);
+		}
+	}
+
+	template <typename VALUE_T>
+	CiphertextSlice<VALUE_T> CiphertextSlice<VALUE_T>::slice(size_t first, size_t last) const
+	{
+		if (first > last || last > rows)
+		{
+			throw Exception(boost::format("CiphertextSlice: invalid range [%d, %d) of %d rows") % first % last % rows);
+		}
+
+		return CiphertextSlice<VALUE_T>(row(first), nonce_data + first, last - first, dimensions, stride);
+	}
+
+	template <typename VALUE_T>
+	bytes CiphertextSlice<VALUE_T>::serialize() const
+	{
+		TRACE_SCOPE("CiphertextSlice::serialize");
+
+		// the magic is copied into place rather than appended to an empty buffer, which trips -Wstringop-overflow at -O3
+		bytes buffer(sizeof(MAGIC));
+		buffer.reserve(sizeof(MAGIC) + 2 + sizeof(uint32_t) + sizeof(uint64_t) + rows * (sizeof(std::pair<ull, ull>) + dimensions * sizeof(VALUE_T)));
+		std::memcpy(buffer.data(), MAGIC, sizeof(MAGIC));
+
+		put(buffer, &VERSION);
+		byte value_size		= sizeof(VALUE_T);
+		uint32_t dimensions = this->dimensions;
+		uint64_t rows		= this->rows;
+		put(buffer, &value_size);
+		put(buffer, &dimensions);
+		put(buffer, &rows);
+
+		put(buffer, nonce_data, rows);
+		for (size_t i = 0; i < rows; i++)
+		{
+			put(buffer, row(i), dimensions);
+		}
+
+		return buffer;
+	}
+
+	template <typename VALUE_T>
+	CiphertextBatch<VALUE_T>::CiphertextBatch(size_t rows, int dimensions) :
+		rows(rows),
+		dimensions(dimensions)
+	{
+		if (dimensions <= 0)
+		{
+			throw Exception(boost::format("CiphertextBatch: invalid number of dimensions %d") % dimensions);
+		}
+
+		stride = stride_for(dimensions);
+		if (rows > SIZE_MAX / sizeof(VALUE_T) / stride)
+		{
+			throw Exception(boost::format("CiphertextBatch: %d rows of %d dimensions do not fit in memory") % rows % dimensions);
+		}
+
+		// aligned_alloc wants a size that is a multiple of the alignment, which a whole number of padded rows is; allocate a row for an empty batch
+		auto size = std::max(rows, (size_t)1) * stride * sizeof(VALUE_T);
+		data	  = std::unique_ptr<VALUE_T[], Free>(static_cast<VALUE_T*>(std::aligned_alloc(BATCH_ALIGNMENT, size)));
+		if (!data)
+		{
+			throw Exception(boost::format("CiphertextBatch: failed to allocate %d bytes") % size);
+		}
+		std::memset(static_cast<void*>(data.get()), 0, size);
+
+		nonce_data.resize(rows);
+	}
+
+	template <typename VALUE_T>
+	CiphertextBatch<VALUE_T>::CiphertextBatch(CiphertextBatch&& other) noexcept :
+		rows(other.rows),
+		dimensions(other.dimensions),
+		stride(other.stride),
+		data(std::move(other.data)),
+		nonce_data(std::move(other.nonce_data))
+	{
+		other.rows = 0;
+	}
+
+	template <typename VALUE_T>
+	CiphertextBatch<VALUE_T>& CiphertextBatch<VALUE_T>::operator=(CiphertextBatch&& other) noexcept
+	{
+		rows	   = other.rows;
+		dimensions = other.dimensions;
+		stride	   = other.stride;
+		data	   = std::move(other.data);
+		nonce_data = std::move(other.nonce_data);
+		other.rows = 0;
+		return *this;
+	}
+
+	template <typename VALUE_T>
+	CiphertextBatch<VALUE_T> CiphertextBatch<VALUE_T>::deserialize(const bytes& serialized)
+	{
+		TRACE_SCOPE("CiphertextBatch::deserialize");
+
+		size_t offset = 0;
+
+		char magic[sizeof(MAGIC)];
+		get(serialized, offset, magic, sizeof(MAGIC));
+		if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+		{
+			throw Exception("CiphertextBatch: not a serialized batch");
+		}
+		byte version;
+		get(serialized, offset, &version);
+		if (version != VERSION)
+		{
+			throw Exception(boost::format("CiphertextBatch: unsupported version %d") % (int)version);
+		}
+
+		byte value_size;
+		uint32_t dimensions;
+		uint64_t rows;
+		get(serialized, offset, &value_size);
+		get(serialized, offset, &dimensions);
+		get(serialized, offset, &rows);
+		if (value_size != sizeof(VALUE_T))
+		{
+			throw Exception(boost::format("CiphertextBatch: the buffer holds %d-byte values, expected %d-byte values") % (int)value_size % sizeof(VALUE_T));
+		}
+		// compared by division, since a forged row count times the record size can wrap around to the real size
+		auto record_size = sizeof(std::pair<ull, ull>) + (size_t)dimensions * sizeof(VALUE_T);
+		if (dimensions == 0 || dimensions > INT_MAX || (serialized.size() - offset) % record_size != 0 || rows != (serialized.size() - offset) / record_size)
+		{
+			throw Exception("CiphertextBatch: corrupted header");
+		}
+
+		CiphertextBatch<VALUE_T> batch(rows, dimensions);
+		get(serialized, offset, batch.nonce_data.data(), rows);
+		for (size_t i = 0; i < rows; i++)
+		{
+			get(serialized, offset, batch.row(i), dimensions);
+		}
+
+		return batch;
+	}
+
+	template <typename VALUE_T>
+	size_t CiphertextBatch<VALUE_T>::stride_for(int dimensions)
+	{
+		const size_t lane = BATCH_ALIGNMENT / sizeof(VALUE_T);
+		return (dimensions + lane - 1) / lane * lane;
+	}
+
+	template <typename VALUE_T>
+	CiphertextSlice<VALUE_T> CiphertextBatch<VALUE_T>::view()
+	{
+		return CiphertextSlice<VALUE_T>(data.get(), nonce_data.data(), rows, dimensions, stride);
+	}
+
+	template <typename VALUE_T>
+	CiphertextSlice<VALUE_T> CiphertextBatch<VALUE_T>::slice(size_t first, size_t last)
+	{
+		return view().slice(first, last);
+	}
+
+	template <typename VALUE_T>
+	void encrypt_batch(Scheme<VALUE_T>& scheme, key<VALUE_T>& key, const VALUE_T* messages, const CiphertextSlice<VALUE_T>& out, uint threads)
+	{
+		TRACE_SCOPE("encrypt_batch");
+
+		auto rows		= out.size();
+		auto dimensions = out.get_dimensions();
+		if (rows == 0)
+		{
+			return;
+		}
+
+		if (rows > INT_MAX / sizeof(std::pair<ull, ull>))
+		{
+			throw Exception(boost::format("encrypt_batch: too many rows at once: %d") % rows);
+		}
+
+		// the nonce column is contiguous, so the randomness lands in it directly
+		auto material = get_random_bytes(rows * sizeof(std::pair<ull, ull>));
+		std::memcpy(static_cast<void*>(out.nonces()), TO_ARRAY(material), material.size());
+
+		auto s = std::get<2>(key);
+		parallel_for(
+			0,
+			(rows + CHUNK - 1) / CHUNK,
+			[&](size_t index)
+			{
+				for (auto i = index * CHUNK; i < std::min(rows, (index + 1) * CHUNK); i++)
+				{
+					auto lambda_m	= scheme.compute_lambda_m(key, out.nonce(i), dimensions);
+					auto message	= messages + i * dimensions;
+					auto ciphertext = out.row(i);
+					for (auto j = 0; j < dimensions; j++)
+					{
+						ciphertext[j] = message[j] * s + lambda_m[j];
+					}
+				}
+			},
+			threads);
+	}
+
+	template <typename VALUE_T>
+	void decrypt_batch(Scheme<VALUE_T>& scheme, key<VALUE_T>& key, const CiphertextSlice<VALUE_T>& batch, VALUE_T* messages, uint threads)
+	{
+		TRACE_SCOPE("decrypt_batch");
+
+		auto rows		= batch.size();
+		auto dimensions = batch.get_dimensions();
+
+		parallel_for(
+			0,
+			(rows + CHUNK - 1) / CHUNK,
+			[&](size_t index)
+			{
+				for (auto i = index * CHUNK; i < std::min(rows, (index + 1) * CHUNK); i++)
+				{
+					scheme.decrypt(key, batch.row(i), dimensions, batch.nonce(i), messages + i * dimensions);
+				}
+			},
+			threads);
+	}
+
+	template <typename VALUE_T>
+	VALUE_T aligned_squared_distance(const VALUE_T* first, const VALUE_T* second, size_t stride)
+	{
+		return lane_sum(first, second, stride, [](VALUE_T a, VALUE_T b)
+						{ return (a - b) * (a - b); });
+	}
+
+	template <typename VALUE_T>
+	VALUE_T aligned_dot_product(const VALUE_T* first, const VALUE_T* second, size_t stride)
+	{
+		return lane_sum(first, second, stride, [](VALUE_T a, VALUE_T b)
+						{ return a * b; });
+	}
+
+	template <typename VALUE_T>
+	void squared_distances(const CiphertextSlice<VALUE_T>& batch, const VALUE_T* query, VALUE_T* distances)
+	{
+		TRACE_SCOPE("squared_distances");
+
+		// a single-row batch is an aligned and zero-padded buffer
+		CiphertextBatch<VALUE_T> padded(1, batch.get_dimensions());
+		std::copy(query, query + batch.get_dimensions(), padded.row(0));
+
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			distances[i] = aligned_squared_distance(batch.row(i), padded.row(0), batch.get_stride());
+		}
+	}
+
+	template class CiphertextSlice<float>;
+	template class CiphertextSlice<double>;
+
+	template class CiphertextBatch<float>;
+	template class CiphertextBatch<double>;
+
+	template void encrypt_batch(Scheme<float>& scheme, key<float>& key, const float* messages, const CiphertextSlice<float>& out, uint threads);
+	template void encrypt_batch(Scheme<double>& scheme, key<double>& key, const double* messages, const CiphertextSlice<double>& out, uint threads);
+
+	template void decrypt_batch(Scheme<float>& scheme, key<float>& key, const CiphertextSlice<float>& batch, float* messages, uint threads);
+	template void decrypt_batch(Scheme<double>& scheme, key<double>& key, const CiphertextSlice<double>& batch, double* messages, uint threads);
+
+	template float aligned_squared_distance(const float* first, const float* second, size_t stride);
+	template double aligned_squared_distance(const double* first, const double* second, size_t stride);
+
+	template float aligned_dot_product(const float* first, const float* second, size_t stride);
+	template double aligned_dot_product(const double* first, const double* second, size_t stride);
+
+	template void squared_distances(const CiphertextSlice<float>& batch, const float* query, float* distances);
+	template void squared_distances(const CiphertextSlice<double>& batch, const double* query, double* distances);
+}
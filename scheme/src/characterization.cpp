@@ -0,0 +1,195 @@
+#include "characterization.hpp"
+
+#include "scheme.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace DCPE
+{
+	template <typename VALUE_T>
+	Characterization<VALUE_T>::Characterization(CharacterizationConfig config) :
+		config(config)
+	{
+		if (config.dimensions <= 0 || config.records <= 0 || config.queries <= 0)
+		{
+			throw Exception(boost::format("Characterization: invalid workload (%d dimensions, %d records, %d queries)") % config.dimensions % config.records % config.queries);
+		}
+
+		if (config.k <= 0 || config.k > config.records)
+		{
+			throw Exception(boost::format("Characterization: invalid k %d for %d records") % config.k % config.records);
+		}
+
+		std::mt19937_64 generator(config.seed);
+		std::uniform_real_distribution<double> distribution(config.min_value, config.max_value);
+
+		records.resize((size_t)config.records * config.dimensions);
+		for (auto &&value : records)
+		{
+			value = distribution(generator);
+		}
+
+		queries.resize((size_t)config.queries * config.dimensions);
+		for (auto &&value : queries)
+		{
+			value = distribution(generator);
+		}
+
+		neighbors.reserve((size_t)config.queries * config.k);
+		for (auto i = 0; i < config.queries; i++)
+		{
+			auto result = nearest(records, TO_ARRAY(queries) + (size_t)i * config.dimensions);
+			neighbors.insert(neighbors.end(), result.begin(), result.end());
+		}
+	}
+
+	template <typename VALUE_T>
+	std::vector<int> Characterization<VALUE_T>::nearest(const std::vector<VALUE_T>& records, const VALUE_T* query)
+	{
+		std::vector<std::pair<VALUE_T, int>> distances;
+		distances.resize(config.records);
+		for (auto i = 0; i < config.records; i++)
+		{
+			distances[i] = {squared_distance(TO_ARRAY(records) + (size_t)i * config.dimensions, query, config.dimensions), i};
+		}
+
+		std::partial_sort(distances.begin(), distances.begin() + config.k, distances.end());
+
+		std::vector<int> result;
+		result.resize(config.k);
+		for (auto i = 0; i < config.k; i++)
+		{
+			result[i] = distances[i].second;
+		}
+
+		return result;
+	}
+
+	template <typename VALUE_T>
+	CharacterizationResult Characterization<VALUE_T>::measure(VALUE_T beta, VALUE_T max_s)
+	{
+		Scheme<VALUE_T> scheme(beta);
+		scheme.set_max_s(max_s);
+		auto key = scheme.keygen();
+
+		auto dimensions = config.dimensions;
+
+		std::vector<VALUE_T> ciphertexts;
+		ciphertexts.resize(records.size());
+		std::vector<std::pair<ull, ull>> nonces;
+		nonces.resize(config.records);
+
+		auto start = std::chrono::steady_clock::now();
+		for (auto i = 0; i < config.records; i++)
+		{
+			nonces[i] = scheme.encrypt(key, TO_ARRAY(records) + (size_t)i * dimensions, dimensions, TO_ARRAY(ciphertexts) + (size_t)i * dimensions);
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		CharacterizationResult result;
+		result.type		  = sizeof(VALUE_T) == sizeof(float) ? "float" : "double";
+		result.beta		  = beta;
+		result.max_s	  = max_s;
+		result.throughput = config.records / std::max(elapsed.count(), 1e-9);
+
+		auto error_sum = 0.0;
+		result.max_error = 0.0;
+		std::vector<VALUE_T> decrypted;
+		decrypted.resize(dimensions);
+		for (auto i = 0; i < config.records; i++)
+		{
+			scheme.decrypt(key, TO_ARRAY(ciphertexts) + (size_t)i * dimensions, dimensions, nonces[i], TO_ARRAY(decrypted));
+			for (auto j = 0; j < dimensions; j++)
+			{
+				double error	 = std::abs((double)decrypted[j] - (double)records[(size_t)i * dimensions + j]);
+				result.max_error = std::max(result.max_error, error);
+				error_sum += error;
+			}
+		}
+		result.mean_error = error_sum / records.size();
+
+		auto found = 0uLL;
+		std::vector<VALUE_T> query;
+		query.resize(dimensions);
+		for (auto i = 0; i < config.queries; i++)
+		{
+			scheme.encrypt(key, TO_ARRAY(queries) + (size_t)i * dimensions, dimensions, TO_ARRAY(query));
+			auto encrypted = nearest(ciphertexts, TO_ARRAY(query));
+
+			auto expected = neighbors.begin() + (size_t)i * config.k;
+			for (auto &&index : encrypted)
+			{
+				if (std::find(expected, expected + config.k, index) != expected + config.k)
+				{
+					found++;
+				}
+			}
+		}
+		result.recall = (double)found / ((size_t)config.queries * config.k);
+
+		return result;
+	}
+
+	template <typename VALUE_T>
+	std::vector<CharacterizationResult> Characterization<VALUE_T>::sweep(const std::vector<VALUE_T>& betas, const std::vector<VALUE_T>& max_ss, uint threads)
+	{
+		std::vector<CharacterizationResult> results;
+		results.resize(betas.size() * max_ss.size());
+
+		parallel_for(
+			0,
+			results.size(),
+			[&](size_t i)
+			{
+				results[i] = measure(betas[i / max_ss.size()], max_ss[i % max_ss.size()]);
+			},
+			threads);
+
+		return results;
+	}
+
+	template class Characterization<float>;
+	template class Characterization<double>;
+
+	std::vector<CharacterizationResult> pareto_frontier(const std::vector<CharacterizationResult>& results)
+	{
+		auto dominates = [](const CharacterizationResult& a, const CharacterizationResult& b)
+		{
+			auto no_worse = a.recall >= b.recall && a.mean_error <= b.mean_error && a.throughput >= b.throughput;
+			auto better	  = a.recall > b.recall || a.mean_error < b.mean_error || a.throughput > b.throughput;
+			return no_worse && better;
+		};
+
+		std::vector<CharacterizationResult> frontier;
+		for (auto &&candidate : results)
+		{
+			auto dominated = std::any_of(
+				results.begin(),
+				results.end(),
+				[&](const CharacterizationResult& other)
+				{
+					return dominates(other, candidate);
+				});
+			if (!dominated)
+			{
+				frontier.push_back(candidate);
+			}
+		}
+
+		return frontier;
+	}
+
+	void print_results(std::ostream& output, const std::vector<CharacterizationResult>& results)
+	{
+		output << "type,beta,max_s,max_error,mean_error,recall,throughput" << std::endl;
+		for (auto &&result : results)
+		{
+			output << boost::format("%s,%g,%g,%g,%g,%.4f,%.0f") % result.type % result.beta % result.max_s % result.max_error % result.mean_error % result.recall % result.throughput << std::endl;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#include "characterization.hpp"
+#include "trace.hpp"
+
+#include <fstream>
+#include <iostream>
+
+using namespace DCPE;
+
+template <typename VALUE_T>
+std::vector<CharacterizationResult> run(CharacterizationConfig config)
+{
+	const std::vector<VALUE_T> betas = {1.0, 4.0, 16.0, 64.0, 256.0, 1024.0};
+	const std::vector<VALUE_T> max_s = {1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0};
+
+	Characterization<VALUE_T> characterization(config);
+	return characterization.sweep(betas, max_s);
+}
+
+int main()
+{
+	CharacterizationConfig config;
+	config.dimensions = 128;
+	config.records	  = 5000;
+	config.queries	  = 100;
+	config.k		  = 10;
+
+	std::cout << "Sweeping beta and max_s over float and double..." << std::endl;
+
+	auto results = run<float>(config);
+	auto doubles = run<double>(config);
+	results.insert(results.end(), doubles.begin(), doubles.end());
+
+	std::cout << std::endl
+			  << "All points:" << std::endl;
+	print_results(std::cout, results);
+
+	std::cout << std::endl
+			  << "Pareto frontier (recall, mean error, throughput):" << std::endl;
+	print_results(std::cout, pareto_frontier(results));
+
+#ifdef TRACING
+	std::ofstream chrome("trace.json"), folded("trace.folded");
+	Tracer::write_chrome_trace(chrome);
+	Tracer::write_folded_stacks(folded);
+	std::cout << std::endl
+			  << "Trace written to trace.json and trace.folded" << std::endl;
+#endif
+
+	return 0;
+}
@@ -0,0 +1,687 @@
+#include "codec.hpp"
+
+#include "utility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace DCPE
+{
+	namespace
+	{
+		const char MAGIC[4]	  = {'D', 'C', 'P', 'C'};
+		const byte VERSION	  = 1;
+		const uint SCALE_BITS = 12;
+		const uint32_t SCALE  = 1u << SCALE_BITS;
+		const uint32_t LOWER  = 1u << 23; // the lower bound of the rANS state
+
+		/**
+		 * @brief the most values a block may decode to per byte of its encoding, so that a forged block cannot force a huge allocation
+		 *
+		 * Only blocks of millions of identical rows compress this well; the random nonces alone take 16 bytes per row.
+		 */
+		const size_t MAX_VALUES_PER_BYTE = 1 << 16;
+
+		/**
+		 * @brief whether a block of rows rows and of size bytes stays within MAX_VALUES_PER_BYTE
+		 *
+		 */
+		bool plausible_block(size_t rows, int dimensions, size_t size)
+		{
+			return (unsigned __int128)rows * dimensions <= (unsigned __int128)size * MAX_VALUES_PER_BYTE;
+		}
+
+		enum class PlaneMode : byte
+		{
+			Raw = 0,
+			Constant,
+			Rans
+		};
+
+		/**
+		 * @brief appends the raw bytes of values to the buffer
+		 *
+		 */
+		template <typename T>
+		void put(bytes& buffer, const T* values, size_t count = 1)
+		{
+			auto start = reinterpret_cast<const byte*>(values);
+			buffer.insert(buffer.end(), start, start + count * sizeof(T));
+		}
+
+		/**
+		 * @brief reads values from a buffer front to back, throwing if the buffer is too short
+		 *
+		 */
+		class ArchiveReader
+		{
+			private:
+			const byte* data;
+			const size_t size;
+			size_t offset = 0;
+
+			public:
+			ArchiveReader(const byte* data, size_t size) :
+				data(data),
+				size(size) {}
+
+			template <typename T>
+			void get(T* values, size_t count = 1)
+			{
+				if (offset + count * sizeof(T) > size)
+				{
+					throw Exception(boost::format("ColumnarCodec: truncated archive (%d bytes)") % size);
+				}
+				std::memcpy(values, data + offset, count * sizeof(T));
+				offset += count * sizeof(T);
+			}
+
+			template <typename T>
+			T get()
+			{
+				T value;
+				get(&value);
+				return value;
+			}
+
+			const byte* current() const
+			{
+				return data + offset;
+			}
+
+			size_t remaining() const
+			{
+				return size - offset;
+			}
+
+			void skip(size_t count)
+			{
+				if (offset + count > size)
+				{
+					throw Exception(boost::format("ColumnarCodec: truncated archive (%d bytes)") % size);
+				}
+				offset += count;
+			}
+		};
+
+		/**
+		 * @brief scales the symbol counts to frequencies summing to SCALE, keeping every present symbol at least 1
+		 *
+		 */
+		std::array<uint32_t, 256> normalize(const std::array<size_t, 256>& counts, size_t total)
+		{
+			std::array<uint32_t, 256> frequencies = {};
+			uint32_t sum						  = 0;
+			for (auto symbol = 0; symbol < 256; symbol++)
+			{
+				if (counts[symbol] > 0)
+				{
+					frequencies[symbol] = std::max((uint32_t)(counts[symbol] * SCALE / total), 1u);
+					sum += frequencies[symbol];
+				}
+			}
+
+			// rounding leaves the sum a little off, the most frequent symbols absorb the difference
+			while (sum != SCALE)
+			{
+				auto largest = std::max_element(frequencies.begin(), frequencies.end());
+				if (sum < SCALE)
+				{
+					*largest += SCALE - sum;
+					sum = SCALE;
+				}
+				else
+				{
+					(*largest)--;
+					sum--;
+				}
+			}
+
+			return frequencies;
+		}
+
+		/**
+		 * @brief encodes a plane with order-0 rANS, returning false (and leaving out as is) if it would not be smaller than raw
+		 *
+		 */
+		bool encode_rans(const byte* plane, size_t size, const std::array<size_t, 256>& counts, bytes& out)
+		{
+			auto frequencies = normalize(counts, size);
+			std::array<uint32_t, 256> cumulative;
+			uint32_t sum = 0;
+			for (auto symbol = 0; symbol < 256; symbol++)
+			{
+				cumulative[symbol] = sum;
+				sum += frequencies[symbol];
+			}
+
+			// rANS is last in, first out: encode backwards, then reverse the output
+			bytes stream;
+			stream.reserve(size);
+			uint32_t state = LOWER;
+			for (auto i = size; i-- > 0;)
+			{
+				auto symbol	   = plane[i];
+				auto frequency = frequencies[symbol];
+				auto max_state = ((LOWER >> SCALE_BITS) << 8) * frequency;
+				while (state >= max_state)
+				{
+					stream.push_back(state & 0xFF);
+					state >>= 8;
+				}
+				state = ((state / frequency) << SCALE_BITS) + (state % frequency) + cumulative[symbol];
+
+				if (stream.size() + 256 * sizeof(uint16_t) + sizeof(uint32_t) >= size)
+				{
+					return false;
+				}
+			}
+			for (auto i = 0; i < 4; i++)
+			{
+				stream.push_back(state & 0xFF);
+				state >>= 8;
+			}
+			std::reverse(stream.begin(), stream.end());
+
+			out.push_back((byte)PlaneMode::Rans);
+			for (auto &&frequency : frequencies)
+			{
+				uint16_t value = frequency - 1; // stored minus one so that SCALE fits, 0xFFFF marks an absent symbol
+				if (frequency == 0)
+				{
+					value = 0xFFFF;
+				}
+				put(out, &value);
+			}
+			uint32_t length = stream.size();
+			put(out, &length);
+			out.insert(out.end(), stream.begin(), stream.end());
+
+			return true;
+		}
+
+		void decode_rans(ArchiveReader& reader, byte* plane, size_t count)
+		{
+			std::array<uint32_t, 256> frequencies, cumulative;
+			std::array<byte, SCALE> symbols;
+			uint32_t sum = 0;
+			for (auto symbol = 0; symbol < 256; symbol++)
+			{
+				auto value			= reader.get<uint16_t>();
+				frequencies[symbol] = value == 0xFFFF ? 0 : value + 1u;
+				cumulative[symbol]	= sum;
+				if (sum + frequencies[symbol] > SCALE)
+				{
+					throw Exception("ColumnarCodec: corrupted frequency table");
+				}
+				std::fill(symbols.begin() + sum, symbols.begin() + sum + frequencies[symbol], (byte)symbol);
+				sum += frequencies[symbol];
+			}
+			if (sum != SCALE)
+			{
+				throw Exception("ColumnarCodec: corrupted frequency table");
+			}
+
+			auto length = reader.get<uint32_t>();
+			auto stream = reader.current();
+			reader.skip(length);
+			if (length < 4)
+			{
+				throw Exception("ColumnarCodec: corrupted plane");
+			}
+
+			uint32_t state = 0;
+			size_t offset  = 0;
+			for (; offset < 4; offset++)
+			{
+				state = (state << 8) | stream[offset];
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				auto slot	= state & (SCALE - 1);
+				auto symbol = symbols[slot];
+				plane[i]	= symbol;
+				state		= frequencies[symbol] * (state >> SCALE_BITS) + slot - cumulative[symbol];
+				while (state < LOWER)
+				{
+					if (offset == length)
+					{
+						throw Exception("ColumnarCodec: corrupted plane");
+					}
+					state = (state << 8) | stream[offset++];
+				}
+			}
+		}
+
+		/**
+		 * @brief splits words into byte planes (least significant first) and encodes each
+		 *
+		 */
+		template <typename WORD_T>
+		void encode_words(const std::vector<WORD_T>& words, bytes& out, bytes& plane)
+		{
+			plane.resize(words.size());
+			for (size_t b = 0; b < sizeof(WORD_T); b++)
+			{
+				for (size_t i = 0; i < words.size(); i++)
+				{
+					plane[i] = (byte)(words[i] >> (8 * b));
+				}
+				encode_plane(plane.data(), plane.size(), out);
+			}
+		}
+
+		/**
+		 * @brief the inverse of encode_words
+		 *
+		 */
+		template <typename WORD_T>
+		void decode_words(ArchiveReader& reader, std::vector<WORD_T>& words, bytes& plane)
+		{
+			std::fill(words.begin(), words.end(), 0);
+			plane.resize(words.size());
+			for (size_t b = 0; b < sizeof(WORD_T); b++)
+			{
+				reader.skip(decode_plane(reader.current(), reader.remaining(), plane.data(), plane.size()));
+				for (size_t i = 0; i < words.size(); i++)
+				{
+					words[i] |= (WORD_T)plane[i] << (8 * b);
+				}
+			}
+		}
+
+		/**
+		 * @brief the header fields and block offsets of an archive
+		 *
+		 */
+		struct Layout
+		{
+			ArchiveInfo info;
+			const byte* payload;
+			std::vector<uint64_t> offsets;
+
+			size_t first(size_t index) const
+			{
+				return index * info.block_rows;
+			}
+
+			size_t rows(size_t index) const
+			{
+				return std::min(info.block_rows, info.rows - first(index));
+			}
+
+			const byte* block(size_t index) const
+			{
+				return payload + offsets[index];
+			}
+
+			size_t block_size(size_t index) const
+			{
+				return offsets[index + 1] - offsets[index];
+			}
+		};
+
+		Layout read_layout(const bytes& archive)
+		{
+			ArchiveReader reader(archive.data(), archive.size());
+
+			char magic[sizeof(MAGIC)];
+			reader.get(magic, sizeof(MAGIC));
+			if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+			{
+				throw Exception("ColumnarCodec: not an archive");
+			}
+			auto version = reader.get<byte>();
+			if (version != VERSION)
+			{
+				throw Exception(boost::format("ColumnarCodec: unsupported archive version %d") % (int)version);
+			}
+
+			Layout layout;
+			layout.info.value_size = reader.get<byte>();
+			layout.info.dimensions = reader.get<uint32_t>();
+			layout.info.rows	   = reader.get<uint64_t>();
+			layout.info.block_rows = reader.get<uint64_t>();
+			layout.info.blocks	   = reader.get<uint64_t>();
+
+			if (layout.info.dimensions <= 0 || layout.info.block_rows == 0 || layout.info.blocks != layout.info.rows / layout.info.block_rows + (layout.info.rows % layout.info.block_rows != 0))
+			{
+				throw Exception("ColumnarCodec: corrupted header");
+			}
+
+			// blocks + 1 offsets have to fit in what is left, checked before allocating them
+			if (layout.info.blocks >= reader.remaining() / sizeof(uint64_t))
+			{
+				throw Exception(boost::format("ColumnarCodec: the header claims %d blocks, more than the archive (%d bytes) can hold") % layout.info.blocks % archive.size());
+			}
+
+			layout.offsets.resize(layout.info.blocks + 1);
+			reader.get(layout.offsets.data(), layout.offsets.size());
+			layout.payload = reader.current();
+			if (!std::is_sorted(layout.offsets.begin(), layout.offsets.end()) || layout.offsets.front() != 0 || layout.offsets.back() != reader.remaining())
+			{
+				throw Exception("ColumnarCodec: corrupted block offsets");
+			}
+
+			return layout;
+		}
+
+		/**
+		 * @brief reads the layout and checks that the archive holds values of the given size and dimensions
+		 *
+		 */
+		Layout read_layout(const bytes& archive, int value_size, int dimensions)
+		{
+			auto layout = read_layout(archive);
+			if (layout.info.value_size != value_size || layout.info.dimensions != dimensions)
+			{
+				throw Exception(boost::format("ColumnarCodec: the archive holds %d-byte values of %d dimensions, expected %d-byte values of %d dimensions") % layout.info.value_size % layout.info.dimensions % value_size % dimensions);
+			}
+
+			return layout;
+		}
+
+		/**
+		 * @brief sizes the buffers of a block for a block of the layout
+		 *
+		 */
+		template <typename VALUE_T>
+		void resize_block(const Layout& layout, size_t index, int dimensions, ArchiveBlock<VALUE_T>& block)
+		{
+			if (!plausible_block(layout.rows(index), dimensions, layout.block_size(index)))
+			{
+				throw Exception(boost::format("ColumnarCodec: block %d claims %d rows in %d bytes") % index % layout.rows(index) % layout.block_size(index));
+			}
+
+			block.first = layout.first(index);
+			block.rows	= layout.rows(index);
+			block.ciphertexts.resize(block.rows * dimensions);
+			block.nonces.resize(block.rows);
+			block.ids.resize(block.rows);
+		}
+	}
+
+	void encode_plane(const byte* plane, size_t size, bytes& out)
+	{
+		std::array<size_t, 256> counts = {};
+		for (size_t i = 0; i < size; i++)
+		{
+			counts[plane[i]]++;
+		}
+
+		if (size > 0 && counts[plane[0]] == size)
+		{
+			out.push_back((byte)PlaneMode::Constant);
+			out.push_back(plane[0]);
+			return;
+		}
+
+		if (size > 0 && encode_rans(plane, size, counts, out))
+		{
+			return;
+		}
+
+		out.push_back((byte)PlaneMode::Raw);
+		out.insert(out.end(), plane, plane + size);
+	}
+
+	size_t decode_plane(const byte* data, size_t size, byte* plane, size_t count)
+	{
+		ArchiveReader reader(data, size);
+
+		auto mode = reader.get<PlaneMode>();
+		switch (mode)
+		{
+			case PlaneMode::Raw:
+				reader.get(plane, count);
+				break;
+			case PlaneMode::Constant:
+				std::memset(plane, reader.get<byte>(), count);
+				break;
+			case PlaneMode::Rans:
+				decode_rans(reader, plane, count);
+				break;
+			default:
+				throw Exception(boost::format("ColumnarCodec: unknown plane mode %d") % (int)mode);
+		}
+
+		return size - reader.remaining();
+	}
+
+	template <typename VALUE_T>
+	ColumnarCodec<VALUE_T>::ColumnarCodec(int dimensions, size_t block_rows) :
+		dimensions(dimensions),
+		block_rows(block_rows)
+	{
+		if (dimensions <= 0)
+		{
+			throw Exception(boost::format("ColumnarCodec: invalid number of dimensions %d") % dimensions);
+		}
+
+		if (block_rows == 0)
+		{
+			throw Exception("ColumnarCodec: invalid block size 0");
+		}
+	}
+
+	template <typename VALUE_T>
+	bytes ColumnarCodec<VALUE_T>::encode_block(const VALUE_T* ciphertexts, const std::pair<ull, ull>* nonces, const ull* ids, size_t rows) const
+	{
+		using word = std::conditional_t<sizeof(VALUE_T) == 4, uint32_t, uint64_t>;
+
+		bytes out, plane;
+
+		// column by column, each value XOR-ed with the one above it
+		std::vector<word> words(rows * dimensions);
+		for (auto j = 0; j < dimensions; j++)
+		{
+			word previous = 0;
+			for (size_t r = 0; r < rows; r++)
+			{
+				word current;
+				std::memcpy(&current, ciphertexts + r * dimensions + j, sizeof(word));
+				words[j * rows + r] = current ^ previous;
+				previous			= current;
+			}
+		}
+		encode_words(words, out, plane);
+
+		std::vector<uint64_t> column(rows);
+		for (size_t r = 0; r < rows; r++)
+		{
+			column[r] = ids[r] - (r > 0 ? ids[r - 1] : 0);
+		}
+		encode_words(column, out, plane);
+
+		for (size_t r = 0; r < rows; r++)
+		{
+			column[r] = nonces[r].first;
+		}
+		encode_words(column, out, plane);
+
+		for (size_t r = 0; r < rows; r++)
+		{
+			column[r] = nonces[r].second;
+		}
+		encode_words(column, out, plane);
+
+		return out;
+	}
+
+	template <typename VALUE_T>
+	bytes ColumnarCodec<VALUE_T>::encode(const VALUE_T* ciphertexts, const std::pair<ull, ull>* nonces, const ull* ids, size_t rows, uint threads) const
+	{
+		auto count = (rows + block_rows - 1) / block_rows;
+
+		std::vector<bytes> blocks(count);
+		parallel_for(
+			0,
+			count,
+			[&](size_t i)
+			{
+				auto first = i * block_rows;
+				auto size  = std::min(block_rows, rows - first);
+				blocks[i]  = encode_block(ciphertexts + first * dimensions, nonces + first, ids + first, size);
+				if (!plausible_block(size, dimensions, blocks[i].size()))
+				{
+					throw Exception(boost::format("ColumnarCodec: block %d compresses %d rows to %d bytes, past what decoding accepts (use smaller blocks)") % i % size % blocks[i].size());
+				}
+			},
+			threads);
+
+		size_t payload = 0;
+		for (auto &&block : blocks)
+		{
+			payload += block.size();
+		}
+
+		// the whole archive is allocated up front, and the magic is copied into place (inserting it first trips -Wstringop-overflow at -O2 and up)
+		bytes archive(sizeof(MAGIC));
+		archive.reserve(sizeof(MAGIC) + 2 + sizeof(uint32_t) + (3 + count + 1) * sizeof(uint64_t) + payload);
+		std::memcpy(archive.data(), MAGIC, sizeof(MAGIC));
+		archive.push_back(VERSION);
+		archive.push_back(sizeof(VALUE_T));
+		uint32_t header_dimensions = dimensions;
+		uint64_t header[]		   = {rows, block_rows, count};
+		put(archive, &header_dimensions);
+		put(archive, header, 3);
+
+		uint64_t offset = 0;
+		put(archive, &offset);
+		for (auto &&block : blocks)
+		{
+			offset += block.size();
+			put(archive, &offset);
+		}
+		for (auto &&block : blocks)
+		{
+			archive.insert(archive.end(), block.begin(), block.end());
+		}
+
+		return archive;
+	}
+
+	template <typename VALUE_T>
+	ArchiveInfo ColumnarCodec<VALUE_T>::inspect(const bytes& archive)
+	{
+		return read_layout(archive).info;
+	}
+
+	template <typename VALUE_T>
+	void ColumnarCodec<VALUE_T>::decode_block(const byte* data, size_t size, size_t rows, VALUE_T* ciphertexts, std::pair<ull, ull>* nonces, ull* ids) const
+	{
+		using word = std::conditional_t<sizeof(VALUE_T) == 4, uint32_t, uint64_t>;
+
+		if (!plausible_block(rows, dimensions, size))
+		{
+			throw Exception(boost::format("ColumnarCodec: a block claims %d rows in %d bytes") % rows % size);
+		}
+
+		ArchiveReader reader(data, size);
+
+		bytes plane;
+
+		std::vector<word> words(rows * dimensions);
+		decode_words(reader, words, plane);
+		for (auto j = 0; j < dimensions; j++)
+		{
+			word previous = 0;
+			for (size_t r = 0; r < rows; r++)
+			{
+				previous ^= words[j * rows + r];
+				std::memcpy(ciphertexts + r * dimensions + j, &previous, sizeof(word));
+			}
+		}
+
+		std::vector<uint64_t> column(rows);
+		decode_words(reader, column, plane);
+		ull id = 0;
+		for (size_t r = 0; r < rows; r++)
+		{
+			id += column[r];
+			ids[r] = id;
+		}
+
+		decode_words(reader, column, plane);
+		for (size_t r = 0; r < rows; r++)
+		{
+			nonces[r].first = column[r];
+		}
+
+		decode_words(reader, column, plane);
+		for (size_t r = 0; r < rows; r++)
+		{
+			nonces[r].second = column[r];
+		}
+	}
+
+	template <typename VALUE_T>
+	void ColumnarCodec<VALUE_T>::decode_block(const bytes& archive, size_t index, ArchiveBlock<VALUE_T>& block) const
+	{
+		auto layout = read_layout(archive, sizeof(VALUE_T), dimensions);
+		if (index >= layout.info.blocks)
+		{
+			throw Exception(boost::format("ColumnarCodec: block %d is out of range (%d blocks)") % index % layout.info.blocks);
+		}
+
+		resize_block(layout, index, dimensions, block);
+		decode_block(layout.block(index), layout.block_size(index), block.rows, block.ciphertexts.data(), block.nonces.data(), block.ids.data());
+	}
+
+	template <typename VALUE_T>
+	void ColumnarCodec<VALUE_T>::for_each_block(const bytes& archive, const std::function<void(const ArchiveBlock<VALUE_T>&)>& consumer, uint threads) const
+	{
+		auto layout = read_layout(archive, sizeof(VALUE_T), dimensions);
+		parallel_for(
+			0,
+			layout.info.blocks,
+			[&](size_t i)
+			{
+				ArchiveBlock<VALUE_T> block;
+				resize_block(layout, i, dimensions, block);
+				decode_block(layout.block(i), layout.block_size(i), block.rows, block.ciphertexts.data(), block.nonces.data(), block.ids.data());
+				consumer(block);
+			},
+			threads);
+	}
+
+	template <typename VALUE_T>
+	void ColumnarCodec<VALUE_T>::decode(const bytes& archive, VALUE_T* ciphertexts, std::pair<ull, ull>* nonces, ull* ids, uint threads) const
+	{
+		auto layout = read_layout(archive, sizeof(VALUE_T), dimensions);
+		parallel_for(
+			0,
+			layout.info.blocks,
+			[&](size_t i)
+			{
+				auto first = layout.first(i);
+				decode_block(layout.block(i), layout.block_size(i), layout.rows(i), ciphertexts + first * dimensions, nonces + first, ids + first);
+			},
+			threads);
+	}
+
+	template <typename VALUE_T>
+	void ColumnarCodec<VALUE_T>::load(const bytes& archive, EncryptedStore<VALUE_T>& store, uint threads) const
+	{
+		if (store.get_dimensions() != dimensions)
+		{
+			throw Exception(boost::format("ColumnarCodec: the store has %d dimensions, expected %d") % store.get_dimensions() % dimensions);
+		}
+
+		for_each_block(
+			archive,
+			[&](const ArchiveBlock<VALUE_T>& block)
+			{
+				for (size_t r = 0; r < block.rows; r++)
+				{
+					store.insert(block.ids[r], block.ciphertexts.data() + r * dimensions, block.nonces[r]);
+				}
+			},
+			threads);
+	}
+
+	template class ColumnarCodec<float>;
+	template class ColumnarCodec<double>;
+}
@@ -0,0 +1,270 @@
+#include "kmeans.hpp"
+
+#include "trace.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace DCPE
+{
+	namespace
+	{
+		/**
+		 * @brief the number of rows a task takes at once while assigning
+		 */
+		const size_t CHUNK = 1 << 6;
+	}
+
+	template <typename VALUE_T>
+	StreamingKMeans<VALUE_T>::StreamingKMeans(int k, int dimensions, ull seed) :
+		k(k),
+		dimensions(dimensions),
+		seed(seed),
+		centroids(std::max(k, 0), dimensions),
+		counts(std::max(k, 0))
+	{
+		if (k <= 0)
+		{
+			throw Exception(boost::format("StreamingKMeans: invalid number of clusters %d") % k);
+		}
+	}
+
+	template <typename VALUE_T>
+	void StreamingKMeans<VALUE_T>::seed_centroids(const CiphertextSlice<VALUE_T>& batch)
+	{
+		TRACE_SCOPE("StreamingKMeans::seed_centroids");
+
+		std::mt19937_64 generator(seed);
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+		auto rows	= batch.size();
+		auto stride = batch.get_stride();
+
+		// each next centroid is a row picked with probability proportional to its squared distance to the nearest centroid so far
+		std::vector<double> nearest(rows, std::numeric_limits<double>::infinity());
+		auto chosen = (size_t)(unit(generator) * rows) % rows;
+		for (auto c = 0; c < k; c++)
+		{
+			std::copy(batch.row(chosen), batch.row(chosen) + stride, centroids.row(c));
+
+			auto total = 0.0;
+			for (size_t i = 0; i < rows; i++)
+			{
+				nearest[i] = std::min(nearest[i], (double)aligned_squared_distance(batch.row(i), centroids.row(c), stride));
+				total += nearest[i];
+			}
+
+			if (total == 0.0)
+			{
+				// every row coincides with a centroid, any row will do
+				chosen = (size_t)(unit(generator) * rows) % rows;
+				continue;
+			}
+
+			auto target = unit(generator) * total;
+			chosen		= rows - 1;
+			for (size_t i = 0; i < rows; i++)
+			{
+				target -= nearest[i];
+				if (target < 0.0)
+				{
+					chosen = i;
+					break;
+				}
+			}
+		}
+	}
+
+	template <typename VALUE_T>
+	void StreamingKMeans<VALUE_T>::update(const CiphertextSlice<VALUE_T>& batch, uint threads)
+	{
+		TRACE_SCOPE("StreamingKMeans::update");
+
+		if (batch.get_dimensions() != dimensions)
+		{
+			throw Exception(boost::format("StreamingKMeans: rows of %d dimensions, expected %d") % batch.get_dimensions() % dimensions);
+		}
+
+		auto rows = batch.size();
+		if (rows == 0)
+		{
+			return;
+		}
+
+		if (!initialized)
+		{
+			if (rows < (size_t)k)
+			{
+				throw Exception(boost::format("StreamingKMeans: the first mini-batch has %d rows, needs at least k = %d") % rows % k);
+			}
+			seed_centroids(batch);
+			initialized = true;
+		}
+
+		std::vector<int> labels(rows);
+		assign(batch, TO_ARRAY(labels), nullptr, threads);
+
+		// group the rows by centroid, so that each centroid is updated by one task
+		std::vector<size_t> offsets(k + 1);
+		for (auto &&label : labels)
+		{
+			offsets[label + 1]++;
+		}
+		for (auto c = 0; c < k; c++)
+		{
+			offsets[c + 1] += offsets[c];
+		}
+		std::vector<size_t> members(rows);
+		{
+			auto next = offsets;
+			for (size_t i = 0; i < rows; i++)
+			{
+				members[next[labels[i]]++] = i;
+			}
+		}
+
+		parallel_for(
+			0,
+			k,
+			[&](size_t c)
+			{
+				auto added = offsets[c + 1] - offsets[c];
+				if (added == 0)
+				{
+					return;
+				}
+
+				std::vector<double> sum(dimensions);
+				for (auto m = offsets[c]; m < offsets[c + 1]; m++)
+				{
+					auto row = batch.row(members[m]);
+					for (auto j = 0; j < dimensions; j++)
+					{
+						sum[j] += row[j];
+					}
+				}
+
+				// the mean of all rows ever assigned to the centroid
+				auto centroid = centroids.row(c);
+				auto previous = (double)counts[c];
+				for (auto j = 0; j < dimensions; j++)
+				{
+					centroid[j] = (previous * centroid[j] + sum[j]) / (previous + added);
+				}
+				counts[c] += added;
+			},
+			threads);
+
+		seen += rows;
+	}
+
+	template <typename VALUE_T>
+	void StreamingKMeans<VALUE_T>::update(const VALUE_T* rows, size_t count, size_t batch_rows, uint threads)
+	{
+		if (batch_rows == 0)
+		{
+			throw Exception("StreamingKMeans: invalid mini-batch size 0");
+		}
+
+		CiphertextBatch<VALUE_T> scratch(std::min(batch_rows, count), dimensions);
+		for (size_t first = 0; first < count; first += batch_rows)
+		{
+			auto size = std::min(batch_rows, count - first);
+			for (size_t i = 0; i < size; i++)
+			{
+				std::copy(rows + (first + i) * dimensions, rows + (first + i + 1) * dimensions, scratch.row(i));
+			}
+			update(scratch.slice(0, size), threads);
+		}
+	}
+
+	template <typename VALUE_T>
+	void StreamingKMeans<VALUE_T>::assign(const CiphertextSlice<VALUE_T>& batch, int* labels, VALUE_T* distances, uint threads) const
+	{
+		TRACE_SCOPE("StreamingKMeans::assign");
+
+		if (batch.get_dimensions() != dimensions)
+		{
+			throw Exception(boost::format("StreamingKMeans: rows of %d dimensions, expected %d") % batch.get_dimensions() % dimensions);
+		}
+
+		auto rows	= batch.size();
+		auto stride = batch.get_stride();
+
+		parallel_for(
+			0,
+			(rows + CHUNK - 1) / CHUNK,
+			[&](size_t index)
+			{
+				for (auto i = index * CHUNK; i < std::min(rows, (index + 1) * CHUNK); i++)
+				{
+					auto best	  = 0;
+					auto shortest = aligned_squared_distance(batch.row(i), centroids.row(0), stride);
+					for (auto c = 1; c < k; c++)
+					{
+						auto distance = aligned_squared_distance(batch.row(i), centroids.row(c), stride);
+						if (distance < shortest)
+						{
+							best	 = c;
+							shortest = distance;
+						}
+					}
+
+					labels[i] = best;
+					if (distances)
+					{
+						distances[i] = shortest;
+					}
+				}
+			},
+			threads);
+	}
+
+	template <typename VALUE_T>
+	double StreamingKMeans<VALUE_T>::inertia(const CiphertextSlice<VALUE_T>& batch, uint threads) const
+	{
+		std::vector<int> labels(batch.size());
+		std::vector<VALUE_T> distances(batch.size());
+		assign(batch, TO_ARRAY(labels), TO_ARRAY(distances), threads);
+
+		auto result = 0.0;
+		for (auto &&distance : distances)
+		{
+			result += distance;
+		}
+		return result;
+	}
+
+	template <typename VALUE_T>
+	const VALUE_T* StreamingKMeans<VALUE_T>::centroid(int cluster) const
+	{
+		if (cluster < 0 || cluster >= k)
+		{
+			throw Exception(boost::format("StreamingKMeans: cluster %d is out of range (k = %d)") % cluster % k);
+		}
+
+		return centroids.row(cluster);
+	}
+
+	template <typename VALUE_T>
+	ull StreamingKMeans<VALUE_T>::count(int cluster) const
+	{
+		if (cluster < 0 || cluster >= k)
+		{
+			throw Exception(boost::format("StreamingKMeans: cluster %d is out of range (k = %d)") % cluster % k);
+		}
+
+		return counts[cluster];
+	}
+
+	template <typename VALUE_T>
+	size_t StreamingKMeans<VALUE_T>::get_seen() const
+	{
+		return seen;
+	}
+
+	template class StreamingKMeans<float>;
+	template class StreamingKMeans<double>;
+}
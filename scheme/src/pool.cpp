@@ -0,0 +1,181 @@
+#include "pool.hpp"
+
+#include "trace.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+
+namespace DCPE
+{
+	template <typename VALUE_T>
+	NoisePool<VALUE_T>::NoisePool(Scheme<VALUE_T>& scheme, const DCPE::key<VALUE_T>& key, int dimensions, size_t capacity, size_t low_watermark, size_t high_watermark, uint threads) :
+		scheme(scheme),
+		key(key),
+		dimensions(dimensions),
+		capacity(capacity),
+		low_watermark(low_watermark == 0 ? std::max(capacity / 4, (size_t)1) : low_watermark),
+		high_watermark(high_watermark == 0 ? capacity : high_watermark)
+	{
+		if (dimensions <= 0)
+		{
+			throw Exception(boost::format("NoisePool: invalid number of dimensions %d") % dimensions);
+		}
+
+		if (capacity == 0 || this->low_watermark > this->high_watermark || this->high_watermark > capacity)
+		{
+			throw Exception(boost::format("NoisePool: the watermarks have to satisfy low (%d) <= high (%d) <= capacity (%d), capacity > 0") % this->low_watermark % this->high_watermark % capacity);
+		}
+
+		lambdas.resize(capacity);
+		nonces.resize(capacity);
+
+		for (uint i = 0; i < threads; i++)
+		{
+			fillers.emplace_back(&NoisePool<VALUE_T>::fill_loop, this);
+		}
+	}
+
+	template <typename VALUE_T>
+	NoisePool<VALUE_T>::~NoisePool()
+	{
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+		refill.notify_all();
+
+		for (auto &&filler : fillers)
+		{
+			filler.join();
+		}
+	}
+
+	template <typename VALUE_T>
+	bool NoisePool<VALUE_T>::produce(std::pair<ull, ull>& nonce, std::vector<VALUE_T>& lambda_m)
+	{
+		nonce	 = {get_ramdom_ull(), get_ramdom_ull()};
+		lambda_m = scheme.compute_lambda_m(key, nonce, dimensions);
+
+		std::lock_guard lock(mutex);
+		if (size == capacity)
+		{
+			return false;
+		}
+
+		lambdas[head].swap(lambda_m);
+		nonces[head] = nonce;
+		head		 = (head + 1) % capacity;
+		size++;
+
+		return true;
+	}
+
+	template <typename VALUE_T>
+	void NoisePool<VALUE_T>::fill_loop()
+	{
+		std::pair<ull, ull> nonce;
+		std::vector<VALUE_T> lambda_m;
+
+		while (true)
+		{
+			{
+				std::unique_lock lock(mutex);
+				refill.wait(lock, [this]()
+							{ return stopping || refilling; });
+				if (stopping)
+				{
+					return;
+				}
+				if (size >= high_watermark)
+				{
+					refilling = false;
+					continue;
+				}
+			}
+
+			TRACE_SCOPE("NoisePool::refill");
+			produce(nonce, lambda_m);
+		}
+	}
+
+	template <typename VALUE_T>
+	std::pair<ull, ull> NoisePool<VALUE_T>::encrypt(const VALUE_T* message, VALUE_T* ciphertext)
+	{
+		TRACE_SCOPE("NoisePool::encrypt");
+
+		auto s = std::get<2>(key);
+
+		std::unique_lock lock(mutex);
+		if (size == 0)
+		{
+			misses++;
+			refilling = true;
+			lock.unlock();
+			refill.notify_all();
+
+			std::pair nonce = {get_ramdom_ull(), get_ramdom_ull()};
+			auto lambda_m	= scheme.compute_lambda_m(key, nonce, dimensions);
+			for (auto i = 0; i < dimensions; i++)
+			{
+				ciphertext[i] = message[i] * s + lambda_m[i];
+			}
+			return nonce;
+		}
+
+		hits++;
+		auto slot  = (head + capacity - size) % capacity;
+		auto nonce = nonces[slot];
+		std::vector<VALUE_T> lambda;
+		lambda.swap(lambdas[slot]);
+		size--;
+
+		auto wake = size < low_watermark && !refilling;
+		refilling = refilling || wake;
+		lock.unlock();
+		if (wake)
+		{
+			refill.notify_all();
+		}
+
+		for (auto i = 0; i < dimensions; i++)
+		{
+			ciphertext[i] = message[i] * s + lambda[i];
+		}
+
+		return nonce;
+	}
+
+	template <typename VALUE_T>
+	void NoisePool<VALUE_T>::fill()
+	{
+		std::pair<ull, ull> nonce;
+		std::vector<VALUE_T> lambda_m;
+		while (produce(nonce, lambda_m))
+		{
+		}
+	}
+
+	template <typename VALUE_T>
+	size_t NoisePool<VALUE_T>::available()
+	{
+		std::lock_guard lock(mutex);
+		return size;
+	}
+
+	template <typename VALUE_T>
+	size_t NoisePool<VALUE_T>::get_hits()
+	{
+		std::lock_guard lock(mutex);
+		return hits;
+	}
+
+	template <typename VALUE_T>
+	size_t NoisePool<VALUE_T>::get_misses()
+	{
+		std::lock_guard lock(mutex);
+		return misses;
+	}
+
+	template class NoisePool<float>;
+	template class NoisePool<double>;
+}
@@ -0,0 +1,394 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+
+namespace DCPE
+{
+	namespace
+	{
+		thread_local const Scheduler* current_scheduler = nullptr;
+		thread_local size_t current_worker				= 0;
+
+		std::mutex global_mutex;
+		std::unique_ptr<Scheduler> global_scheduler;
+		uint global_threads = 0;
+		bool global_pin		= true;
+
+		/**
+		 * @brief parses a kernel CPU list like "0-3,8,10-11"
+		 */
+		std::vector<int> parse_cpu_list(const std::string& list)
+		{
+			std::vector<int> cpus;
+			std::stringstream stream(list);
+			std::string range;
+			while (std::getline(stream, range, ','))
+			{
+				if (range.empty() || range == "\n")
+				{
+					continue;
+				}
+				auto dash  = range.find('-');
+				auto first = std::stoi(range.substr(0, dash));
+				auto last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+				for (auto cpu = first; cpu <= last; cpu++)
+				{
+					cpus.push_back(cpu);
+				}
+			}
+			return cpus;
+		}
+
+		/**
+		 * @brief the CPUs the process may run on with their NUMA nodes, ordered to alternate between the nodes
+		 *
+		 * Without /sys/devices/system/node (or on a single-node machine) all CPUs are on node 0.
+		 */
+		std::vector<std::pair<int, int>> topology()
+		{
+			cpu_set_t allowed;
+			CPU_ZERO(&allowed);
+			if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+			{
+				return {};
+			}
+
+			std::map<int, int> node_of;
+			std::error_code error;
+			for (auto &&entry : std::filesystem::directory_iterator("/sys/devices/system/node", error))
+			{
+				auto name = entry.path().filename().string();
+				if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+				{
+					continue;
+				}
+
+				std::ifstream file(entry.path() / "cpulist");
+				std::string list;
+				if (std::getline(file, list))
+				{
+					for (auto &&cpu : parse_cpu_list(list))
+					{
+						node_of[cpu] = std::stoi(name.substr(4));
+					}
+				}
+			}
+
+			std::map<int, std::vector<int>> nodes;
+			for (auto cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			{
+				if (CPU_ISSET(cpu, &allowed))
+				{
+					nodes[node_of.count(cpu) ? node_of[cpu] : 0].push_back(cpu);
+				}
+			}
+
+			std::vector<std::pair<int, int>> result;
+			for (size_t i = 0; result.size() < (size_t)CPU_COUNT(&allowed); i++)
+			{
+				for (auto &&[node, cpus] : nodes)
+				{
+					if (i < cpus.size())
+					{
+						result.push_back({cpus[i], node});
+					}
+				}
+			}
+			return result;
+		}
+	}
+
+	Scheduler::Scheduler(uint threads, bool pin)
+	{
+		auto cpus = topology();
+		if (threads == 0)
+		{
+			threads = std::max((uint)cpus.size(), 1u);
+		}
+
+		for (uint i = 0; i < threads; i++)
+		{
+			workers.push_back(std::make_unique<Worker>());
+			if (pin && !cpus.empty())
+			{
+				workers[i]->node = cpus[i % cpus.size()].second;
+			}
+		}
+
+		for (uint i = 0; i < threads; i++)
+		{
+			for (uint j = 1; j < threads; j++)
+			{
+				auto victim = (i + j) % threads;
+				if (workers[victim]->node == workers[i]->node)
+				{
+					workers[i]->victims.push_back(victim);
+				}
+			}
+			for (uint j = 1; j < threads; j++)
+			{
+				auto victim = (i + j) % threads;
+				if (workers[victim]->node != workers[i]->node)
+				{
+					workers[i]->victims.push_back(victim);
+				}
+			}
+		}
+
+		for (uint i = 0; i < threads; i++)
+		{
+			workers[i]->thread = std::thread(&Scheduler::work, this, i);
+			if (pin && !cpus.empty())
+			{
+				cpu_set_t set;
+				CPU_ZERO(&set);
+				CPU_SET(cpus[i % cpus.size()].first, &set);
+				// best effort, a container may not allow it
+				pthread_setaffinity_np(workers[i]->thread.native_handle(), sizeof(set), &set);
+			}
+		}
+	}
+
+	Scheduler::~Scheduler()
+	{
+		stopping = true;
+		{
+			std::lock_guard lock(sleep_mutex);
+		}
+		wake.notify_all();
+
+		for (auto &&worker : workers)
+		{
+			worker->thread.join();
+		}
+	}
+
+	size_t Scheduler::current() const
+	{
+		return current_scheduler == this ? current_worker : workers.size();
+	}
+
+	void Scheduler::submit(Task task)
+	{
+		auto index = current();
+		if (index == workers.size())
+		{
+			index = next++ % workers.size();
+		}
+
+		{
+			std::lock_guard lock(workers[index]->mutex);
+			workers[index]->tasks.push_back(std::move(task));
+		}
+		pending++;
+
+		{
+			std::lock_guard lock(sleep_mutex);
+		}
+		wake.notify_one();
+	}
+
+	bool Scheduler::take(size_t index, Task& task)
+	{
+		if (pending == 0)
+		{
+			return false;
+		}
+
+		if (index < workers.size())
+		{
+			auto& own = *workers[index];
+			std::lock_guard lock(own.mutex);
+			if (!own.tasks.empty())
+			{
+				task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				pending--;
+				return true;
+			}
+		}
+
+		auto steal = [&](Worker& victim)
+		{
+			std::lock_guard lock(victim.mutex);
+			if (victim.tasks.empty())
+			{
+				return false;
+			}
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			pending--;
+			return true;
+		};
+
+		if (index < workers.size())
+		{
+			for (auto &&victim : workers[index]->victims)
+			{
+				if (steal(*workers[victim]))
+				{
+					return true;
+				}
+			}
+		}
+		else
+		{
+			auto start = next++;
+			for (size_t i = 0; i < workers.size(); i++)
+			{
+				if (steal(*workers[(start + i) % workers.size()]))
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	void Scheduler::work(size_t index)
+	{
+		current_scheduler = this;
+		current_worker	  = index;
+
+		Task task;
+		while (true)
+		{
+			if (take(index, task))
+			{
+				task();
+				task = nullptr;
+				continue;
+			}
+
+			std::unique_lock lock(sleep_mutex);
+			if (stopping && pending == 0)
+			{
+				return;
+			}
+			wake.wait(lock, [this]()
+					  { return stopping || pending > 0; });
+		}
+	}
+
+	bool Scheduler::run_one()
+	{
+		Task task;
+		if (!take(current(), task))
+		{
+			return false;
+		}
+		task();
+		return true;
+	}
+
+	uint Scheduler::size() const
+	{
+		return workers.size();
+	}
+
+	int Scheduler::node_of(uint worker) const
+	{
+		if (worker >= workers.size())
+		{
+			throw Exception(boost::format("Scheduler: worker %d is out of range (%d workers)") % worker % workers.size());
+		}
+
+		return workers[worker]->node;
+	}
+
+	Scheduler& Scheduler::global()
+	{
+		std::lock_guard lock(global_mutex);
+		if (!global_scheduler)
+		{
+			global_scheduler = std::make_unique<Scheduler>(global_threads, global_pin);
+		}
+		return *global_scheduler;
+	}
+
+	void Scheduler::configure_global(uint threads, bool pin)
+	{
+		std::lock_guard lock(global_mutex);
+		if (global_scheduler)
+		{
+			throw Exception(boost::format("Scheduler: the global scheduler has already started with %d workers") % global_scheduler->size());
+		}
+
+		global_threads = threads;
+		global_pin	   = pin;
+	}
+
+	TaskGroup::TaskGroup(Scheduler& scheduler) :
+		scheduler(scheduler) {}
+
+	TaskGroup::~TaskGroup()
+	{
+		try
+		{
+			wait();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	void TaskGroup::run(Scheduler::Task task)
+	{
+		remaining++;
+		scheduler.submit(
+			[this, task = std::move(task)]()
+			{
+				try
+				{
+					task();
+				}
+				catch (...)
+				{
+					std::lock_guard lock(mutex);
+					if (!error)
+					{
+						error = std::current_exception();
+					}
+				}
+
+				// everything happens under the lock, so that wait cannot return (and the group be destroyed) in between
+				std::lock_guard lock(mutex);
+				if (--remaining == 0)
+				{
+					done.notify_all();
+				}
+			});
+	}
+
+	void TaskGroup::wait()
+	{
+		while (remaining > 0)
+		{
+			if (scheduler.run_one())
+			{
+				continue;
+			}
+
+			// nothing to help with, sleep until the group is done or, in case a running task submits more, a little while
+			std::unique_lock lock(mutex);
+			done.wait_for(lock, std::chrono::microseconds(100), [this]()
+						  { return remaining == 0; });
+		}
+
+		std::lock_guard lock(mutex);
+		if (error)
+		{
+			auto first = error;
+			error	   = nullptr;
+			std::rethrow_exception(first);
+		}
+	}
+}
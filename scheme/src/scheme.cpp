@@ -1,7 +1,10 @@
 #include "scheme.hpp"
 
+#include "trace.hpp"
 #include "utility.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <cmath>
 #include <numeric>
 
@@ -14,15 +17,68 @@ namespace DCPE
 	template <typename VALUE_T>
 	key<VALUE_T> Scheme<VALUE_T>::keygen()
 	{
+		TRACE_SCOPE("Scheme::keygen");
+
 		return {
 			get_ramdom_ull(ULLONG_MAX),
 			get_ramdom_ull(ULLONG_MAX),
-			sample_uniform<VALUE_T>(0.000001, max_s, get_ramdom_ull(ULLONG_MAX))};
+			sample_uniform<VALUE_T>(min_s, max_s, get_ramdom_ull(ULLONG_MAX))};
+	}
+
+	template <typename VALUE_T>
+	void Scheme<VALUE_T>::keygen_batch(size_t n, key<VALUE_T>* out, uint threads)
+	{
+		TRACE_SCOPE("Scheme::keygen_batch");
+
+		if (n == 0)
+		{
+			return;
+		}
+
+		if (n > INT_MAX / (3 * sizeof(ull)))
+		{
+			throw Exception(boost::format("keygen_batch: too many keys requested at once: %d") % n);
+		}
+
+		// three columns of n words: first key parts, second key parts and coins for s
+		auto material = get_random_bytes(3 * n * sizeof(ull));
+		auto words	  = reinterpret_cast<const ull*>(TO_ARRAY(material));
+
+		const size_t chunk = 1 << 12;
+		auto chunks		   = (n + chunk - 1) / chunk;
+		auto width		   = (double)max_s - (double)min_s;
+
+		parallel_for(
+			0,
+			chunks,
+			[&](size_t index)
+			{
+				auto begin = index * chunk;
+				auto end   = std::min(n, begin + chunk);
+
+				// the top 52 bits of each word become the mantissa of a double in [1, 2);
+				// unlike an integer to floating point conversion, this is plain bit work the compiler vectorizes
+				VALUE_T s[chunk];
+				auto coins = words + 2 * n + begin;
+				for (size_t i = 0; i < end - begin; i++)
+				{
+					auto unit = std::bit_cast<double>((coins[i] >> 12) | 0x3FF0000000000000uLL) - 1.0;
+					s[i]	  = min_s + (VALUE_T)(width * unit);
+				}
+
+				for (auto i = begin; i < end; i++)
+				{
+					out[i] = {words[i], words[n + i], s[i - begin]};
+				}
+			},
+			threads);
 	}
 
 	template <typename VALUE_T>
 	std::pair<ull, ull> Scheme<VALUE_T>::encrypt(key<VALUE_T>& key, const VALUE_T* message, int dimensions, VALUE_T* ciphertext)
 	{
+		TRACE_SCOPE("Scheme::encrypt");
+
 		std::pair nonce = {get_ramdom_ull(), get_ramdom_ull()};
 
 		auto lambda_m = compute_lambda_m(key, nonce, dimensions);
@@ -35,9 +91,32 @@ namespace DCPE
 		return nonce;
 	}
 
+	template <typename VALUE_T>
+	template <typename INPUT_T>
+	std::pair<ull, ull> Scheme<VALUE_T>::encrypt(key<VALUE_T>& key, const INPUT_T* message, int dimensions, VALUE_T* ciphertext, VALUE_T scale, VALUE_T offset)
+	{
+		TRACE_SCOPE("Scheme::encrypt quantized");
+
+		std::pair nonce = {get_ramdom_ull(), get_ramdom_ull()};
+
+		auto lambda_m = compute_lambda_m(key, nonce, dimensions);
+
+		// (scale * q + offset) * s + lambda = q * (scale * s) + (offset * s + lambda)
+		auto factor = scale * std::get<2>(key);
+		auto shift	= offset * std::get<2>(key);
+		for (auto i = 0; i < dimensions; i++)
+		{
+			ciphertext[i] = static_cast<VALUE_T>(message[i]) * factor + (shift + lambda_m[i]);
+		}
+
+		return nonce;
+	}
+
 	template <typename VALUE_T>
 	void Scheme<VALUE_T>::decrypt(key<VALUE_T>& key, const VALUE_T* ciphertext, int dimensions, std::pair<ull, ull>& nonce, VALUE_T* message)
 	{
+		TRACE_SCOPE("Scheme::decrypt");
+
 		auto lambda_m = compute_lambda_m(key, nonce, dimensions);
 
 		for (auto i = 0; i < dimensions; i++)
@@ -49,12 +128,16 @@ namespace DCPE
 	template <typename VALUE_T>
 	std::vector<VALUE_T> Scheme<VALUE_T>::compute_lambda_m(key<VALUE_T>& key, std::pair<ull, ull>& nonce, int dimensions)
 	{
+		TRACE_SCOPE("Scheme::compute_lambda_m");
+
 		auto radius = (std::get<2>(key) / 4) * beta;
 
 		auto u = sample_normal_multivariate_identity<VALUE_T>(0.0, dimensions, std::get<0>(key) ^ nonce.first);
 
 		auto x_prime = sample_uniform<VALUE_T>(0.0, 1.0, std::get<1>(key) ^ nonce.second);
 
+		TRACE_SCOPE("pow, sqrt and scaling");
+
 		auto x = radius * pow(x_prime, 1.0 / dimensions);
 
 		std::vector<VALUE_T> lambda_m;
@@ -68,6 +151,28 @@ namespace DCPE
 		return lambda_m;
 	}
 
+	template <typename VALUE_T>
+	VALUE_T Scheme<VALUE_T>::ciphertext_radius(const key<VALUE_T>& key, VALUE_T radius) const
+	{
+		if (radius < 0.0)
+		{
+			throw Exception(boost::format("Invalid radius: %f") % radius);
+		}
+
+		return std::get<2>(key) * (radius + beta / 2);
+	}
+
+	template <typename VALUE_T>
+	VALUE_T Scheme<VALUE_T>::certain_radius(const key<VALUE_T>& key, VALUE_T radius) const
+	{
+		if (radius < 0.0)
+		{
+			throw Exception(boost::format("Invalid radius: %f") % radius);
+		}
+
+		return std::max(std::get<2>(key) * (radius - beta / 2), (VALUE_T)0.0);
+	}
+
 	template <typename VALUE_T>
 	void Scheme<VALUE_T>::set_max_s(VALUE_T max_s)
 	{
@@ -81,4 +186,11 @@ namespace DCPE
 
 	template class Scheme<float>;
 	template class Scheme<double>;
+
+	template std::pair<ull, ull> Scheme<float>::encrypt<int8_t>(key<float>& key, const int8_t* message, int dimensions, float* ciphertext, float scale, float offset);
+	template std::pair<ull, ull> Scheme<float>::encrypt<uint8_t>(key<float>& key, const uint8_t* message, int dimensions, float* ciphertext, float scale, float offset);
+	template std::pair<ull, ull> Scheme<float>::encrypt<half>(key<float>& key, const half* message, int dimensions, float* ciphertext, float scale, float offset);
+	template std::pair<ull, ull> Scheme<double>::encrypt<int8_t>(key<double>& key, const int8_t* message, int dimensions, double* ciphertext, double scale, double offset);
+	template std::pair<ull, ull> Scheme<double>::encrypt<uint8_t>(key<double>& key, const uint8_t* message, int dimensions, double* ciphertext, double scale, double offset);
+	template std::pair<ull, ull> Scheme<double>::encrypt<half>(key<double>& key, const half* message, int dimensions, double* ciphertext, double scale, double offset);
 }
@@ -0,0 +1,766 @@
+#include "shard.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace DCPE
+{
+	namespace
+	{
+		enum class Operation : byte
+		{
+			Insert = 1,
+			Remove,
+			Search,
+			Size
+		};
+
+		enum class Status : byte
+		{
+			Ok = 0,
+			Error
+		};
+
+		/**
+		 * @brief the largest frame accepted from a socket, so that a corrupted or hostile length cannot exhaust memory
+		 */
+		const ull MAX_FRAME = 1uLL << 30;
+
+		/**
+		 * @brief appends the raw bytes of values to the message
+		 *
+		 */
+		template <typename T>
+		void put(bytes& message, const T* values, size_t count = 1)
+		{
+			auto start = reinterpret_cast<const byte*>(values);
+			message.insert(message.end(), start, start + count * sizeof(T));
+		}
+
+		/**
+		 * @brief reads values from a message front to back, throwing if the message is too short
+		 *
+		 */
+		class MessageReader
+		{
+			private:
+			const bytes& message;
+			size_t offset = 0;
+
+			public:
+			explicit MessageReader(const bytes& message) :
+				message(message) {}
+
+			template <typename T>
+			void get(T* values, size_t count = 1)
+			{
+				if (offset + count * sizeof(T) > message.size())
+				{
+					throw Exception(boost::format("Shard: truncated message (%d bytes)") % message.size());
+				}
+				std::memcpy(static_cast<void*>(values), message.data() + offset, count * sizeof(T));
+				offset += count * sizeof(T);
+			}
+
+			template <typename T>
+			T get()
+			{
+				T value;
+				get(&value);
+				return value;
+			}
+
+			bool done() const
+			{
+				return offset == message.size();
+			}
+
+			size_t remaining() const
+			{
+				return message.size() - offset;
+			}
+		};
+
+		/**
+		 * @brief strips the status from a response, rethrowing the error of the worker if there is one
+		 *
+		 */
+		bytes unwrap(const bytes& response)
+		{
+			MessageReader reader(response);
+			if (reader.get<Status>() == Status::Ok)
+			{
+				return bytes(response.begin() + 1, response.end());
+			}
+
+			throw Exception(std::string(response.begin() + 1, response.end()));
+		}
+	}
+
+	template <typename VALUE_T>
+	ShardWorker<VALUE_T>::ShardWorker(int dimensions, size_t segment_capacity) :
+		store(dimensions, segment_capacity) {}
+
+	template <typename VALUE_T>
+	bytes ShardWorker<VALUE_T>::handle(const bytes& request)
+	{
+		bytes response = {(byte)Status::Ok};
+		try
+		{
+			auto dimensions = store.get_dimensions();
+			std::vector<VALUE_T> vector;
+			vector.resize(dimensions);
+
+			MessageReader reader(request);
+			auto operation = reader.get<Operation>();
+			switch (operation)
+			{
+				case Operation::Insert:
+				{
+					auto id	   = reader.get<ull>();
+					auto nonce = reader.get<std::pair<ull, ull>>();
+					reader.get(TO_ARRAY(vector), dimensions);
+					store.insert(id, TO_ARRAY(vector), nonce);
+					break;
+				}
+				case Operation::Remove:
+				{
+					auto removed = (byte)store.remove(reader.get<ull>());
+					put(response, &removed);
+					break;
+				}
+				case Operation::Search:
+				{
+					auto k = reader.get<int>();
+					reader.get(TO_ARRAY(vector), dimensions);
+					auto neighbors = store.search(TO_ARRAY(vector), k);
+					auto count	   = (ull)neighbors.size();
+					put(response, &count);
+					// field by field, so that the padding of Neighbor is not sent
+					for (auto &&neighbor : neighbors)
+					{
+						put(response, &neighbor.id);
+						put(response, &neighbor.distance);
+					}
+					break;
+				}
+				case Operation::Size:
+				{
+					auto size = (ull)store.size();
+					put(response, &size);
+					break;
+				}
+				default:
+					throw Exception(boost::format("Shard: unknown operation %d") % (int)operation);
+			}
+
+			if (!reader.done())
+			{
+				throw Exception(boost::format("Shard: request of operation %d is too long (%d bytes)") % (int)operation % request.size());
+			}
+		}
+		catch (const std::exception& error)
+		{
+			std::string message = error.what();
+			response			= {(byte)Status::Error};
+			put(response, message.c_str(), message.size());
+		}
+
+		return response;
+	}
+
+	template class ShardWorker<float>;
+	template class ShardWorker<double>;
+
+	template <typename VALUE_T>
+	InProcessTransport<VALUE_T>::InProcessTransport(int dimensions, size_t segment_capacity, uint threads) :
+		worker(dimensions, segment_capacity)
+	{
+		if (threads == 0)
+		{
+			throw Exception("InProcessTransport: at least one thread is required");
+		}
+
+		for (uint i = 0; i < threads; i++)
+		{
+			servers.emplace_back(&InProcessTransport<VALUE_T>::serve, this);
+		}
+	}
+
+	template <typename VALUE_T>
+	InProcessTransport<VALUE_T>::~InProcessTransport()
+	{
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+		changed.notify_all();
+		for (auto &&server : servers)
+		{
+			server.join();
+		}
+	}
+
+	template <typename VALUE_T>
+	void InProcessTransport<VALUE_T>::serve()
+	{
+		while (true)
+		{
+			bytes request;
+			ull number;
+			{
+				std::unique_lock lock(mutex);
+				changed.wait(lock, [this]()
+							 { return stopping || !requests.empty(); });
+				if (stopping)
+				{
+					return;
+				}
+				request = std::move(requests.front());
+				requests.pop_front();
+				number = taken++;
+			}
+
+			auto response = worker.handle(request);
+
+			{
+				std::lock_guard lock(mutex);
+				responses.emplace(number, std::move(response));
+			}
+			changed.notify_all();
+		}
+	}
+
+	template <typename VALUE_T>
+	void InProcessTransport<VALUE_T>::send(const bytes& request)
+	{
+		{
+			std::lock_guard lock(mutex);
+			requests.push_back(request);
+		}
+		changed.notify_all();
+	}
+
+	template <typename VALUE_T>
+	bytes InProcessTransport<VALUE_T>::receive()
+	{
+		std::unique_lock lock(mutex);
+		changed.wait(lock, [this]()
+					 { return !responses.empty() && responses.begin()->first == delivered; });
+		auto response = std::move(responses.begin()->second);
+		responses.erase(responses.begin());
+		delivered++;
+
+		return response;
+	}
+
+	template class InProcessTransport<float>;
+	template class InProcessTransport<double>;
+
+	namespace
+	{
+		/**
+		 * @brief writes the whole buffer to a socket
+		 *
+		 */
+		void write_all(int connection, const byte* data, size_t size)
+		{
+			while (size > 0)
+			{
+				auto written = ::send(connection, data, size, MSG_NOSIGNAL);
+				if (written < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw Exception(boost::format("Shard: failed to write to socket: %s") % strerror(errno));
+				}
+				data += written;
+				size -= written;
+			}
+		}
+
+		/**
+		 * @brief reads exactly size bytes from a socket
+		 *
+		 * @return false if the peer closed the connection before sending anything
+		 */
+		bool read_all(int connection, byte* data, size_t size)
+		{
+			auto total = size;
+			while (size > 0)
+			{
+				auto received = ::recv(connection, data, size, 0);
+				if (received < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (received <= 0)
+				{
+					if (size == total)
+					{
+						return false;
+					}
+					throw Exception(boost::format("Shard: connection lost mid-message: %s") % (received < 0 ? strerror(errno) : "end of stream"));
+				}
+				data += received;
+				size -= received;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief sends a message prefixed with its length
+		 *
+		 */
+		void write_frame(int connection, const bytes& message)
+		{
+			auto size = (ull)message.size();
+			write_all(connection, reinterpret_cast<const byte*>(&size), sizeof(size));
+			write_all(connection, TO_ARRAY(message), message.size());
+		}
+
+		/**
+		 * @brief receives a message prefixed with its length
+		 *
+		 * @return false if the peer closed the connection between messages
+		 */
+		bool read_frame(int connection, bytes& message)
+		{
+			ull size;
+			if (!read_all(connection, reinterpret_cast<byte*>(&size), sizeof(size)))
+			{
+				return false;
+			}
+			if (size > MAX_FRAME)
+			{
+				throw Exception(boost::format("Shard: frame of %d bytes exceeds the limit of %d bytes") % size % MAX_FRAME);
+			}
+
+			message.resize(size);
+			if (size > 0 && !read_all(connection, TO_ARRAY(message), size))
+			{
+				throw Exception("Shard: connection lost mid-message");
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief fills a socket address, checking that the path fits
+		 *
+		 */
+		sockaddr_un socket_address(const std::string& path)
+		{
+			sockaddr_un address;
+			std::memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			if (path.size() >= sizeof(address.sun_path))
+			{
+				throw Exception(boost::format("Shard: socket path is too long: %s") % path);
+			}
+			std::strcpy(address.sun_path, path.c_str());
+
+			return address;
+		}
+	}
+
+	UnixSocketTransport::UnixSocketTransport(const std::string& path, int timeout_ms)
+	{
+		auto address  = socket_address(path);
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		while (true)
+		{
+			connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (connection < 0)
+			{
+				throw Exception(boost::format("Shard: failed to create socket: %s") % strerror(errno));
+			}
+
+			if (::connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+			{
+				return;
+			}
+
+			auto error = errno;
+			::close(connection);
+			if (std::chrono::steady_clock::now() >= deadline)
+			{
+				throw Exception(boost::format("Shard: failed to connect to %s: %s") % path % strerror(error));
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+
+	UnixSocketTransport::~UnixSocketTransport()
+	{
+		::close(connection);
+	}
+
+	void UnixSocketTransport::send(const bytes& request)
+	{
+		write_frame(connection, request);
+	}
+
+	bytes UnixSocketTransport::receive()
+	{
+		bytes response;
+		if (!read_frame(connection, response))
+		{
+			throw Exception("Shard: worker closed the connection");
+		}
+
+		return response;
+	}
+
+	template <typename VALUE_T>
+	ShardServer<VALUE_T>::ShardServer(const std::string& path, int dimensions, size_t segment_capacity) :
+		path(path),
+		worker(dimensions, segment_capacity)
+	{
+		auto address = socket_address(path);
+
+		listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0)
+		{
+			throw Exception(boost::format("Shard: failed to create socket: %s") % strerror(errno));
+		}
+
+		::unlink(path.c_str());
+		if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, SOMAXCONN) != 0)
+		{
+			auto error = errno;
+			::close(listener);
+			throw Exception(boost::format("Shard: failed to listen on %s: %s") % path % strerror(error));
+		}
+	}
+
+	template <typename VALUE_T>
+	ShardServer<VALUE_T>::~ShardServer()
+	{
+		stopping = true;
+		::shutdown(listener, SHUT_RDWR);
+		if (acceptor.joinable())
+		{
+			acceptor.join();
+		}
+
+		{
+			std::lock_guard lock(connections_mutex);
+			for (auto &&connection : connections)
+			{
+				::shutdown(connection, SHUT_RDWR);
+			}
+		}
+		for (auto &&handler : handlers)
+		{
+			handler.join();
+		}
+
+		::close(listener);
+		::unlink(path.c_str());
+	}
+
+	template <typename VALUE_T>
+	void ShardServer<VALUE_T>::serve()
+	{
+		while (!stopping)
+		{
+			auto connection = ::accept(listener, nullptr, nullptr);
+			if (connection < 0)
+			{
+				if (errno == EINTR || errno == ECONNABORTED)
+				{
+					continue;
+				}
+				return;
+			}
+
+			std::lock_guard lock(connections_mutex);
+			if (stopping)
+			{
+				::close(connection);
+				return;
+			}
+			reap_handlers();
+			connections.push_back(connection);
+			handlers.emplace_back(&ShardServer<VALUE_T>::handle_connection, this, connection);
+		}
+	}
+
+	template <typename VALUE_T>
+	void ShardServer<VALUE_T>::start()
+	{
+		acceptor = std::thread(&ShardServer<VALUE_T>::serve, this);
+	}
+
+	template <typename VALUE_T>
+	size_t ShardServer<VALUE_T>::handler_count()
+	{
+		std::lock_guard lock(connections_mutex);
+		return handlers.size();
+	}
+
+	template <typename VALUE_T>
+	void ShardServer<VALUE_T>::reap_handlers()
+	{
+		// a finished handler has released the mutex for good, so joining it here does not wait on us
+		for (auto &&id : finished)
+		{
+			auto handler = std::find_if(handlers.begin(), handlers.end(), [&](const std::thread& thread) { return thread.get_id() == id; });
+			handler->join();
+			handlers.erase(handler);
+		}
+		finished.clear();
+	}
+
+	template <typename VALUE_T>
+	void ShardServer<VALUE_T>::handle_connection(int connection)
+	{
+		try
+		{
+			bytes request;
+			while (read_frame(connection, request))
+			{
+				write_frame(connection, worker.handle(request));
+			}
+		}
+		catch (const std::exception&)
+		{
+			// the client is gone or sent a broken frame, nothing to answer; the other connections carry on
+		}
+
+		std::lock_guard lock(connections_mutex);
+		connections.erase(std::find(connections.begin(), connections.end(), connection));
+		::close(connection);
+		finished.push_back(std::this_thread::get_id());
+	}
+
+	template class ShardServer<float>;
+	template class ShardServer<double>;
+
+	template <typename VALUE_T>
+	ShardProcess<VALUE_T>::ShardProcess(const std::string& path, int dimensions, size_t segment_capacity) :
+		path(path)
+	{
+		::unlink(path.c_str());
+
+		pid = ::fork();
+		if (pid < 0)
+		{
+			throw Exception(boost::format("Shard: failed to fork: %s") % strerror(errno));
+		}
+
+		if (pid == 0)
+		{
+			try
+			{
+				ShardServer<VALUE_T> server(path, dimensions, segment_capacity);
+				server.serve();
+			}
+			catch (...)
+			{
+				_exit(1);
+			}
+			_exit(0);
+		}
+	}
+
+	template <typename VALUE_T>
+	ShardProcess<VALUE_T>::~ShardProcess()
+	{
+		::kill(pid, SIGTERM);
+		::waitpid(pid, nullptr, 0);
+		::unlink(path.c_str());
+	}
+
+	template class ShardProcess<float>;
+	template class ShardProcess<double>;
+
+	template <typename VALUE_T>
+	ShardedStore<VALUE_T>::ShardedStore(int dimensions, std::vector<std::unique_ptr<Transport>> shards) :
+		dimensions(dimensions),
+		shards(std::move(shards))
+	{
+		if (this->shards.empty())
+		{
+			throw Exception("ShardedStore: at least one shard is required");
+		}
+
+		for (size_t i = 0; i < this->shards.size(); i++)
+		{
+			channels.push_back(std::make_unique<Channel>());
+		}
+	}
+
+	template <typename VALUE_T>
+	size_t ShardedStore<VALUE_T>::shard_of(ull id) const
+	{
+		// splitmix64 finalizer, so that sequential ids spread evenly
+		id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9uLL;
+		id = (id ^ (id >> 27)) * 0x94d049bb133111ebuLL;
+		id = id ^ (id >> 31);
+
+		return id % shards.size();
+	}
+
+	template <typename VALUE_T>
+	ull ShardedStore<VALUE_T>::send(size_t shard, const bytes& request)
+	{
+		auto& channel = *channels[shard];
+		std::lock_guard lock(channel.send_mutex);
+		shards[shard]->send(request);
+
+		return channel.sent++;
+	}
+
+	template <typename VALUE_T>
+	bytes ShardedStore<VALUE_T>::receive(size_t shard, ull ticket)
+	{
+		auto& channel = *channels[shard];
+		std::unique_lock lock(channel.receive_mutex);
+		channel.turn.wait(lock, [&]()
+						  { return channel.received == ticket; });
+
+		bytes response;
+		try
+		{
+			response = shards[shard]->receive();
+		}
+		catch (...)
+		{
+			// pass the turn on anyway, the next callers get the error of the broken transport themselves
+			channel.received++;
+			channel.turn.notify_all();
+			throw;
+		}
+		channel.received++;
+		lock.unlock();
+		channel.turn.notify_all();
+
+		return response;
+	}
+
+	template <typename VALUE_T>
+	bytes ShardedStore<VALUE_T>::call(size_t shard, const bytes& request)
+	{
+		return unwrap(receive(shard, send(shard, request)));
+	}
+
+	template <typename VALUE_T>
+	void ShardedStore<VALUE_T>::insert(ull id, const VALUE_T* ciphertext, const std::pair<ull, ull>& nonce)
+	{
+		bytes request = {(byte)Operation::Insert};
+		request.reserve(1 + sizeof(id) + sizeof(nonce) + dimensions * sizeof(VALUE_T));
+		put(request, &id);
+		put(request, &nonce);
+		put(request, ciphertext, dimensions);
+
+		call(shard_of(id), request);
+	}
+
+	template <typename VALUE_T>
+	bool ShardedStore<VALUE_T>::remove(ull id)
+	{
+		bytes request = {(byte)Operation::Remove};
+		put(request, &id);
+
+		auto response = call(shard_of(id), request);
+		MessageReader reader(response);
+
+		return reader.get<byte>() != 0;
+	}
+
+	template <typename VALUE_T>
+	std::vector<Neighbor<VALUE_T>> ShardedStore<VALUE_T>::search(const VALUE_T* query, const int k)
+	{
+		bytes request = {(byte)Operation::Search};
+		put(request, &k);
+		put(request, query, dimensions);
+
+		std::exception_ptr error;
+		std::vector<ull> tickets;
+		for (size_t shard = 0; shard < shards.size() && !error; shard++)
+		{
+			try
+			{
+				tickets.push_back(send(shard, request));
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+		}
+
+		// every ticket has to be received, even if some are errors, to keep the shards in order;
+		// receiving in shard order, like every caller, cannot deadlock
+		std::vector<bytes> responses;
+		for (size_t shard = 0; shard < tickets.size(); shard++)
+		{
+			try
+			{
+				responses.push_back(receive(shard, tickets[shard]));
+			}
+			catch (...)
+			{
+				error = error ? error : std::current_exception();
+			}
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+
+		std::vector<std::vector<Neighbor<VALUE_T>>> results;
+		for (auto &&response : responses)
+		{
+			auto payload = unwrap(response);
+			MessageReader reader(payload);
+
+			auto count = reader.get<ull>();
+			if (count > reader.remaining() / (sizeof(ull) + sizeof(VALUE_T)))
+			{
+				throw Exception(boost::format("Shard: response claims %d results in %d bytes") % count % reader.remaining());
+			}
+
+			std::vector<Neighbor<VALUE_T>> neighbors;
+			neighbors.resize(count);
+			for (auto &&neighbor : neighbors)
+			{
+				reader.get(&neighbor.id);
+				reader.get(&neighbor.distance);
+			}
+			results.push_back(std::move(neighbors));
+		}
+
+		return merge_neighbors(results, k);
+	}
+
+	template <typename VALUE_T>
+	size_t ShardedStore<VALUE_T>::size()
+	{
+		bytes request = {(byte)Operation::Size};
+
+		size_t size = 0;
+		for (size_t shard = 0; shard < shards.size(); shard++)
+		{
+			auto response = call(shard, request);
+			MessageReader reader(response);
+			size += reader.get<ull>();
+		}
+
+		return size;
+	}
+
+	template class ShardedStore<float>;
+	template class ShardedStore<double>;
+}
@@ -0,0 +1,228 @@
+#include "sketch.hpp"
+
+#include "trace.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace DCPE
+{
+	namespace
+	{
+		/**
+		 * @brief the number of rows a task takes at once while sketching
+		 */
+		const size_t CHUNK = 1 << 6;
+
+		int checked_width(SketchKind kind, int width)
+		{
+			if (width <= 0 || (kind == SketchKind::Signs && width % 64 != 0))
+			{
+				throw Exception(boost::format("SketchFilter: invalid width %d (has to be positive, and a multiple of 64 for sign sketches)") % width);
+			}
+
+			return width;
+		}
+	}
+
+	template <typename VALUE_T>
+	SketchFilter<VALUE_T>::SketchFilter(const CiphertextSlice<VALUE_T>& batch, SketchKind kind, int width, ull seed, uint threads) :
+		batch(batch),
+		kind(kind),
+		width(checked_width(kind, width)),
+		projection(width, batch.get_dimensions()),
+		offset(width),
+		projections(kind == SketchKind::Projections ? batch.size() : 0, width),
+		projected_rows(projections.view())
+	{
+		TRACE_SCOPE("SketchFilter::build");
+
+		auto dimensions = batch.get_dimensions();
+		auto rows		= batch.size();
+
+		auto samples = sample_normal_series<VALUE_T>(0.0, 1.0, seed, width * dimensions);
+		for (auto r = 0; r < width; r++)
+		{
+			std::copy(samples.begin() + r * dimensions, samples.begin() + (r + 1) * dimensions, projection.row(r));
+		}
+
+		// the mean row, summed in double to keep the rounding of large batches down
+		std::vector<double> sum(dimensions);
+		for (size_t i = 0; i < rows; i++)
+		{
+			for (auto j = 0; j < dimensions; j++)
+			{
+				sum[j] += batch.row(i)[j];
+			}
+		}
+		CiphertextBatch<VALUE_T> center(1, dimensions);
+		for (auto j = 0; j < dimensions && rows > 0; j++)
+		{
+			center.row(0)[j] = sum[j] / rows;
+		}
+		for (auto r = 0; r < width; r++)
+		{
+			offset[r] = aligned_dot_product(projection.row(r), center.row(0), projection.get_stride());
+		}
+
+		if (kind == SketchKind::Signs)
+		{
+			signs.resize(rows * width / 64);
+		}
+
+		parallel_for(
+			0,
+			(rows + CHUNK - 1) / CHUNK,
+			[&](size_t index)
+			{
+				std::vector<VALUE_T> projected(width);
+				for (auto i = index * CHUNK; i < std::min(rows, (index + 1) * CHUNK); i++)
+				{
+					if (kind == SketchKind::Signs)
+					{
+						project(batch.row(i), TO_ARRAY(projected));
+						pack(TO_ARRAY(projected), TO_ARRAY(signs) + i * width / 64);
+					}
+					else
+					{
+						project(batch.row(i), projections.row(i));
+					}
+				}
+			},
+			threads);
+	}
+
+	template <typename VALUE_T>
+	void SketchFilter<VALUE_T>::project(const VALUE_T* row, VALUE_T* out) const
+	{
+		for (auto r = 0; r < width; r++)
+		{
+			out[r] = aligned_dot_product(projection.row(r), row, projection.get_stride()) - offset[r];
+		}
+	}
+
+	template <typename VALUE_T>
+	void SketchFilter<VALUE_T>::pack(const VALUE_T* projected, uint64_t* out) const
+	{
+		for (auto word = 0; word < width / 64; word++)
+		{
+			uint64_t bits = 0;
+			for (auto bit = 0; bit < 64; bit++)
+			{
+				bits |= (uint64_t)(projected[word * 64 + bit] >= 0) << bit;
+			}
+			out[word] = bits;
+		}
+	}
+
+	template <typename VALUE_T>
+	std::vector<size_t> SketchFilter<VALUE_T>::prefilter(const VALUE_T* query, size_t candidates) const
+	{
+		TRACE_SCOPE("SketchFilter::prefilter");
+
+		auto rows  = batch.size();
+		candidates = std::min(candidates, rows);
+		if (candidates == 0)
+		{
+			return {};
+		}
+
+		CiphertextBatch<VALUE_T> padded(1, batch.get_dimensions());
+		std::copy(query, query + batch.get_dimensions(), padded.row(0));
+		std::vector<VALUE_T> projected(width);
+		project(padded.row(0), TO_ARRAY(projected));
+
+		std::vector<size_t> result;
+		result.reserve(candidates);
+
+		if (kind == SketchKind::Signs)
+		{
+			const auto words = width / 64;
+			std::vector<uint64_t> sketch(words);
+			pack(TO_ARRAY(projected), TO_ARRAY(sketch));
+
+			std::vector<uint32_t> distances(rows);
+			std::vector<size_t> histogram(width + 1);
+			for (size_t i = 0; i < rows; i++)
+			{
+				auto row	  = TO_ARRAY(signs) + i * words;
+				uint distance = 0;
+				for (auto w = 0; w < words; w++)
+				{
+					distance += std::popcount(row[w] ^ sketch[w]);
+				}
+				distances[i] = distance;
+				histogram[distance]++;
+			}
+
+			// everything below the threshold is in, and as many as fit of those at it
+			size_t threshold = 0, below = 0;
+			while (below + histogram[threshold] < candidates)
+			{
+				below += histogram[threshold++];
+			}
+			auto at_threshold = candidates - below;
+			for (size_t i = 0; i < rows; i++)
+			{
+				if (distances[i] < threshold)
+				{
+					result.push_back(i);
+				}
+				else if (distances[i] == threshold && at_threshold > 0)
+				{
+					result.push_back(i);
+					at_threshold--;
+				}
+			}
+		}
+		else
+		{
+			std::vector<VALUE_T> distances(rows);
+			squared_distances(projected_rows, TO_ARRAY(projected), TO_ARRAY(distances));
+
+			result.resize(rows);
+			for (size_t i = 0; i < rows; i++)
+			{
+				result[i] = i;
+			}
+			std::nth_element(result.begin(), result.begin() + (candidates - 1), result.end(), [&](size_t a, size_t b)
+							 { return distances[a] < distances[b]; });
+			result.resize(candidates);
+		}
+
+		return result;
+	}
+
+	template <typename VALUE_T>
+	std::vector<Neighbor<VALUE_T>> SketchFilter<VALUE_T>::search(const VALUE_T* query, const int k, size_t candidates) const
+	{
+		TRACE_SCOPE("SketchFilter::search");
+
+		if (k <= 0)
+		{
+			throw Exception(boost::format("SketchFilter: invalid number of results %d") % k);
+		}
+
+		std::vector<Neighbor<VALUE_T>> result;
+		for (auto &&row : prefilter(query, std::max(candidates, (size_t)k)))
+		{
+			result.push_back({row, squared_distance(batch.row(row), query, batch.get_dimensions())});
+		}
+
+		auto count = std::min((size_t)k, result.size());
+		std::partial_sort(result.begin(), result.begin() + count, result.end());
+		result.resize(count);
+
+		return result;
+	}
+
+	template <typename VALUE_T>
+	size_t SketchFilter<VALUE_T>::sketch_bytes() const
+	{
+		return kind == SketchKind::Signs ? signs.size() * sizeof(uint64_t) : projections.size() * projections.get_stride() * sizeof(VALUE_T);
+	}
+
+	template class SketchFilter<float>;
+	template class SketchFilter<double>;
+}
@@ -0,0 +1,499 @@
+#include "store.hpp"
+
+#include "utility.hpp"
+
+#include <algorithm>
+#include <queue>
+
+namespace DCPE
+{
+	template <typename VALUE_T>
+	std::vector<Neighbor<VALUE_T>> merge_neighbors(const std::vector<std::vector<Neighbor<VALUE_T>>>& results, const int k)
+	{
+		std::vector<Neighbor<VALUE_T>> merged;
+		for (auto &&result : results)
+		{
+			merged.insert(merged.end(), result.begin(), result.end());
+		}
+
+		auto count = std::min((size_t)std::max(k, 0), merged.size());
+		std::partial_sort(merged.begin(), merged.begin() + count, merged.end());
+		merged.resize(count);
+
+		return merged;
+	}
+	template std::vector<Neighbor<float>> merge_neighbors(const std::vector<std::vector<Neighbor<float>>>& results, const int k);
+	template std::vector<Neighbor<double>> merge_neighbors(const std::vector<std::vector<Neighbor<double>>>& results, const int k);
+
+	template <typename VALUE_T>
+	Segment<VALUE_T>::Segment(int dimensions, size_t capacity) :
+		dimensions(dimensions),
+		capacity(capacity),
+		tombstones(new std::atomic<ull>[(capacity + 63) / 64])
+	{
+		ciphertexts.resize(capacity * dimensions);
+		nonces.resize(capacity);
+		ids.resize(capacity);
+		for (size_t i = 0; i < (capacity + 63) / 64; i++)
+		{
+			tombstones[i] = 0;
+		}
+	}
+
+	template <typename VALUE_T>
+	bool Segment<VALUE_T>::is_deleted(size_t row) const
+	{
+		return tombstones[row / 64].load(std::memory_order_acquire) & (1uLL << (row % 64));
+	}
+
+	template <typename VALUE_T>
+	bool Segment<VALUE_T>::mark_deleted(size_t row)
+	{
+		auto bit	  = 1uLL << (row % 64);
+		auto previous = tombstones[row / 64].fetch_or(bit, std::memory_order_acq_rel);
+		if (previous & bit)
+		{
+			return false;
+		}
+
+		deleted++;
+		return true;
+	}
+
+	template struct Segment<float>;
+	template struct Segment<double>;
+
+	template <typename VALUE_T>
+	EncryptedStore<VALUE_T>::EncryptedStore(int dimensions, size_t segment_capacity, double compaction_threshold, bool background) :
+		dimensions(dimensions),
+		segment_capacity(segment_capacity),
+		compaction_threshold(compaction_threshold)
+	{
+		if (dimensions <= 0)
+		{
+			throw Exception(boost::format("EncryptedStore: invalid number of dimensions %d") % dimensions);
+		}
+
+		if (segment_capacity == 0)
+		{
+			throw Exception("EncryptedStore: segment capacity must be positive");
+		}
+
+		if (compaction_threshold <= 0.0 || compaction_threshold > 1.0)
+		{
+			throw Exception(boost::format("EncryptedStore: invalid compaction threshold %f") % compaction_threshold);
+		}
+
+		active = std::make_shared<Segment<VALUE_T>>(dimensions, segment_capacity);
+		store_snapshot(std::make_shared<const SegmentList>(SegmentList{active}));
+
+		if (background)
+		{
+			compactor = std::thread(&EncryptedStore<VALUE_T>::compaction_loop, this);
+		}
+	}
+
+	template <typename VALUE_T>
+	EncryptedStore<VALUE_T>::~EncryptedStore()
+	{
+		if (compactor.joinable())
+		{
+			{
+				std::lock_guard lock(signal_mutex);
+				stopping = true;
+			}
+			compaction_requested.notify_one();
+			compactor.join();
+		}
+	}
+
+	template <typename VALUE_T>
+	void EncryptedStore<VALUE_T>::insert(ull id, const VALUE_T* ciphertext, const std::pair<ull, ull>& nonce)
+	{
+		std::lock_guard lock(write_mutex);
+
+		auto existing = locations.find(id);
+		if (existing != locations.end())
+		{
+			existing->second.first->mark_deleted(existing->second.second);
+			live--;
+		}
+
+		auto sealed = false;
+		if (active->size.load(std::memory_order_relaxed) == active->capacity)
+		{
+			active = std::make_shared<Segment<VALUE_T>>(dimensions, segment_capacity);
+
+			auto segments = std::make_shared<SegmentList>(*load_snapshot());
+			segments->push_back(active);
+			store_snapshot(segments);
+			sealed = true;
+		}
+
+		auto row = active->size.load(std::memory_order_relaxed);
+		std::copy(ciphertext, ciphertext + dimensions, active->ciphertexts.begin() + row * dimensions);
+		active->nonces[row] = nonce;
+		active->ids[row]	= id;
+		active->size.store(row + 1, std::memory_order_release);
+
+		locations[id] = {active.get(), row};
+		live++;
+
+		if (sealed)
+		{
+			request_compaction();
+		}
+	}
+
+	template <typename VALUE_T>
+	bool EncryptedStore<VALUE_T>::remove(ull id)
+	{
+		std::lock_guard lock(write_mutex);
+
+		auto existing = locations.find(id);
+		if (existing == locations.end())
+		{
+			return false;
+		}
+
+		auto [segment, row] = existing->second;
+		segment->mark_deleted(row);
+		locations.erase(existing);
+		live--;
+
+		if (segment != active.get() && segment->deleted >= compaction_threshold * segment->size)
+		{
+			request_compaction();
+		}
+
+		return true;
+	}
+
+	template <typename VALUE_T>
+	bool EncryptedStore<VALUE_T>::get(ull id, VALUE_T* ciphertext, std::pair<ull, ull>& nonce)
+	{
+		std::lock_guard lock(write_mutex);
+
+		auto existing = locations.find(id);
+		if (existing == locations.end())
+		{
+			return false;
+		}
+
+		auto [segment, row] = existing->second;
+		std::copy(segment->ciphertexts.begin() + row * dimensions, segment->ciphertexts.begin() + (row + 1) * dimensions, ciphertext);
+		nonce = segment->nonces[row];
+
+		return true;
+	}
+
+	template <typename VALUE_T>
+	std::vector<Neighbor<VALUE_T>> EncryptedStore<VALUE_T>::search_segment(const Segment<VALUE_T>& segment, const VALUE_T* query, const int k) const
+	{
+		std::priority_queue<Neighbor<VALUE_T>> heap;
+
+		auto size = segment.size.load(std::memory_order_acquire);
+		for (size_t row = 0; row < size; row++)
+		{
+			if (segment.is_deleted(row))
+			{
+				continue;
+			}
+
+			Neighbor<VALUE_T> candidate = {segment.ids[row], squared_distance(TO_ARRAY(segment.ciphertexts) + row * dimensions, query, dimensions)};
+			if (heap.size() < (size_t)k)
+			{
+				heap.push(candidate);
+			}
+			else if (candidate < heap.top())
+			{
+				heap.pop();
+				heap.push(candidate);
+			}
+		}
+
+		std::vector<Neighbor<VALUE_T>> result;
+		result.resize(heap.size());
+		for (auto i = (int)heap.size() - 1; i >= 0; i--)
+		{
+			result[i] = heap.top();
+			heap.pop();
+		}
+
+		return result;
+	}
+
+	template <typename VALUE_T>
+	std::vector<Neighbor<VALUE_T>> EncryptedStore<VALUE_T>::search(const VALUE_T* query, const int k) const
+	{
+		if (k <= 0)
+		{
+			throw Exception(boost::format("EncryptedStore: invalid k %d") % k);
+		}
+
+		auto segments = load_snapshot();
+
+		std::vector<std::vector<Neighbor<VALUE_T>>> results;
+		results.reserve(segments->size());
+		for (auto &&segment : *segments)
+		{
+			results.push_back(search_segment(*segment, query, k));
+		}
+
+		return merge_neighbors(results, k);
+	}
+
+	template <typename VALUE_T>
+	void EncryptedStore<VALUE_T>::search_segment_radius(const Segment<VALUE_T>& segment, const VALUE_T* query, const VALUE_T bound, const int block, std::vector<Neighbor<VALUE_T>>& result) const
+	{
+		auto size = segment.size.load(std::memory_order_acquire);
+		for (size_t row = 0; row < size; row++)
+		{
+			if (segment.is_deleted(row))
+			{
+				continue;
+			}
+
+			auto ciphertext = TO_ARRAY(segment.ciphertexts) + row * dimensions;
+			VALUE_T sum		= 0;
+			for (auto first = 0; first < dimensions && sum <= bound; first += block)
+			{
+				auto last = std::min(first + block, dimensions);
+				for (auto i = first; i < last; i++)
+				{
+					auto difference = ciphertext[i] - query[i];
+					sum += difference * difference;
+				}
+			}
+
+			if (sum <= bound)
+			{
+				result.push_back({segment.ids[row], sum});
+			}
+		}
+	}
+
+	template <typename VALUE_T>
+	std::vector<Neighbor<VALUE_T>> EncryptedStore<VALUE_T>::search_radius(const VALUE_T* query, const VALUE_T radius, const int block) const
+	{
+		if (radius < 0.0)
+		{
+			throw Exception(boost::format("EncryptedStore: invalid radius %f") % radius);
+		}
+
+		if (block <= 0)
+		{
+			throw Exception(boost::format("EncryptedStore: invalid block size %d") % block);
+		}
+
+		auto segments = load_snapshot();
+
+		std::vector<Neighbor<VALUE_T>> result;
+		for (auto &&segment : *segments)
+		{
+			search_segment_radius(*segment, query, radius * radius, block, result);
+		}
+		std::sort(result.begin(), result.end());
+
+		return result;
+	}
+
+	template <typename VALUE_T>
+	typename EncryptedStore<VALUE_T>::SegmentList EncryptedStore<VALUE_T>::compaction_candidates(const SegmentList& segments) const
+	{
+		SegmentList candidates, underfilled;
+		for (size_t i = 0; i + 1 < segments.size(); i++)
+		{
+			auto size	 = segments[i]->size.load();
+			auto deleted = segments[i]->deleted.load();
+			if (deleted > 0 && deleted >= compaction_threshold * size)
+			{
+				candidates.push_back(segments[i]);
+			}
+			else if (size - deleted < segment_capacity / 2)
+			{
+				underfilled.push_back(segments[i]);
+			}
+		}
+
+		// leftovers of previous compactions are worth repacking only along with segments that have tombstones
+		if (!candidates.empty())
+		{
+			candidates.insert(candidates.end(), underfilled.begin(), underfilled.end());
+		}
+
+		return candidates;
+	}
+
+	template <typename VALUE_T>
+	size_t EncryptedStore<VALUE_T>::compact()
+	{
+		std::lock_guard compaction_lock(compaction_mutex);
+
+		auto candidates = compaction_candidates(*load_snapshot());
+		if (candidates.empty())
+		{
+			return 0;
+		}
+
+		// sealed segments never get new rows, so they can be read without the writer lock;
+		// rows deleted while we copy are caught up on below
+		auto rows = 0uL;
+		for (auto &&candidate : candidates)
+		{
+			rows += candidate->size - candidate->deleted;
+		}
+
+		SegmentList rewritten;
+		std::vector<std::pair<Segment<VALUE_T>*, size_t>> sources;
+		for (auto &&candidate : candidates)
+		{
+			for (size_t row = 0; row < candidate->size; row++)
+			{
+				if (candidate->is_deleted(row))
+				{
+					continue;
+				}
+
+				if (rewritten.empty() || rewritten.back()->size == rewritten.back()->capacity)
+				{
+					auto remaining = rows - sources.size();
+					rewritten.push_back(std::make_shared<Segment<VALUE_T>>(dimensions, std::clamp(remaining, 1uL, segment_capacity)));
+				}
+
+				auto& target = *rewritten.back();
+				auto index	 = target.size.load(std::memory_order_relaxed);
+				std::copy(candidate->ciphertexts.begin() + row * dimensions, candidate->ciphertexts.begin() + (row + 1) * dimensions, target.ciphertexts.begin() + index * dimensions);
+				target.nonces[index] = candidate->nonces[row];
+				target.ids[index]	 = candidate->ids[row];
+				target.size.store(index + 1, std::memory_order_release);
+
+				sources.push_back({candidate.get(), row});
+			}
+		}
+
+		std::lock_guard lock(write_mutex);
+
+		size_t moved = 0;
+		for (auto &&segment : rewritten)
+		{
+			for (size_t index = 0; index < segment->size; index++, moved++)
+			{
+				auto [source, row] = sources[moved];
+				if (source->is_deleted(row))
+				{
+					segment->mark_deleted(index);
+				}
+				else
+				{
+					locations[segment->ids[index]] = {segment.get(), index};
+				}
+			}
+		}
+
+		auto segments  = std::make_shared<SegmentList>(rewritten);
+		auto reclaimed = 0uL;
+		auto current   = load_snapshot();
+		for (auto &&segment : *current)
+		{
+			if (std::find(candidates.begin(), candidates.end(), segment) == candidates.end())
+			{
+				segments->push_back(segment);
+			}
+			else
+			{
+				reclaimed += segment->size;
+			}
+		}
+		for (auto &&segment : rewritten)
+		{
+			reclaimed -= segment->size;
+		}
+		store_snapshot(segments);
+
+		return reclaimed;
+	}
+
+	template <typename VALUE_T>
+	std::shared_ptr<const typename EncryptedStore<VALUE_T>::SegmentList> EncryptedStore<VALUE_T>::load_snapshot() const
+	{
+		std::lock_guard lock(snapshot_mutex);
+		return snapshot;
+	}
+
+	template <typename VALUE_T>
+	void EncryptedStore<VALUE_T>::store_snapshot(std::shared_ptr<const SegmentList> segments)
+	{
+		std::lock_guard lock(snapshot_mutex);
+		snapshot.swap(segments);
+	}
+
+	template <typename VALUE_T>
+	void EncryptedStore<VALUE_T>::request_compaction()
+	{
+		if (!compactor.joinable())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard lock(signal_mutex);
+			compaction_pending = true;
+		}
+		compaction_requested.notify_one();
+	}
+
+	template <typename VALUE_T>
+	void EncryptedStore<VALUE_T>::compaction_loop()
+	{
+		while (true)
+		{
+			{
+				std::unique_lock lock(signal_mutex);
+				compaction_requested.wait(lock, [this]()
+										  { return compaction_pending || stopping; });
+				if (stopping)
+				{
+					return;
+				}
+				compaction_pending = false;
+			}
+
+			compact();
+		}
+	}
+
+	template <typename VALUE_T>
+	size_t EncryptedStore<VALUE_T>::size() const
+	{
+		return live;
+	}
+
+	template <typename VALUE_T>
+	size_t EncryptedStore<VALUE_T>::rows() const
+	{
+		auto rows	  = 0uL;
+		auto segments = load_snapshot();
+		for (auto &&segment : *segments)
+		{
+			rows += segment->size;
+		}
+
+		return rows;
+	}
+
+	template <typename VALUE_T>
+	size_t EncryptedStore<VALUE_T>::segments() const
+	{
+		return load_snapshot()->size();
+	}
+
+	template <typename VALUE_T>
+	int EncryptedStore<VALUE_T>::get_dimensions() const
+	{
+		return dimensions;
+	}
+
+	template class EncryptedStore<float>;
+	template class EncryptedStore<double>;
+}
@@ -0,0 +1,225 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace DCPE
+{
+	namespace
+	{
+		static_assert((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1)) == 0, "TRACE_BUFFER_EVENTS has to be a power of 2");
+
+		/**
+		 * @brief an event in a ring buffer; the fields are atomic only so that a reader racing the writer is well-defined
+		 *
+		 */
+		struct Slot
+		{
+			std::atomic<const char*> name;
+			std::atomic<uint32_t> thread;
+			std::atomic<uint64_t> start;
+			std::atomic<uint64_t> end;
+		};
+
+		struct Buffer
+		{
+			Slot slots[TRACE_BUFFER_EVENTS];
+
+			/**
+			 * @brief the number of events ever written; only the owning thread moves it
+			 */
+			std::atomic<uint64_t> head = 0;
+
+			/**
+			 * @brief the index of the first event not cleared
+			 */
+			std::atomic<uint64_t> tail = 0;
+
+			std::atomic<bool> in_use = false;
+			uint32_t thread			 = 0;
+		};
+
+		std::mutex registry_mutex;
+		std::vector<std::unique_ptr<Buffer>> registry;
+		uint32_t next_thread = 0;
+
+		/**
+		 * @brief ties a buffer to the thread and hands it back when the thread exits
+		 *
+		 */
+		struct Claim
+		{
+			Buffer* buffer = nullptr;
+
+			~Claim()
+			{
+				if (buffer)
+				{
+					buffer->in_use.store(false, std::memory_order_release);
+				}
+			}
+		};
+
+		thread_local Claim claim;
+
+		Buffer* claim_buffer()
+		{
+			std::lock_guard lock(registry_mutex);
+
+			Buffer* buffer = nullptr;
+			for (auto &&candidate : registry)
+			{
+				if (!candidate->in_use.load(std::memory_order_acquire))
+				{
+					buffer = candidate.get();
+					break;
+				}
+			}
+			if (!buffer)
+			{
+				registry.push_back(std::make_unique<Buffer>());
+				buffer = registry.back().get();
+			}
+
+			buffer->in_use.store(true, std::memory_order_relaxed);
+			buffer->thread = next_thread++;
+			return buffer;
+		}
+
+		/**
+		 * @brief escapes a name for a JSON string
+		 *
+		 */
+		std::string escape(const char* name)
+		{
+			std::string result;
+			for (auto c = name; *c; c++)
+			{
+				if (*c == '"' || *c == '\\')
+				{
+					result.push_back('\\');
+				}
+				result.push_back(*c);
+			}
+			return result;
+		}
+	}
+
+	const std::chrono::steady_clock::time_point Tracer::origin = std::chrono::steady_clock::now();
+
+	void Tracer::record(const char* name, uint64_t start, uint64_t end)
+	{
+		if (!claim.buffer)
+		{
+			claim.buffer = claim_buffer();
+		}
+
+		auto buffer = claim.buffer;
+		auto index	= buffer->head.load(std::memory_order_relaxed);
+		auto& slot	= buffer->slots[index & (TRACE_BUFFER_EVENTS - 1)];
+		// pairs with the acquire fence in events: a reader that sees any of the slot stores below also sees the head stores before them
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.thread.store(buffer->thread, std::memory_order_relaxed);
+		slot.start.store(start, std::memory_order_relaxed);
+		slot.end.store(end, std::memory_order_relaxed);
+		buffer->head.store(index + 1, std::memory_order_release);
+	}
+
+	std::vector<TraceEvent> Tracer::events()
+	{
+		std::vector<TraceEvent> result;
+
+		std::lock_guard lock(registry_mutex);
+		for (auto &&buffer : registry)
+		{
+			auto head  = buffer->head.load(std::memory_order_acquire);
+			auto first = std::max(buffer->tail.load(std::memory_order_relaxed), head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0);
+
+			std::vector<TraceEvent> copied;
+			for (auto index = first; index < head; index++)
+			{
+				auto& slot = buffer->slots[index & (TRACE_BUFFER_EVENTS - 1)];
+				copied.push_back({slot.name.load(std::memory_order_relaxed), slot.thread.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed)});
+			}
+
+			// the writer may have lapped the copy; the slots it was writing (or had written) meanwhile are not trustworthy
+			std::atomic_thread_fence(std::memory_order_acquire);
+			auto now   = buffer->head.load(std::memory_order_relaxed);
+			auto valid = now >= TRACE_BUFFER_EVENTS ? now - TRACE_BUFFER_EVENTS + 1 : 0;
+			for (auto index = std::max(first, valid); index < head; index++)
+			{
+				result.push_back(copied[index - first]);
+			}
+		}
+
+		std::sort(result.begin(), result.end(), [](const TraceEvent& a, const TraceEvent& b)
+				  { return a.start != b.start ? a.start < b.start : a.end > b.end; });
+
+		return result;
+	}
+
+	void Tracer::clear()
+	{
+		std::lock_guard lock(registry_mutex);
+		for (auto &&buffer : registry)
+		{
+			buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+		}
+	}
+
+	void Tracer::write_chrome_trace(std::ostream& out)
+	{
+		auto all = events();
+
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		for (size_t i = 0; i < all.size(); i++)
+		{
+			// the format wants microseconds
+			out << (i > 0 ? "," : "") << std::endl
+				<< "{\"name\":\"" << escape(all[i].name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << all[i].thread
+				<< ",\"ts\":" << all[i].start / 1000 << "." << std::setfill('0') << std::setw(3) << all[i].start % 1000
+				<< ",\"dur\":" << (all[i].end - all[i].start) / 1000 << "." << std::setw(3) << (all[i].end - all[i].start) % 1000 << std::setfill(' ')
+				<< "}";
+		}
+		out << std::endl
+			<< "]}" << std::endl;
+	}
+
+	void Tracer::write_folded_stacks(std::ostream& out)
+	{
+		auto all = events();
+
+		// events are ordered by start (outer first on ties), so the enclosing scopes of an event are on the stack when it comes
+		std::map<uint32_t, std::vector<std::pair<const TraceEvent*, std::string>>> stacks;
+		std::map<std::string, int64_t> self;
+		for (auto &&event : all)
+		{
+			auto& stack = stacks[event.thread];
+			while (!stack.empty() && stack.back().first->end < event.end)
+			{
+				stack.pop_back();
+			}
+
+			auto path = stack.empty() ? std::string(event.name) : stack.back().second + ";" + event.name;
+			self[path] += event.end - event.start;
+			if (!stack.empty())
+			{
+				self[stack.back().second] -= event.end - event.start;
+			}
+			stack.push_back({&event, path});
+		}
+
+		for (auto &&[path, time] : self)
+		{
+			if (time > 0)
+			{
+				out << path << " " << time << std::endl;
+			}
+		}
+	}
+}
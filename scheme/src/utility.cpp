@@ -1,13 +1,22 @@
 #include "utility.hpp"
 
+#include "scheduler.hpp"
+#include "trace.hpp"
+
 #include <boost/generator_iterator.hpp>
 #include <boost/random/linear_congruential.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/uniform_real.hpp>
 #include <boost/random/variate_generator.hpp>
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iomanip>
+#include <mutex>
+#include <openssl/rand.h>
 #include <random>
+#include <thread>
 #include <vector>
 
 namespace DCPE
@@ -19,8 +28,32 @@ namespace DCPE
 	 */
 	typedef boost::random::mt19937_64 base_generator_type;
 
+	bytes get_random_bytes(const int size)
+	{
+		TRACE_SCOPE("get_random_bytes");
+
+		bytes material;
+		material.resize(size);
+
+#ifdef TESTING
+		for (auto i = 0; i < size; i++)
+		{
+			material[i] = (byte)rand();
+		}
+#else
+		if (size > 0 && RAND_bytes(TO_ARRAY(material), size) != 1)
+		{
+			throw Exception(boost::format("get_random_bytes: OpenSSL PRG failed to generate %d bytes") % size);
+		}
+#endif
+
+		return material;
+	}
+
 	ull get_ramdom_ull(const ull max)
 	{
+		TRACE_SCOPE("get_ramdom_ull");
+
 		ull material[1];
 		auto int_material = (int *)material;
 		int_material[0]	  = rand();
@@ -31,7 +64,13 @@ namespace DCPE
 	template <typename VALUE_T>
 	VALUE_T sample_uniform(const VALUE_T min, const VALUE_T max, const ull seed)
 	{
-		base_generator_type generator(seed);
+		TRACE_SCOPE("sample_uniform");
+
+		auto generator = [&]()
+		{
+			TRACE_SCOPE("mt19937_64 seed");
+			return base_generator_type(seed);
+		}();
 
 		boost::uniform_real<> distribution(min, max);
 		boost::variate_generator<base_generator_type &, boost::uniform_real<>> sampler(generator, distribution);
@@ -44,7 +83,13 @@ namespace DCPE
 	template <typename VALUE_T>
 	std::vector<VALUE_T> sample_normal_series(const VALUE_T mean, const VALUE_T variance, const ull seed, const int count)
 	{
-		base_generator_type generator(seed);
+		TRACE_SCOPE("sample_normal_series");
+
+		auto generator = [&]()
+		{
+			TRACE_SCOPE("mt19937_64 seed");
+			return base_generator_type(seed);
+		}();
 
 		boost::normal_distribution<> distribution(mean, variance);
 		boost::variate_generator<base_generator_type &, boost::normal_distribution<>> sampler(generator, distribution);
@@ -52,9 +97,12 @@ namespace DCPE
 		std::vector<VALUE_T> samples;
 		samples.resize(count);
 
-		for (auto i = 0; i < count; i++)
 		{
-			samples[i] = sampler();
+			TRACE_SCOPE("normal_distribution");
+			for (auto i = 0; i < count; i++)
+			{
+				samples[i] = sampler();
+			}
 		}
 
 		return samples;
@@ -101,4 +149,49 @@ namespace DCPE
 	}
 	template float distance(std::vector<float> first, std::vector<float> second);
 	template double distance(std::vector<double> first, std::vector<double> second);
+
+	template <typename VALUE_T>
+	VALUE_T squared_distance(const VALUE_T* first, const VALUE_T* second, const int dimensions)
+	{
+		VALUE_T result = 0.0;
+		for (auto i = 0; i < dimensions; i++)
+		{
+			auto difference = first[i] - second[i];
+			result += difference * difference;
+		}
+
+		return result;
+	}
+	template float squared_distance(const float* first, const float* second, const int dimensions);
+	template double squared_distance(const double* first, const double* second, const int dimensions);
+
+	void parallel_for(const size_t begin, const size_t end, const std::function<void(size_t)>& body, const uint threads)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+
+		auto& scheduler = Scheduler::global();
+
+		// the caller runs tasks too while it waits, hence one more than the workers
+		auto tasks = threads == 0 ? scheduler.size() + 1 : threads;
+		tasks	   = (uint)std::min((size_t)tasks, end - begin);
+
+		std::atomic<size_t> next = begin;
+
+		TaskGroup group(scheduler);
+		for (uint task = 0; task < tasks; task++)
+		{
+			group.run(
+				[&]()
+				{
+					for (auto i = next++; i < end; i = next++)
+					{
+						body(i);
+					}
+				});
+		}
+		group.wait();
+	}
 }
@@ -0,0 +1,292 @@
+#include "view.hpp"
+
+#include <algorithm>
+
+namespace DCPE
+{
+	template <typename VALUE_T>
+	DecryptedView<VALUE_T>::iterator::iterator(DecryptedView* view, size_t row, size_t end) :
+		view(view),
+		row(row),
+		end(end)
+	{
+		if (row < end)
+		{
+			view->schedule(row + 1, std::min(end, row + 1 + view->prefetch));
+		}
+	}
+
+	template <typename VALUE_T>
+	typename DecryptedView<VALUE_T>::Row DecryptedView<VALUE_T>::iterator::operator*() const
+	{
+		return view->get(row);
+	}
+
+	template <typename VALUE_T>
+	typename DecryptedView<VALUE_T>::iterator& DecryptedView<VALUE_T>::iterator::operator++()
+	{
+		row++;
+		// the rest of the window was scheduled before, only the new tail is missing
+		auto tail = row + view->prefetch;
+		if (view->prefetch > 0 && tail < end)
+		{
+			view->schedule(tail, tail + 1);
+		}
+
+		return *this;
+	}
+
+	template <typename VALUE_T>
+	bool DecryptedView<VALUE_T>::iterator::operator!=(const iterator& other) const
+	{
+		return row != other.row;
+	}
+
+	template <typename VALUE_T>
+	bool DecryptedView<VALUE_T>::iterator::operator==(const iterator& other) const
+	{
+		return row == other.row;
+	}
+
+	template <typename VALUE_T>
+	DecryptedView<VALUE_T>::Range::Range(DecryptedView* view, size_t first, size_t last) :
+		view(view),
+		first(first),
+		last(last) {}
+
+	template <typename VALUE_T>
+	typename DecryptedView<VALUE_T>::iterator DecryptedView<VALUE_T>::Range::begin() const
+	{
+		return iterator(view, first, last);
+	}
+
+	template <typename VALUE_T>
+	typename DecryptedView<VALUE_T>::iterator DecryptedView<VALUE_T>::Range::end() const
+	{
+		return iterator(view, last, last);
+	}
+
+	template <typename VALUE_T>
+	DecryptedView<VALUE_T>::DecryptedView(Scheme<VALUE_T>& scheme, const DCPE::key<VALUE_T>& key, const VALUE_T* ciphertexts, const std::pair<ull, ull>* nonces, size_t rows, int dimensions, size_t capacity, size_t prefetch) :
+		scheme(scheme),
+		key(key),
+		ciphertexts(ciphertexts),
+		nonces(nonces),
+		rows(rows),
+		dimensions(dimensions),
+		capacity(capacity),
+		prefetch(prefetch)
+	{
+		if (dimensions <= 0)
+		{
+			throw Exception(boost::format("DecryptedView: invalid number of dimensions %d") % dimensions);
+		}
+
+		if (capacity == 0 || prefetch >= capacity)
+		{
+			throw Exception(boost::format("DecryptedView: the cache (%d rows) has to be larger than the prefetch window (%d rows)") % capacity % prefetch);
+		}
+
+		if (prefetch > 0)
+		{
+			prefetcher = std::thread(&DecryptedView<VALUE_T>::prefetch_loop, this);
+		}
+	}
+
+	template <typename VALUE_T>
+	DecryptedView<VALUE_T>::~DecryptedView()
+	{
+		if (prefetcher.joinable())
+		{
+			{
+				std::lock_guard lock(mutex);
+				stopping = true;
+			}
+			decrypted.notify_all();
+			prefetcher.join();
+		}
+	}
+
+	template <typename VALUE_T>
+	typename DecryptedView<VALUE_T>::Row DecryptedView<VALUE_T>::decrypt(size_t row)
+	{
+		auto nonce	  = nonces[row];
+		auto lambda_m = scheme.compute_lambda_m(key, nonce, dimensions);
+		auto s		  = std::get<2>(key);
+
+		auto ciphertext = ciphertexts + row * dimensions;
+		auto message	= std::make_shared<std::vector<VALUE_T>>(dimensions);
+		for (auto i = 0; i < dimensions; i++)
+		{
+			(*message)[i] = (ciphertext[i] - lambda_m[i]) / s;
+		}
+
+		return message;
+	}
+
+	template <typename VALUE_T>
+	void DecryptedView<VALUE_T>::remember(size_t row, Row value)
+	{
+		recency.push_front(row);
+		cache[row] = {value, recency.begin()};
+
+		while (cache.size() > capacity)
+		{
+			cache.erase(recency.back());
+			recency.pop_back();
+		}
+	}
+
+	template <typename VALUE_T>
+	typename DecryptedView<VALUE_T>::Row DecryptedView<VALUE_T>::get(size_t row)
+	{
+		if (row >= rows)
+		{
+			throw Exception(boost::format("DecryptedView: row %d is out of range (%d rows)") % row % rows);
+		}
+
+		std::unique_lock lock(mutex);
+
+		auto cached = cache.find(row);
+		if (cached != cache.end())
+		{
+			hits++;
+			recency.splice(recency.begin(), recency, cached->second.second);
+			return cached->second.first;
+		}
+		misses++;
+
+		// the prefetcher is on it, wait rather than do the same work twice
+		while (in_flight.count(row))
+		{
+			decrypted.wait(lock);
+			cached = cache.find(row);
+			if (cached != cache.end())
+			{
+				recency.splice(recency.begin(), recency, cached->second.second);
+				return cached->second.first;
+			}
+		}
+
+		in_flight.insert(row);
+		lock.unlock();
+
+		auto value = decrypt(row);
+
+		lock.lock();
+		in_flight.erase(row);
+		remember(row, value);
+		lock.unlock();
+		decrypted.notify_all();
+
+		return value;
+	}
+
+	template <typename VALUE_T>
+	VALUE_T DecryptedView<VALUE_T>::at(size_t row, int dimension)
+	{
+		if (dimension < 0 || dimension >= dimensions)
+		{
+			throw Exception(boost::format("DecryptedView: dimension %d is out of range (%d dimensions)") % dimension % dimensions);
+		}
+
+		return (*get(row))[dimension];
+	}
+
+	template <typename VALUE_T>
+	void DecryptedView<VALUE_T>::schedule(size_t first, size_t last)
+	{
+		if (prefetch == 0)
+		{
+			return;
+		}
+
+		{
+			std::lock_guard lock(mutex);
+			for (auto row = first; row < std::min(last, rows); row++)
+			{
+				if (!cache.count(row) && !in_flight.count(row) && !queued.count(row))
+				{
+					queue.push_back(row);
+					queued.insert(row);
+				}
+			}
+		}
+		decrypted.notify_all();
+	}
+
+	template <typename VALUE_T>
+	void DecryptedView<VALUE_T>::prefetch_loop()
+	{
+		std::unique_lock lock(mutex);
+		while (true)
+		{
+			decrypted.wait(lock, [this]()
+						   { return stopping || !queue.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+
+			auto row = queue.front();
+			queue.pop_front();
+			queued.erase(row);
+			if (cache.count(row) || in_flight.count(row))
+			{
+				continue;
+			}
+
+			in_flight.insert(row);
+			lock.unlock();
+
+			auto value = decrypt(row);
+
+			lock.lock();
+			in_flight.erase(row);
+			remember(row, value);
+			prefetched++;
+			decrypted.notify_all();
+		}
+	}
+
+	template <typename VALUE_T>
+	typename DecryptedView<VALUE_T>::Range DecryptedView<VALUE_T>::range(size_t first, size_t last)
+	{
+		if (first > last || last > rows)
+		{
+			throw Exception(boost::format("DecryptedView: invalid range [%d, %d) of %d rows") % first % last % rows);
+		}
+
+		return Range(this, first, last);
+	}
+
+	template <typename VALUE_T>
+	size_t DecryptedView<VALUE_T>::size() const
+	{
+		return rows;
+	}
+
+	template <typename VALUE_T>
+	size_t DecryptedView<VALUE_T>::get_hits()
+	{
+		std::lock_guard lock(mutex);
+		return hits;
+	}
+
+	template <typename VALUE_T>
+	size_t DecryptedView<VALUE_T>::get_misses()
+	{
+		std::lock_guard lock(mutex);
+		return misses;
+	}
+
+	template <typename VALUE_T>
+	size_t DecryptedView<VALUE_T>::get_prefetched()
+	{
+		std::lock_guard lock(mutex);
+		return prefetched;
+	}
+
+	template class DecryptedView<float>;
+	template class DecryptedView<double>;
+}
@@ -0,0 +1,318 @@
+#include "batch.hpp"
+#include "scheme.hpp"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <set>
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	template <typename TypeParam>
+	class BatchTest : public testing::Test
+	{
+		public:
+		const int dimensions = 19;
+		const int rows		 = 100;
+
+		protected:
+		Scheme<TypeParam> scheme = Scheme<TypeParam>(1000.0);
+		DCPE::key<TypeParam> key;
+
+		std::vector<TypeParam> messages;
+
+		BatchTest()
+		{
+			key = scheme.keygen();
+
+			messages.resize(rows * dimensions);
+			for (auto &&value : messages)
+			{
+				value = -1000.0 + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * 2000.0;
+			}
+		}
+
+		CiphertextBatch<TypeParam> encrypted()
+		{
+			CiphertextBatch<TypeParam> batch(rows, dimensions);
+			encrypt_batch(scheme, key, TO_ARRAY(messages), batch.view());
+			return batch;
+		}
+
+		void expect_same(const CiphertextBatch<TypeParam>& expected, const CiphertextSlice<TypeParam>& actual)
+		{
+			ASSERT_EQ(expected.size(), actual.size());
+			ASSERT_EQ(expected.get_dimensions(), actual.get_dimensions());
+			for (size_t i = 0; i < expected.size(); i++)
+			{
+				EXPECT_EQ(expected.nonce(i), actual.nonce(i));
+				for (auto j = 0; j < dimensions; j++)
+				{
+					EXPECT_EQ(expected.row(i)[j], actual.row(i)[j]);
+				}
+			}
+		}
+	};
+
+	using testing::Types;
+
+	typedef Types<float, double> ValidVectorTypes;
+	TYPED_TEST_SUITE(BatchTest, ValidVectorTypes);
+
+	TYPED_TEST(BatchTest, Initialization)
+	{
+		CiphertextBatch<TypeParam> batch(this->rows, this->dimensions);
+
+		ASSERT_EQ((size_t)this->rows, batch.size());
+		ASSERT_EQ(this->dimensions, batch.get_dimensions());
+		ASSERT_EQ(0uL, batch.get_stride() * sizeof(TypeParam) % BATCH_ALIGNMENT);
+		ASSERT_LE((size_t)this->dimensions, batch.get_stride());
+		ASSERT_GT((size_t)this->dimensions + BATCH_ALIGNMENT / sizeof(TypeParam), batch.get_stride());
+	}
+
+	TYPED_TEST(BatchTest, InvalidDimensions)
+	{
+		EXPECT_THROW(CiphertextBatch<TypeParam>(this->rows, 0), Exception);
+	}
+
+	TYPED_TEST(BatchTest, RowsAreAlignedAndZeroed)
+	{
+		CiphertextBatch<TypeParam> batch(this->rows, this->dimensions);
+
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			EXPECT_EQ(0uL, reinterpret_cast<uintptr_t>(batch.row(i)) % BATCH_ALIGNMENT);
+			for (size_t j = 0; j < batch.get_stride(); j++)
+			{
+				EXPECT_EQ(0.0, batch.row(i)[j]);
+			}
+		}
+	}
+
+	TYPED_TEST(BatchTest, Empty)
+	{
+		CiphertextBatch<TypeParam> batch(0, this->dimensions);
+
+		ASSERT_EQ(0uL, batch.size());
+		encrypt_batch(this->scheme, this->key, TO_ARRAY(this->messages), batch.view());
+	}
+
+	TYPED_TEST(BatchTest, Move)
+	{
+		auto batch = this->encrypted();
+		auto first = batch.row(0);
+
+		CiphertextBatch<TypeParam> moved(std::move(batch));
+		EXPECT_EQ(first, moved.row(0));
+		EXPECT_EQ((size_t)this->rows, moved.size());
+		EXPECT_EQ(0uL, batch.size());
+
+		CiphertextBatch<TypeParam> assigned(1, 1);
+		assigned = std::move(moved);
+		EXPECT_EQ(first, assigned.row(0));
+		EXPECT_EQ(this->dimensions, assigned.get_dimensions());
+		EXPECT_EQ(0uL, moved.size());
+	}
+
+	TYPED_TEST(BatchTest, Slice)
+	{
+		auto batch = this->encrypted();
+
+		auto slice = batch.slice(10, 30);
+		ASSERT_EQ(20uL, slice.size());
+		EXPECT_EQ(batch.row(10), slice.row(0));
+		EXPECT_EQ(&batch.nonce(10), &slice.nonce(0));
+
+		auto nested = slice.slice(5, 6);
+		ASSERT_EQ(1uL, nested.size());
+		EXPECT_EQ(batch.row(15), nested.row(0));
+
+		EXPECT_EQ(0uL, batch.slice(7, 7).size());
+	}
+
+	TYPED_TEST(BatchTest, SliceInvalidRange)
+	{
+		auto batch = this->encrypted();
+
+		EXPECT_THROW(batch.slice(5, 4), Exception);
+		EXPECT_THROW(batch.slice(0, this->rows + 1), Exception);
+		EXPECT_THROW(batch.slice(0, 10).slice(0, 11), Exception);
+	}
+
+	TYPED_TEST(BatchTest, EncryptDecrypt)
+	{
+		auto batch = this->encrypted();
+
+		std::vector<TypeParam> decrypted(this->rows * this->dimensions);
+		decrypt_batch(this->scheme, this->key, batch.view(), TO_ARRAY(decrypted));
+
+		for (size_t i = 0; i < decrypted.size(); i++)
+		{
+			EXPECT_NEAR(this->messages[i], decrypted[i], 0.01);
+		}
+	}
+
+	TYPED_TEST(BatchTest, EncryptMatchesScheme)
+	{
+		auto batch = this->encrypted();
+
+		std::vector<TypeParam> decrypted(this->dimensions);
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			// a row has to decrypt on its own, as if it came from Scheme::encrypt
+			this->scheme.decrypt(this->key, batch.row(i), this->dimensions, batch.nonce(i), TO_ARRAY(decrypted));
+			for (auto j = 0; j < this->dimensions; j++)
+			{
+				EXPECT_NEAR(this->messages[i * this->dimensions + j], decrypted[j], 0.01);
+			}
+
+			// and leave the padding alone
+			for (size_t j = this->dimensions; j < batch.get_stride(); j++)
+			{
+				EXPECT_EQ(0.0, batch.row(i)[j]);
+			}
+		}
+	}
+
+	TYPED_TEST(BatchTest, EncryptIntoSlice)
+	{
+		CiphertextBatch<TypeParam> batch(this->rows, this->dimensions);
+		encrypt_batch(this->scheme, this->key, TO_ARRAY(this->messages), batch.slice(50, 60));
+
+		for (auto i = 0; i < this->rows; i++)
+		{
+			auto touched = i >= 50 && i < 60;
+			EXPECT_EQ(touched, batch.row(i)[0] != 0.0);
+		}
+	}
+
+	TYPED_TEST(BatchTest, NoncesAreUnique)
+	{
+		auto batch = this->encrypted();
+
+		std::set<std::pair<ull, ull>> nonces;
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			nonces.insert(batch.nonce(i));
+		}
+
+		EXPECT_EQ(batch.size(), nonces.size());
+	}
+
+	TYPED_TEST(BatchTest, SquaredDistances)
+	{
+		auto batch = this->encrypted();
+		auto query = batch.row(42);
+
+		std::vector<TypeParam> distances(this->rows);
+		squared_distances(batch.view(), query, TO_ARRAY(distances));
+
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			auto expected = squared_distance(batch.row(i), query, this->dimensions);
+			EXPECT_NEAR(expected, distances[i], expected * 1e-4);
+		}
+		EXPECT_EQ(0.0, distances[42]);
+	}
+
+	TYPED_TEST(BatchTest, SquaredDistancesOnSlice)
+	{
+		auto batch = this->encrypted();
+		std::vector<TypeParam> query(this->messages.begin(), this->messages.begin() + this->dimensions);
+
+		std::vector<TypeParam> all(this->rows);
+		squared_distances(batch.view(), TO_ARRAY(query), TO_ARRAY(all));
+
+		std::vector<TypeParam> some(10);
+		squared_distances(batch.slice(20, 30), TO_ARRAY(query), TO_ARRAY(some));
+
+		for (auto i = 0; i < 10; i++)
+		{
+			EXPECT_EQ(all[20 + i], some[i]);
+		}
+	}
+
+	TYPED_TEST(BatchTest, DotProduct)
+	{
+		auto batch = this->encrypted();
+
+		for (auto &&[i, j] : std::vector<std::pair<int, int>>{{0, 1}, {42, 42}, {7, 99}})
+		{
+			double expected = 0.0;
+			for (auto d = 0; d < this->dimensions; d++)
+			{
+				expected += (double)batch.row(i)[d] * batch.row(j)[d];
+			}
+			EXPECT_NEAR(expected, aligned_dot_product(batch.row(i), batch.row(j), batch.get_stride()), std::abs(expected) * 1e-4);
+		}
+	}
+
+	TYPED_TEST(BatchTest, Serialize)
+	{
+		auto batch = this->encrypted();
+
+		auto serialized = batch.view().serialize();
+		auto restored	= CiphertextBatch<TypeParam>::deserialize(serialized);
+
+		this->expect_same(batch, restored.view());
+	}
+
+	TYPED_TEST(BatchTest, SerializeSlice)
+	{
+		auto batch = this->encrypted();
+
+		auto restored = CiphertextBatch<TypeParam>::deserialize(batch.slice(30, 40).serialize());
+
+		ASSERT_EQ(10uL, restored.size());
+		this->expect_same(restored, batch.slice(30, 40));
+	}
+
+	TYPED_TEST(BatchTest, DeserializeInvalid)
+	{
+		auto serialized = this->encrypted().view().serialize();
+
+		auto truncated = serialized;
+		truncated.pop_back();
+		EXPECT_THROW(CiphertextBatch<TypeParam>::deserialize(truncated), Exception);
+
+		auto corrupted = serialized;
+		corrupted[0]   = 'X';
+		EXPECT_THROW(CiphertextBatch<TypeParam>::deserialize(corrupted), Exception);
+
+		EXPECT_THROW(CiphertextBatch<TypeParam>::deserialize(bytes()), Exception);
+
+		// forged row counts, one of which makes the total size wrap around to exactly the real one
+		for (auto &&[dimensions, rows] : std::vector<std::pair<uint32_t, uint64_t>>{{(uint32_t)this->dimensions, 1uLL << 62}, {1, 1uLL << 62}, {1, ~0uLL}})
+		{
+			auto forged = serialized;
+			forged.resize(4 + 2 + sizeof(dimensions) + sizeof(rows));
+			std::memcpy(forged.data() + 6, &dimensions, sizeof(dimensions));
+			std::memcpy(forged.data() + 10, &rows, sizeof(rows));
+			EXPECT_THROW(CiphertextBatch<TypeParam>::deserialize(forged), Exception);
+		}
+
+		EXPECT_THROW(CiphertextBatch<TypeParam>(SIZE_MAX / 2, this->dimensions), Exception);
+
+		// a batch of the other value type
+		if constexpr (std::is_same_v<TypeParam, float>)
+		{
+			EXPECT_THROW(CiphertextBatch<double>::deserialize(serialized), Exception);
+		}
+		else
+		{
+			EXPECT_THROW(CiphertextBatch<float>::deserialize(serialized), Exception);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
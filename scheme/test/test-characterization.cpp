@@ -0,0 +1,129 @@
+#include "characterization.hpp"
+
+#include "gtest/gtest.h"
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	template <typename TypeParam>
+	class CharacterizationTest : public testing::Test
+	{
+		protected:
+		CharacterizationConfig config;
+
+		CharacterizationTest()
+		{
+			config.dimensions = 8;
+			config.records	  = 200;
+			config.queries	  = 10;
+			config.k		  = 5;
+		}
+	};
+
+	using testing::Types;
+
+	typedef Types<float, double> ValidVectorTypes;
+	TYPED_TEST_SUITE(CharacterizationTest, ValidVectorTypes);
+
+	TYPED_TEST(CharacterizationTest, Initialization)
+	{
+		Characterization<TypeParam> characterization(this->config);
+		SUCCEED();
+	}
+
+	TYPED_TEST(CharacterizationTest, InvalidConfig)
+	{
+		auto config = this->config;
+		config.k	= config.records + 1;
+		EXPECT_THROW({ Characterization<TypeParam> characterization(config); }, Exception);
+
+		config				= this->config;
+		config.dimensions	= 0;
+		EXPECT_THROW({ Characterization<TypeParam> characterization(config); }, Exception);
+	}
+
+	TYPED_TEST(CharacterizationTest, MeasureSmallBeta)
+	{
+		Characterization<TypeParam> characterization(this->config);
+
+		auto result = characterization.measure(1.0, 1000.0);
+
+		ASSERT_EQ(1.0, result.beta);
+		ASSERT_EQ(1000.0, result.max_s);
+		ASSERT_LT(result.max_error, 1.0);
+		ASSERT_LE(result.mean_error, result.max_error);
+		ASSERT_GT(result.throughput, 0.0);
+		// with beta much smaller than the distances in the corpus the order is almost preserved
+		ASSERT_GT(result.recall, 0.9);
+	}
+
+	TYPED_TEST(CharacterizationTest, RecallDropsWithBeta)
+	{
+		Characterization<TypeParam> characterization(this->config);
+
+		auto precise = characterization.measure(1.0, 1000.0);
+		auto noisy	 = characterization.measure(1 << 14, 1000.0);
+
+		ASSERT_GE(noisy.recall, 0.0);
+		ASSERT_LT(noisy.recall, precise.recall);
+	}
+
+	TYPED_TEST(CharacterizationTest, Sweep)
+	{
+		Characterization<TypeParam> characterization(this->config);
+
+		std::vector<TypeParam> betas = {1.0, 16.0, 256.0};
+		std::vector<TypeParam> max_s = {10.0, 1000.0};
+
+		auto results = characterization.sweep(betas, max_s, 2);
+
+		ASSERT_EQ(betas.size() * max_s.size(), results.size());
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			ASSERT_EQ(betas[i / max_s.size()], results[i].beta);
+			ASSERT_EQ(max_s[i % max_s.size()], results[i].max_s);
+			ASSERT_GE(results[i].recall, 0.0);
+			ASSERT_LE(results[i].recall, 1.0);
+		}
+	}
+
+	TEST(ParetoFrontierTest, Dominated)
+	{
+		std::vector<CharacterizationResult> results = {
+			{"float", 1.0, 10.0, 0.1, 0.05, 0.9, 1000.0},
+			{"float", 4.0, 10.0, 0.2, 0.10, 0.8, 900.0},  // dominated by the first
+			{"double", 1.0, 10.0, 0.0, 0.01, 0.9, 500.0}, // more precise but slower
+			{"double", 4.0, 10.0, 0.0, 0.01, 0.9, 500.0}, // equal to the previous, neither dominates
+		};
+
+		auto frontier = pareto_frontier(results);
+
+		ASSERT_EQ(3uL, frontier.size());
+		ASSERT_EQ(1.0, frontier[0].beta);
+		ASSERT_EQ("double", frontier[1].type);
+		ASSERT_EQ("double", frontier[2].type);
+	}
+
+	TEST(ParetoFrontierTest, Empty)
+	{
+		ASSERT_TRUE(pareto_frontier({}).empty());
+	}
+
+	TEST(ParetoFrontierTest, Print)
+	{
+		std::stringstream output;
+		print_results(output, {{"float", 1.0, 10.0, 0.5, 0.25, 0.9, 1000.0}});
+
+		ASSERT_EQ("type,beta,max_s,max_error,mean_error,recall,throughput\nfloat,1,10,0.5,0.25,0.9000,1000\n", output.str());
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,301 @@
+#include "codec.hpp"
+#include "scheme.hpp"
+
+#include "gtest/gtest.h"
+#include <mutex>
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	template <typename TypeParam>
+	class CodecTest : public testing::Test
+	{
+		public:
+		const int dimensions = 8;
+		const int rows		 = 1000;
+
+		protected:
+		std::vector<TypeParam> ciphertexts;
+		std::vector<std::pair<ull, ull>> nonces;
+		std::vector<ull> ids;
+
+		CodecTest()
+		{
+			Scheme<TypeParam> scheme(1000.0);
+			auto key = scheme.keygen();
+
+			std::vector<TypeParam> message;
+			message.resize(dimensions);
+			ciphertexts.resize(rows * dimensions);
+			for (auto i = 0; i < rows; i++)
+			{
+				for (auto &&value : message)
+				{
+					value = -1000.0 + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * 2000.0;
+				}
+				nonces.push_back(scheme.encrypt(key, TO_ARRAY(message), dimensions, TO_ARRAY(ciphertexts) + i * dimensions));
+				ids.push_back(1000 + 3 * i);
+			}
+		}
+
+		void expect_equal(const TypeParam* ciphertexts, const std::pair<ull, ull>* nonces, const ull* ids, size_t first, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				ASSERT_EQ(this->ids[first + i], ids[i]);
+				ASSERT_EQ(this->nonces[first + i], nonces[i]);
+				for (auto j = 0; j < dimensions; j++)
+				{
+					// bitwise equal, the format is lossless
+					ASSERT_EQ(this->ciphertexts[(first + i) * dimensions + j], ciphertexts[i * dimensions + j]);
+				}
+			}
+		}
+	};
+
+	using testing::Types;
+
+	typedef Types<float, double> ValidVectorTypes;
+	TYPED_TEST_SUITE(CodecTest, ValidVectorTypes);
+
+	TYPED_TEST(CodecTest, Initialization)
+	{
+		ColumnarCodec<TypeParam> codec(this->dimensions);
+		EXPECT_THROW(ColumnarCodec<TypeParam>(0), Exception);
+		EXPECT_THROW(ColumnarCodec<TypeParam>(this->dimensions, 0), Exception);
+	}
+
+	TYPED_TEST(CodecTest, RoundTrip)
+	{
+		for (auto &&block_rows : {1uL, 7uL, 256uL, 1uL << 12})
+		{
+			ColumnarCodec<TypeParam> codec(this->dimensions, block_rows);
+			auto archive = codec.encode(TO_ARRAY(this->ciphertexts), TO_ARRAY(this->nonces), TO_ARRAY(this->ids), this->rows);
+
+			std::vector<TypeParam> ciphertexts(this->rows * this->dimensions);
+			std::vector<std::pair<ull, ull>> nonces(this->rows);
+			std::vector<ull> ids(this->rows);
+			codec.decode(archive, TO_ARRAY(ciphertexts), TO_ARRAY(nonces), TO_ARRAY(ids));
+
+			this->expect_equal(TO_ARRAY(ciphertexts), TO_ARRAY(nonces), TO_ARRAY(ids), 0, this->rows);
+		}
+	}
+
+	TYPED_TEST(CodecTest, Inspect)
+	{
+		ColumnarCodec<TypeParam> codec(this->dimensions, 300);
+		auto archive = codec.encode(TO_ARRAY(this->ciphertexts), TO_ARRAY(this->nonces), TO_ARRAY(this->ids), this->rows);
+
+		auto info = ColumnarCodec<TypeParam>::inspect(archive);
+		ASSERT_EQ((int)sizeof(TypeParam), info.value_size);
+		ASSERT_EQ(this->dimensions, info.dimensions);
+		ASSERT_EQ((size_t)this->rows, info.rows);
+		ASSERT_EQ(300uL, info.block_rows);
+		ASSERT_EQ(4uL, info.blocks);
+	}
+
+	TYPED_TEST(CodecTest, Compresses)
+	{
+		ColumnarCodec<TypeParam> codec(this->dimensions);
+		auto archive = codec.encode(TO_ARRAY(this->ciphertexts), TO_ARRAY(this->nonces), TO_ARRAY(this->ids), this->rows);
+
+		auto raw = this->rows * (this->dimensions * sizeof(TypeParam) + sizeof(std::pair<ull, ull>) + sizeof(ull));
+		ASSERT_LT(archive.size(), raw);
+	}
+
+	TYPED_TEST(CodecTest, Empty)
+	{
+		ColumnarCodec<TypeParam> codec(this->dimensions);
+		auto archive = codec.encode(nullptr, nullptr, nullptr, 0);
+
+		ASSERT_EQ(0uL, ColumnarCodec<TypeParam>::inspect(archive).blocks);
+		codec.decode(archive, nullptr, nullptr, nullptr);
+	}
+
+	TYPED_TEST(CodecTest, DecodeBlock)
+	{
+		ColumnarCodec<TypeParam> codec(this->dimensions, 300);
+		auto archive = codec.encode(TO_ARRAY(this->ciphertexts), TO_ARRAY(this->nonces), TO_ARRAY(this->ids), this->rows);
+
+		ArchiveBlock<TypeParam> block;
+		codec.decode_block(archive, 3, block);
+		ASSERT_EQ(900uL, block.first);
+		ASSERT_EQ(100uL, block.rows);
+		this->expect_equal(TO_ARRAY(block.ciphertexts), TO_ARRAY(block.nonces), TO_ARRAY(block.ids), block.first, block.rows);
+
+		EXPECT_THROW(codec.decode_block(archive, 4, block), Exception);
+	}
+
+	TYPED_TEST(CodecTest, ForEachBlock)
+	{
+		ColumnarCodec<TypeParam> codec(this->dimensions, 64);
+		auto archive = codec.encode(TO_ARRAY(this->ciphertexts), TO_ARRAY(this->nonces), TO_ARRAY(this->ids), this->rows);
+
+		std::mutex mutex;
+		size_t rows = 0;
+		codec.for_each_block(
+			archive,
+			[&](const ArchiveBlock<TypeParam>& block)
+			{
+				this->expect_equal(TO_ARRAY(block.ciphertexts), TO_ARRAY(block.nonces), TO_ARRAY(block.ids), block.first, block.rows);
+
+				std::lock_guard lock(mutex);
+				rows += block.rows;
+			});
+
+		ASSERT_EQ((size_t)this->rows, rows);
+	}
+
+	TYPED_TEST(CodecTest, Load)
+	{
+		ColumnarCodec<TypeParam> codec(this->dimensions, 64);
+		auto archive = codec.encode(TO_ARRAY(this->ciphertexts), TO_ARRAY(this->nonces), TO_ARRAY(this->ids), this->rows);
+
+		EncryptedStore<TypeParam> store(this->dimensions, 128);
+		codec.load(archive, store);
+		ASSERT_EQ((size_t)this->rows, store.size());
+
+		std::vector<TypeParam> ciphertext(this->dimensions);
+		std::pair<ull, ull> nonce;
+		for (auto i = 0; i < this->rows; i += 37)
+		{
+			ASSERT_TRUE(store.get(this->ids[i], TO_ARRAY(ciphertext), nonce));
+			this->expect_equal(TO_ARRAY(ciphertext), &nonce, &this->ids[i], i, 1);
+		}
+
+		EncryptedStore<TypeParam> other(this->dimensions + 1);
+		EXPECT_THROW(codec.load(archive, other), Exception);
+	}
+
+	TYPED_TEST(CodecTest, Mismatch)
+	{
+		ColumnarCodec<TypeParam> codec(this->dimensions);
+		auto archive = codec.encode(TO_ARRAY(this->ciphertexts), TO_ARRAY(this->nonces), TO_ARRAY(this->ids), this->rows);
+
+		std::vector<TypeParam> ciphertexts(this->rows * (this->dimensions + 1));
+		std::vector<std::pair<ull, ull>> nonces(this->rows);
+		std::vector<ull> ids(this->rows);
+		EXPECT_THROW(ColumnarCodec<TypeParam>(this->dimensions + 1).decode(archive, TO_ARRAY(ciphertexts), TO_ARRAY(nonces), TO_ARRAY(ids)), Exception);
+	}
+
+	TYPED_TEST(CodecTest, Corrupted)
+	{
+		ColumnarCodec<TypeParam> codec(this->dimensions);
+		auto archive = codec.encode(TO_ARRAY(this->ciphertexts), TO_ARRAY(this->nonces), TO_ARRAY(this->ids), this->rows);
+
+		std::vector<TypeParam> ciphertexts(this->rows * this->dimensions);
+		std::vector<std::pair<ull, ull>> nonces(this->rows);
+		std::vector<ull> ids(this->rows);
+
+		auto truncated = archive;
+		truncated.resize(archive.size() / 2);
+		EXPECT_THROW(codec.decode(truncated, TO_ARRAY(ciphertexts), TO_ARRAY(nonces), TO_ARRAY(ids)), Exception);
+
+		auto wrong = archive;
+		wrong[0]   = 'X';
+		EXPECT_THROW(ColumnarCodec<TypeParam>::inspect(wrong), Exception);
+
+		EXPECT_THROW(ColumnarCodec<TypeParam>::inspect(bytes()), Exception);
+
+		// forged headers: the counts are checked against the size of the archive before anything is allocated
+		auto forge = [&](uint64_t rows, uint64_t block_rows, uint64_t blocks, const std::vector<uint64_t>& offsets, size_t payload)
+		{
+			bytes forged = {'D', 'C', 'P', 'C', 1, sizeof(TypeParam)};
+			uint32_t dimensions = this->dimensions;
+			forged.insert(forged.end(), reinterpret_cast<byte*>(&dimensions), reinterpret_cast<byte*>(&dimensions) + sizeof(dimensions));
+			for (auto &&value : std::vector<uint64_t>{rows, block_rows, blocks})
+			{
+				forged.insert(forged.end(), reinterpret_cast<const byte*>(&value), reinterpret_cast<const byte*>(&value) + sizeof(value));
+			}
+			for (auto &&value : offsets)
+			{
+				forged.insert(forged.end(), reinterpret_cast<const byte*>(&value), reinterpret_cast<const byte*>(&value) + sizeof(value));
+			}
+			forged.resize(forged.size() + payload);
+			return forged;
+		};
+
+		EXPECT_THROW(ColumnarCodec<TypeParam>::inspect(forge(1uLL << 62, 1, 1uLL << 62, {}, 0)), Exception);
+		EXPECT_THROW(ColumnarCodec<TypeParam>::inspect(forge(1000000000, 1, 1000000000, {0}, 0)), Exception);
+		EXPECT_THROW(ColumnarCodec<TypeParam>::inspect(forge(~0uLL, 2, 1uLL << 63, {}, 0)), Exception);
+
+		// a well-formed header whose only block claims far more rows than its bytes can hold
+		auto bomb = forge(1uLL << 40, 1uLL << 40, 1, {0, 8}, 8);
+		ASSERT_EQ(1u, ColumnarCodec<TypeParam>::inspect(bomb).blocks);
+		ArchiveBlock<TypeParam> block;
+		EXPECT_THROW(codec.decode_block(bomb, 0, block), Exception);
+		EXPECT_THROW(codec.for_each_block(bomb, [](const ArchiveBlock<TypeParam>&) {}), Exception);
+	}
+
+	TEST(PlaneTest, RoundTrip)
+	{
+		std::vector<bytes> planes = {
+			bytes(),
+			bytes(100, 0x42),
+			bytes(1, 0x13),
+		};
+
+		// skewed: mostly a few values
+		bytes skewed(10000);
+		for (auto &&value : skewed)
+		{
+			value = rand() % 10 == 0 ? rand() % 256 : rand() % 4;
+		}
+		planes.push_back(skewed);
+
+		// uniform: incompressible
+		bytes uniform(10000);
+		for (auto &&value : uniform)
+		{
+			value = rand() % 256;
+		}
+		planes.push_back(uniform);
+
+		for (auto &&plane : planes)
+		{
+			bytes encoded;
+			encode_plane(plane.data(), plane.size(), encoded);
+			encoded.push_back(0xAB); // whatever follows is not consumed
+
+			bytes decoded(plane.size());
+			ASSERT_EQ(encoded.size() - 1, decode_plane(encoded.data(), encoded.size(), decoded.data(), decoded.size()));
+			ASSERT_EQ(plane, decoded);
+		}
+	}
+
+	TEST(PlaneTest, Sizes)
+	{
+		bytes constant(1000, 7);
+		bytes encoded;
+		encode_plane(constant.data(), constant.size(), encoded);
+		ASSERT_EQ(2uL, encoded.size());
+
+		bytes skewed(10000);
+		for (auto &&value : skewed)
+		{
+			value = rand() % 4;
+		}
+		encoded.clear();
+		encode_plane(skewed.data(), skewed.size(), encoded);
+		ASSERT_LT(encoded.size(), skewed.size() / 3);
+
+		bytes uniform(10000);
+		for (auto &&value : uniform)
+		{
+			value = rand() % 256;
+		}
+		encoded.clear();
+		encode_plane(uniform.data(), uniform.size(), encoded);
+		ASSERT_EQ(uniform.size() + 1, encoded.size());
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,259 @@
+#include "batch.hpp"
+#include "codec.hpp"
+#include "kmeans.hpp"
+#include "scheme.hpp"
+
+#include "gtest/gtest.h"
+
+#include <map>
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	template <typename TypeParam>
+	class KMeansTest : public testing::Test
+	{
+		public:
+		const int dimensions = 20;
+		const int rows		 = 600;
+		const int clusters	 = 6;
+
+		protected:
+		Scheme<TypeParam> scheme = Scheme<TypeParam>(1.0);
+		DCPE::key<TypeParam> key;
+
+		std::vector<TypeParam> messages;
+		std::vector<int> truth;
+
+		std::unique_ptr<CiphertextBatch<TypeParam>> plaintexts;
+		std::unique_ptr<CiphertextBatch<TypeParam>> ciphertexts;
+
+		KMeansTest()
+		{
+			key = scheme.keygen();
+
+			// points around far apart centers, in random order
+			std::vector<TypeParam> centers(clusters * dimensions);
+			for (auto &&value : centers)
+			{
+				value = -1000.0 + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * 2000.0;
+			}
+			messages.resize(rows * dimensions);
+			for (auto i = 0; i < rows; i++)
+			{
+				truth.push_back(rand() % clusters);
+				for (auto j = 0; j < dimensions; j++)
+				{
+					messages[i * dimensions + j] = centers[truth[i] * dimensions + j] + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * 50.0;
+				}
+			}
+
+			plaintexts = std::make_unique<CiphertextBatch<TypeParam>>(rows, dimensions);
+			for (auto i = 0; i < rows; i++)
+			{
+				std::copy(TO_ARRAY(messages) + i * dimensions, TO_ARRAY(messages) + (i + 1) * dimensions, plaintexts->row(i));
+			}
+
+			ciphertexts = std::make_unique<CiphertextBatch<TypeParam>>(rows, dimensions);
+			encrypt_batch(scheme, key, TO_ARRAY(messages), ciphertexts->view());
+		}
+
+		/**
+		 * @brief the fraction of rows whose label's majority true cluster is their own
+		 */
+		double purity(const StreamingKMeans<TypeParam>& kmeans, const CiphertextSlice<TypeParam>& batch)
+		{
+			std::vector<int> labels(batch.size());
+			kmeans.assign(batch, TO_ARRAY(labels));
+
+			std::map<int, std::map<int, int>> votes;
+			for (size_t i = 0; i < batch.size(); i++)
+			{
+				votes[labels[i]][truth[i]]++;
+			}
+			auto correct = 0;
+			for (auto &&[label, counts] : votes)
+			{
+				auto best = 0;
+				for (auto &&[cluster, count] : counts)
+				{
+					best = std::max(best, count);
+				}
+				correct += best;
+			}
+			return (double)correct / batch.size();
+		}
+	};
+
+	using testing::Types;
+
+	typedef Types<float, double> ValidVectorTypes;
+	TYPED_TEST_SUITE(KMeansTest, ValidVectorTypes);
+
+	TYPED_TEST(KMeansTest, InvalidParameters)
+	{
+		EXPECT_THROW(StreamingKMeans<TypeParam>(0, this->dimensions), Exception);
+		EXPECT_THROW(StreamingKMeans<TypeParam>(4, 0), Exception);
+
+		StreamingKMeans<TypeParam> kmeans(this->clusters, this->dimensions);
+		EXPECT_THROW(kmeans.update(this->ciphertexts->slice(0, this->clusters - 1)), Exception);
+		EXPECT_THROW(kmeans.update(TO_ARRAY(this->messages), this->rows, 0), Exception);
+		EXPECT_THROW(kmeans.centroid(this->clusters), Exception);
+		EXPECT_THROW(kmeans.count(-1), Exception);
+
+		CiphertextBatch<TypeParam> other(10, this->dimensions + 1);
+		EXPECT_THROW(kmeans.update(other.view()), Exception);
+		std::vector<int> labels(10);
+		EXPECT_THROW(kmeans.assign(other.view(), TO_ARRAY(labels)), Exception);
+	}
+
+	TYPED_TEST(KMeansTest, SingleClusterIsTheMean)
+	{
+		StreamingKMeans<TypeParam> kmeans(1, this->dimensions);
+		for (auto first = 0; first < this->rows; first += 100)
+		{
+			kmeans.update(this->plaintexts->slice(first, first + 100));
+		}
+
+		EXPECT_EQ((size_t)this->rows, kmeans.get_seen());
+		EXPECT_EQ((ull)this->rows, kmeans.count(0));
+		for (auto j = 0; j < this->dimensions; j++)
+		{
+			auto mean = 0.0;
+			for (auto i = 0; i < this->rows; i++)
+			{
+				mean += this->messages[i * this->dimensions + j];
+			}
+			mean /= this->rows;
+			EXPECT_NEAR(mean, kmeans.centroid(0)[j], 0.01);
+		}
+	}
+
+	TYPED_TEST(KMeansTest, PlaintextClusters)
+	{
+		StreamingKMeans<TypeParam> kmeans(this->clusters, this->dimensions);
+		for (auto first = 0; first < this->rows; first += 100)
+		{
+			kmeans.update(this->plaintexts->slice(first, first + 100));
+		}
+
+		EXPECT_LE(0.95, this->purity(kmeans, this->plaintexts->view()));
+	}
+
+	TYPED_TEST(KMeansTest, EncryptedClusters)
+	{
+		StreamingKMeans<TypeParam> kmeans(this->clusters, this->dimensions);
+		for (auto first = 0; first < this->rows; first += 100)
+		{
+			kmeans.update(this->ciphertexts->slice(first, first + 100));
+		}
+
+		EXPECT_LE(0.95, this->purity(kmeans, this->ciphertexts->view()));
+
+		auto total = 0uLL;
+		for (auto c = 0; c < this->clusters; c++)
+		{
+			total += kmeans.count(c);
+		}
+		EXPECT_EQ((ull)this->rows, total);
+	}
+
+	TYPED_TEST(KMeansTest, PaddingStaysZero)
+	{
+		StreamingKMeans<TypeParam> kmeans(this->clusters, this->dimensions);
+		kmeans.update(this->ciphertexts->view());
+
+		for (auto c = 0; c < this->clusters; c++)
+		{
+			for (auto j = (size_t)this->dimensions; j < this->ciphertexts->get_stride(); j++)
+			{
+				EXPECT_EQ(0.0, kmeans.centroid(c)[j]);
+			}
+		}
+	}
+
+	TYPED_TEST(KMeansTest, MoreClustersLowerInertia)
+	{
+		StreamingKMeans<TypeParam> one(1, this->dimensions);
+		StreamingKMeans<TypeParam> many(this->clusters, this->dimensions);
+		one.update(this->ciphertexts->view());
+		many.update(this->ciphertexts->view());
+
+		EXPECT_GT(one.inertia(this->ciphertexts->view()), many.inertia(this->ciphertexts->view()));
+	}
+
+	TYPED_TEST(KMeansTest, Deterministic)
+	{
+		StreamingKMeans<TypeParam> first(this->clusters, this->dimensions, 0x42);
+		StreamingKMeans<TypeParam> second(this->clusters, this->dimensions, 0x42);
+		for (auto from = 0; from < this->rows; from += 200)
+		{
+			first.update(this->ciphertexts->slice(from, from + 200));
+			second.update(this->ciphertexts->slice(from, from + 200), 1);
+		}
+
+		for (auto c = 0; c < this->clusters; c++)
+		{
+			for (auto j = 0; j < this->dimensions; j++)
+			{
+				EXPECT_EQ(first.centroid(c)[j], second.centroid(c)[j]);
+			}
+		}
+	}
+
+	TYPED_TEST(KMeansTest, ContiguousRows)
+	{
+		StreamingKMeans<TypeParam> padded(this->clusters, this->dimensions);
+		StreamingKMeans<TypeParam> contiguous(this->clusters, this->dimensions);
+		for (auto first = 0; first < this->rows; first += 150)
+		{
+			padded.update(this->plaintexts->slice(first, first + 150));
+		}
+		contiguous.update(TO_ARRAY(this->messages), this->rows, 150);
+
+		EXPECT_EQ(padded.get_seen(), contiguous.get_seen());
+		for (auto c = 0; c < this->clusters; c++)
+		{
+			EXPECT_EQ(padded.count(c), contiguous.count(c));
+			for (auto j = 0; j < this->dimensions; j++)
+			{
+				EXPECT_EQ(padded.centroid(c)[j], contiguous.centroid(c)[j]);
+			}
+		}
+	}
+
+	TYPED_TEST(KMeansTest, StreamFromArchive)
+	{
+		std::vector<TypeParam> values(this->rows * this->dimensions);
+		std::vector<ull> ids(this->rows);
+		for (auto i = 0; i < this->rows; i++)
+		{
+			std::copy(this->ciphertexts->row(i), this->ciphertexts->row(i) + this->dimensions, TO_ARRAY(values) + i * this->dimensions);
+			ids[i] = i;
+		}
+
+		ColumnarCodec<TypeParam> codec(this->dimensions, 100);
+		auto archive = codec.encode(TO_ARRAY(values), &this->ciphertexts->nonce(0), TO_ARRAY(ids), this->rows);
+
+		StreamingKMeans<TypeParam> kmeans(this->clusters, this->dimensions);
+		ArchiveBlock<TypeParam> block;
+		for (size_t index = 0; index < ColumnarCodec<TypeParam>::inspect(archive).blocks; index++)
+		{
+			codec.decode_block(archive, index, block);
+			kmeans.update(TO_ARRAY(block.ciphertexts), block.rows);
+		}
+
+		EXPECT_EQ((size_t)this->rows, kmeans.get_seen());
+		EXPECT_LE(0.95, this->purity(kmeans, this->ciphertexts->view()));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,200 @@
+#include "pool.hpp"
+#include "scheme.hpp"
+
+#include "gtest/gtest.h"
+
+#include <set>
+#include <thread>
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	template <typename TypeParam>
+	class PoolTest : public testing::Test
+	{
+		public:
+		const int dimensions = 8;
+
+		protected:
+		Scheme<TypeParam> scheme = Scheme<TypeParam>(1000.0);
+		DCPE::key<TypeParam> key;
+
+		std::vector<TypeParam> message;
+
+		PoolTest()
+		{
+			key = scheme.keygen();
+
+			message.resize(dimensions);
+			for (auto &&value : message)
+			{
+				value = -1000.0 + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * 2000.0;
+			}
+		}
+
+		void expect_encrypts(NoisePool<TypeParam>& pool)
+		{
+			std::vector<TypeParam> ciphertext(dimensions);
+			std::vector<TypeParam> decrypted(dimensions);
+
+			auto nonce = pool.encrypt(TO_ARRAY(message), TO_ARRAY(ciphertext));
+
+			// the ciphertext has to be exactly what Scheme::encrypt would produce with the same nonce
+			auto lambda_m = scheme.compute_lambda_m(key, nonce, dimensions);
+			for (auto i = 0; i < dimensions; i++)
+			{
+				EXPECT_EQ((TypeParam)(message[i] * std::get<2>(key) + lambda_m[i]), ciphertext[i]);
+			}
+
+			scheme.decrypt(key, TO_ARRAY(ciphertext), dimensions, nonce, TO_ARRAY(decrypted));
+			for (auto i = 0; i < dimensions; i++)
+			{
+				EXPECT_NEAR(message[i], decrypted[i], 0.01);
+			}
+		}
+	};
+
+	using testing::Types;
+
+	typedef Types<float, double> ValidVectorTypes;
+	TYPED_TEST_SUITE(PoolTest, ValidVectorTypes);
+
+	TYPED_TEST(PoolTest, Initialization)
+	{
+		NoisePool<TypeParam> pool(this->scheme, this->key, this->dimensions, 16, 4, 16, 0);
+
+		ASSERT_EQ(0uL, pool.available());
+		ASSERT_EQ(0uL, pool.get_hits());
+		ASSERT_EQ(0uL, pool.get_misses());
+	}
+
+	TYPED_TEST(PoolTest, InvalidParameters)
+	{
+		EXPECT_THROW(NoisePool<TypeParam>(this->scheme, this->key, 0), Exception);
+		EXPECT_THROW(NoisePool<TypeParam>(this->scheme, this->key, this->dimensions, 0), Exception);
+		EXPECT_THROW(NoisePool<TypeParam>(this->scheme, this->key, this->dimensions, 16, 8, 4), Exception);
+		EXPECT_THROW(NoisePool<TypeParam>(this->scheme, this->key, this->dimensions, 16, 4, 32), Exception);
+	}
+
+	TYPED_TEST(PoolTest, Fill)
+	{
+		NoisePool<TypeParam> pool(this->scheme, this->key, this->dimensions, 16, 4, 16, 0);
+
+		pool.fill();
+		ASSERT_EQ(16uL, pool.available());
+
+		// a full pool stays full
+		pool.fill();
+		ASSERT_EQ(16uL, pool.available());
+	}
+
+	TYPED_TEST(PoolTest, EncryptFromPool)
+	{
+		NoisePool<TypeParam> pool(this->scheme, this->key, this->dimensions, 16, 4, 16, 0);
+		pool.fill();
+
+		for (auto i = 0; i < 16; i++)
+		{
+			this->expect_encrypts(pool);
+		}
+
+		EXPECT_EQ(16uL, pool.get_hits());
+		EXPECT_EQ(0uL, pool.get_misses());
+		EXPECT_EQ(0uL, pool.available());
+	}
+
+	TYPED_TEST(PoolTest, EncryptOnDemand)
+	{
+		NoisePool<TypeParam> pool(this->scheme, this->key, this->dimensions, 16, 4, 16, 0);
+
+		for (auto i = 0; i < 4; i++)
+		{
+			this->expect_encrypts(pool);
+		}
+
+		EXPECT_EQ(0uL, pool.get_hits());
+		EXPECT_EQ(4uL, pool.get_misses());
+	}
+
+	TYPED_TEST(PoolTest, NoncesAreUnique)
+	{
+		NoisePool<TypeParam> pool(this->scheme, this->key, this->dimensions, 16, 4, 16, 0);
+		pool.fill();
+
+		std::vector<TypeParam> ciphertext(this->dimensions);
+		std::set<std::pair<ull, ull>> nonces;
+		for (auto i = 0; i < 32; i++)
+		{
+			nonces.insert(pool.encrypt(TO_ARRAY(this->message), TO_ARRAY(ciphertext)));
+		}
+
+		EXPECT_EQ(32uL, nonces.size());
+	}
+
+	TYPED_TEST(PoolTest, RefillsInBackground)
+	{
+		NoisePool<TypeParam> pool(this->scheme, this->key, this->dimensions, 16, 4, 12, 2);
+		pool.fill();
+
+		// drop below the low watermark
+		std::vector<TypeParam> ciphertext(this->dimensions);
+		for (auto i = 0; i < 13; i++)
+		{
+			pool.encrypt(TO_ARRAY(this->message), TO_ARRAY(ciphertext));
+		}
+
+		for (auto i = 0; i < 1000 && pool.available() < 12; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		EXPECT_LE(12uL, pool.available());
+	}
+
+	TYPED_TEST(PoolTest, StopsAtHighWatermark)
+	{
+		NoisePool<TypeParam> pool(this->scheme, this->key, this->dimensions, 16, 4, 8, 1);
+
+		// a miss starts the refill, which stops at the high watermark, not the capacity
+		std::vector<TypeParam> ciphertext(this->dimensions);
+		pool.encrypt(TO_ARRAY(this->message), TO_ARRAY(ciphertext));
+
+		for (auto i = 0; i < 1000 && pool.available() < 8; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		EXPECT_EQ(8uL, pool.available());
+	}
+
+	TYPED_TEST(PoolTest, ConcurrentEncrypt)
+	{
+		NoisePool<TypeParam> pool(this->scheme, this->key, this->dimensions, 16, 4, 16, 2);
+
+		std::vector<std::thread> threads;
+		for (auto t = 0; t < 4; t++)
+		{
+			threads.emplace_back([&]()
+								 {
+									 for (auto i = 0; i < 50; i++)
+									 {
+										 this->expect_encrypts(pool);
+									 } });
+		}
+		for (auto &&thread : threads)
+		{
+			thread.join();
+		}
+
+		EXPECT_EQ(200uL, pool.get_hits() + pool.get_misses());
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
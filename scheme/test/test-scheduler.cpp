@@ -0,0 +1,203 @@
+#include "scheduler.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <set>
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	TEST(SchedulerTest, Initialization)
+	{
+		Scheduler scheduler(3, false);
+		ASSERT_EQ(3u, scheduler.size());
+
+		Scheduler all;
+		ASSERT_LE(1u, all.size());
+	}
+
+	TEST(SchedulerTest, NodeOf)
+	{
+		Scheduler scheduler(2);
+
+		for (uint i = 0; i < scheduler.size(); i++)
+		{
+			ASSERT_LE(0, scheduler.node_of(i));
+		}
+		EXPECT_THROW(scheduler.node_of(2), Exception);
+	}
+
+	TEST(SchedulerTest, RunsAllTasks)
+	{
+		Scheduler scheduler(4, false);
+		std::atomic<int> count = 0;
+
+		TaskGroup group(scheduler);
+		for (auto i = 0; i < 1000; i++)
+		{
+			group.run([&]()
+					  { count++; });
+		}
+		group.wait();
+
+		ASSERT_EQ(1000, count);
+	}
+
+	TEST(SchedulerTest, WaitWithoutTasks)
+	{
+		Scheduler scheduler(1, false);
+		TaskGroup group(scheduler);
+		group.wait();
+	}
+
+	TEST(SchedulerTest, NestedGroups)
+	{
+		// more nested waits than workers, which only finishes if the waiting threads run tasks
+		Scheduler scheduler(2, false);
+		std::atomic<int> count = 0;
+
+		TaskGroup outer(scheduler);
+		for (auto i = 0; i < 8; i++)
+		{
+			outer.run(
+				[&]()
+				{
+					TaskGroup inner(scheduler);
+					for (auto j = 0; j < 8; j++)
+					{
+						inner.run([&]()
+								  { count++; });
+					}
+					inner.wait();
+				});
+		}
+		outer.wait();
+
+		ASSERT_EQ(64, count);
+	}
+
+	TEST(SchedulerTest, RethrowsException)
+	{
+		Scheduler scheduler(2, false);
+		std::atomic<int> count = 0;
+
+		TaskGroup group(scheduler);
+		for (auto i = 0; i < 10; i++)
+		{
+			group.run(
+				[&, i]()
+				{
+					count++;
+					if (i == 3)
+					{
+						throw Exception("boom");
+					}
+				});
+		}
+		EXPECT_THROW(group.wait(), Exception);
+		ASSERT_EQ(10, count);
+
+		// the exception is reported once
+		group.wait();
+	}
+
+	TEST(SchedulerTest, RunOneOutsideThePool)
+	{
+		Scheduler scheduler(1, false);
+		std::atomic<bool> started = false;
+		std::atomic<bool> release = false;
+		std::atomic<bool> ran	  = false;
+
+		// keep the only worker busy
+		TaskGroup group(scheduler);
+		group.run([&]()
+				  {
+					  started = true;
+					  while (!release)
+					  {
+						  std::this_thread::yield();
+					  }
+				  });
+		while (!started)
+		{
+			std::this_thread::yield();
+		}
+
+		scheduler.submit([&]()
+						 { ran = true; });
+		ASSERT_TRUE(scheduler.run_one());
+		ASSERT_TRUE(ran);
+		ASSERT_FALSE(scheduler.run_one());
+
+		release = true;
+	}
+
+	TEST(SchedulerTest, IdleWorkersSteal)
+	{
+		Scheduler scheduler(4, false);
+		std::mutex mutex;
+		std::set<std::thread::id> threads;
+
+		// all the tasks land in the deque of the worker that runs the outer task
+		TaskGroup outer(scheduler);
+		outer.run(
+			[&]()
+			{
+				TaskGroup inner(scheduler);
+				for (auto i = 0; i < 64; i++)
+				{
+					inner.run(
+						[&]()
+						{
+							std::this_thread::sleep_for(std::chrono::milliseconds(1));
+							std::lock_guard lock(mutex);
+							threads.insert(std::this_thread::get_id());
+						});
+				}
+				inner.wait();
+			});
+		outer.wait();
+
+		ASSERT_LT(1uL, threads.size());
+	}
+
+	TEST(SchedulerTest, DestructorRunsQueuedTasks)
+	{
+		std::atomic<int> count = 0;
+		{
+			Scheduler scheduler(2, false);
+			for (auto i = 0; i < 100; i++)
+			{
+				scheduler.submit([&]()
+								 { count++; });
+			}
+		}
+		ASSERT_EQ(100, count);
+	}
+
+	TEST(SchedulerTest, Global)
+	{
+		auto& scheduler = Scheduler::global();
+
+		ASSERT_EQ(&scheduler, &Scheduler::global());
+		ASSERT_LE(1u, scheduler.size());
+		EXPECT_THROW(Scheduler::configure_global(2), Exception);
+
+		std::atomic<int> count = 0;
+		TaskGroup group;
+		group.run([&]()
+				  { count++; });
+		group.wait();
+		ASSERT_EQ(1, count);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -2,6 +2,7 @@
 #include "utility.hpp"
 
 #include "gtest/gtest.h"
+#include <set>
 
 // change to run all tests from different seed
 const auto TEST_SEED = 0x13;
@@ -40,6 +41,59 @@ namespace DCPE
 		EXPECT_THROW({ this->scheme->set_max_s(-1.0); }, Exception);
 	}
 
+	TYPED_TEST(SchemeTest, CiphertextRadius)
+	{
+		key<TypeParam> key = {0, 0, 2.0};
+
+		ASSERT_NEAR(2.0 * (10.0 + this->beta / 2), this->scheme->ciphertext_radius(key, 10.0), 0.001);
+		ASSERT_NEAR(0.0, this->scheme->certain_radius(key, 10.0), 0.001);
+		ASSERT_NEAR(2.0 * (1000.0 - this->beta / 2), this->scheme->certain_radius(key, 1000.0), 0.001);
+
+		EXPECT_THROW(this->scheme->ciphertext_radius(key, -1.0), Exception);
+		EXPECT_THROW(this->scheme->certain_radius(key, -1.0), Exception);
+	}
+
+	TYPED_TEST(SchemeTest, KeygenBatch)
+	{
+		const auto n = 10000uL;
+
+		std::vector<key<TypeParam>> keys;
+		keys.resize(n);
+		this->scheme->keygen_batch(n, TO_ARRAY(keys), 3);
+
+		std::set<ull> first_parts;
+		auto sum = 0.0;
+		for (auto &&key : keys)
+		{
+			first_parts.insert(std::get<0>(key));
+			ASSERT_GT(std::get<2>(key), 0.0);
+			ASSERT_LE(std::get<2>(key), this->max_s);
+			sum += std::get<2>(key);
+		}
+
+		ASSERT_GT(first_parts.size(), n * 0.99);
+		ASSERT_NEAR(this->max_s / 2, sum / n, this->max_s * 0.05);
+
+		std::vector<TypeParam> message = {1.0, -2.0, 3.0}, ciphertext, decrypted;
+		ciphertext.resize(message.size());
+		decrypted.resize(message.size());
+		for (auto i = 0uL; i < n; i += n / 10)
+		{
+			auto nonce = this->scheme->encrypt(keys[i], TO_ARRAY(message), message.size(), TO_ARRAY(ciphertext));
+			this->scheme->decrypt(keys[i], TO_ARRAY(ciphertext), message.size(), nonce, TO_ARRAY(decrypted));
+			for (size_t j = 0; j < message.size(); j++)
+			{
+				ASSERT_NEAR(message[j], decrypted[j], 1.0);
+			}
+		}
+	}
+
+	TYPED_TEST(SchemeTest, KeygenBatchEmpty)
+	{
+		this->scheme->keygen_batch(0, nullptr);
+		SUCCEED();
+	}
+
 	TYPED_TEST(SchemeTest, EncryptDecrypt)
 	{
 		const auto runs	 = 1000;
@@ -80,6 +134,79 @@ namespace DCPE
 		}
 	}
 
+	TYPED_TEST(SchemeTest, EncryptQuantized)
+	{
+		const auto dimensions = 64;
+		const TypeParam scale = 0.5, offset = -3.0;
+		const auto error	  = 1.0;
+
+		std::vector<int8_t> signed_message;
+		std::vector<uint8_t> unsigned_message;
+		std::vector<half> half_message;
+		for (auto i = 0; i < dimensions; i++)
+		{
+			signed_message.push_back(rand() % 256 - 128);
+			unsigned_message.push_back(rand() % 256);
+			half_message.push_back(half((float)(rand() % 20000) / 10.0f - 1000.0f));
+		}
+
+		auto check = [&](auto& message)
+		{
+			auto key = this->scheme->keygen();
+
+			std::vector<TypeParam> ciphertext, decrypted;
+			ciphertext.resize(dimensions);
+			decrypted.resize(dimensions);
+
+			auto nonce = this->scheme->encrypt(key, TO_ARRAY(message), dimensions, TO_ARRAY(ciphertext), scale, offset);
+			this->scheme->decrypt(key, TO_ARRAY(ciphertext), dimensions, nonce, TO_ARRAY(decrypted));
+
+			for (auto i = 0; i < dimensions; i++)
+			{
+				ASSERT_NEAR(scale * static_cast<TypeParam>(message[i]) + offset, decrypted[i], error);
+			}
+		};
+
+		check(signed_message);
+		check(unsigned_message);
+		check(half_message);
+	}
+
+	TYPED_TEST(SchemeTest, EncryptQuantizedMatchesDequantized)
+	{
+		const auto dimensions = 16;
+		const TypeParam scale = 2.0, offset = 1.0;
+
+		std::vector<uint8_t> quantized;
+		std::vector<TypeParam> dequantized;
+		for (auto i = 0; i < dimensions; i++)
+		{
+			quantized.push_back(rand() % 256);
+			dequantized.push_back(scale * quantized.back() + offset);
+		}
+
+		auto key = this->scheme->keygen();
+		std::vector<TypeParam> fused, staged;
+		fused.resize(dimensions);
+		staged.resize(dimensions);
+
+		auto nonce		  = this->scheme->encrypt(key, TO_ARRAY(quantized), dimensions, TO_ARRAY(fused), scale, offset);
+		auto staged_nonce = this->scheme->encrypt(key, TO_ARRAY(dequantized), dimensions, TO_ARRAY(staged));
+
+		// both ciphertexts decrypt to the same vector, so their distance is within the noise radius of the two encryptions
+		std::vector<TypeParam> first, second;
+		first.resize(dimensions);
+		second.resize(dimensions);
+		this->scheme->decrypt(key, TO_ARRAY(fused), dimensions, nonce, TO_ARRAY(first));
+		this->scheme->decrypt(key, TO_ARRAY(staged), dimensions, staged_nonce, TO_ARRAY(second));
+		for (auto i = 0; i < dimensions; i++)
+		{
+			ASSERT_NEAR(dequantized[i], first[i], 1.0);
+			ASSERT_NEAR(second[i], first[i], 1.0);
+		}
+		ASSERT_LE(distance(fused, staged), std::get<2>(key) * this->beta / 2 * 1.001);
+	}
+
 	TYPED_TEST(SchemeTest, PreserveDistanceComparison)
 	{
 		const auto runs = 1000;
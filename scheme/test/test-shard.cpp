@@ -0,0 +1,308 @@
+#include "shard.hpp"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	enum class TransportKind
+	{
+		InProcess,
+		UnixSocketThread,
+		UnixSocketProcess
+	};
+
+	template <typename TypeParam>
+	class ShardTest : public testing::Test
+	{
+		public:
+		const int dimensions = 4;
+
+		protected:
+		std::vector<std::unique_ptr<ShardServer<TypeParam>>> servers;
+		std::vector<std::unique_ptr<ShardProcess<TypeParam>>> processes;
+
+		std::string socket_path(int shard)
+		{
+			return (boost::format("/tmp/dcpe-test-shard-%d-%d.sock") % getpid() % shard).str();
+		}
+
+		std::unique_ptr<ShardedStore<TypeParam>> make_store(TransportKind kind, int count)
+		{
+			std::vector<std::unique_ptr<Transport>> shards;
+			for (auto i = 0; i < count; i++)
+			{
+				switch (kind)
+				{
+					case TransportKind::InProcess:
+						shards.push_back(std::make_unique<InProcessTransport<TypeParam>>(dimensions, 8));
+						break;
+					case TransportKind::UnixSocketThread:
+						servers.push_back(std::make_unique<ShardServer<TypeParam>>(socket_path(i), dimensions, 8));
+						servers.back()->start();
+						shards.push_back(std::make_unique<UnixSocketTransport>(socket_path(i)));
+						break;
+					case TransportKind::UnixSocketProcess:
+						processes.push_back(std::make_unique<ShardProcess<TypeParam>>(socket_path(i), dimensions, 8));
+						shards.push_back(std::make_unique<UnixSocketTransport>(socket_path(i)));
+						break;
+				}
+			}
+			return std::make_unique<ShardedStore<TypeParam>>(dimensions, std::move(shards));
+		}
+
+		std::vector<TypeParam> get_random_vector()
+		{
+			std::vector<TypeParam> result;
+			result.resize(dimensions);
+			for (auto i = 0; i < dimensions; i++)
+			{
+				result[i] = -1000.0 + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * 2000.0;
+			}
+			return result;
+		}
+
+		void check_store(TransportKind kind, int count)
+		{
+			const auto k = 5;
+
+			auto store = make_store(kind, count);
+			EncryptedStore<TypeParam> reference(dimensions);
+
+			for (auto i = 0; i < 100; i++)
+			{
+				auto record = get_random_vector();
+				store->insert(i, TO_ARRAY(record), {i, i});
+				reference.insert(i, TO_ARRAY(record), {i, i});
+			}
+			for (auto i = 0; i < 100; i += 4)
+			{
+				ASSERT_TRUE(store->remove(i));
+				ASSERT_FALSE(store->remove(i));
+				reference.remove(i);
+			}
+
+			ASSERT_EQ(reference.size(), store->size());
+
+			for (auto run = 0; run < 20; run++)
+			{
+				auto query	  = get_random_vector();
+				auto expected = reference.search(TO_ARRAY(query), k);
+				auto actual	  = store->search(TO_ARRAY(query), k);
+
+				ASSERT_EQ(expected.size(), actual.size());
+				for (size_t i = 0; i < expected.size(); i++)
+				{
+					ASSERT_EQ(expected[i].id, actual[i].id);
+					ASSERT_EQ(expected[i].distance, actual[i].distance);
+				}
+			}
+
+			auto query = get_random_vector();
+			EXPECT_THROW({ store->search(TO_ARRAY(query), 0); }, Exception);
+			// the transports are still in sync after an error
+			ASSERT_EQ((size_t)k, store->search(TO_ARRAY(query), k).size());
+		}
+	};
+
+	using testing::Types;
+
+	typedef Types<float, double> ValidVectorTypes;
+	TYPED_TEST_SUITE(ShardTest, ValidVectorTypes);
+
+	TYPED_TEST(ShardTest, NoShards)
+	{
+		EXPECT_THROW({ ShardedStore<TypeParam> store(this->dimensions, {}); }, Exception);
+	}
+
+	TYPED_TEST(ShardTest, ShardOfIsBalanced)
+	{
+		const auto shards = 4;
+		auto store		  = this->make_store(TransportKind::InProcess, shards);
+
+		std::vector<int> counts(shards, 0);
+		for (ull id = 0; id < 4000; id++)
+		{
+			auto shard = store->shard_of(id);
+			ASSERT_LT(shard, (size_t)shards);
+			counts[shard]++;
+		}
+
+		for (auto &&count : counts)
+		{
+			ASSERT_NEAR(1000, count, 150);
+		}
+	}
+
+	TYPED_TEST(ShardTest, InProcess)
+	{
+		for (auto &&shards : {1, 3})
+		{
+			this->check_store(TransportKind::InProcess, shards);
+		}
+	}
+
+	TYPED_TEST(ShardTest, UnixSocketThread)
+	{
+		this->check_store(TransportKind::UnixSocketThread, 3);
+	}
+
+	TYPED_TEST(ShardTest, UnixSocketProcess)
+	{
+		this->check_store(TransportKind::UnixSocketProcess, 3);
+	}
+
+	TYPED_TEST(ShardTest, ConcurrentClients)
+	{
+		const auto k = 5;
+
+		for (auto &&kind : {TransportKind::InProcess, TransportKind::UnixSocketThread})
+		{
+			auto store = this->make_store(kind, 3);
+			EncryptedStore<TypeParam> reference(this->dimensions);
+			for (auto i = 0; i < 100; i++)
+			{
+				auto record = this->get_random_vector();
+				store->insert(i, TO_ARRAY(record), {i, i});
+				reference.insert(i, TO_ARRAY(record), {i, i});
+			}
+
+			std::vector<std::vector<TypeParam>> queries;
+			for (auto i = 0; i < 40; i++)
+			{
+				queries.push_back(this->get_random_vector());
+			}
+
+			// each client checks its own responses, so a response delivered to the wrong caller shows up as a mismatch
+			std::atomic<int> mismatches = 0;
+			std::vector<std::thread> clients;
+			for (auto client = 0; client < 4; client++)
+			{
+				clients.emplace_back(
+					[&, client]()
+					{
+						for (auto i = client; i < (int)queries.size(); i += 4)
+						{
+							auto expected = reference.search(TO_ARRAY(queries[i]), k);
+							auto actual	  = store->search(TO_ARRAY(queries[i]), k);
+							for (size_t j = 0; j < expected.size(); j++)
+							{
+								mismatches += actual.size() != expected.size() || actual[j].id != expected[j].id;
+							}
+							mismatches += store->remove(1000 + i);
+						}
+					});
+			}
+			for (auto &&client : clients)
+			{
+				client.join();
+			}
+
+			EXPECT_EQ(0, mismatches);
+			EXPECT_EQ(reference.size(), store->size());
+		}
+	}
+
+	TYPED_TEST(ShardTest, InProcessThreads)
+	{
+		EXPECT_THROW({ InProcessTransport<TypeParam> transport(this->dimensions, 8, 0); }, Exception);
+
+		std::vector<std::unique_ptr<Transport>> shards;
+		shards.push_back(std::make_unique<InProcessTransport<TypeParam>>(this->dimensions, 8, 4));
+		ShardedStore<TypeParam> store(this->dimensions, std::move(shards));
+
+		for (auto i = 0; i < 50; i++)
+		{
+			auto record = this->get_random_vector();
+			store.insert(i, TO_ARRAY(record), {i, i});
+		}
+		EXPECT_EQ(50u, store.size());
+
+		auto query = this->get_random_vector();
+		EXPECT_EQ(5u, store.search(TO_ARRAY(query), 5).size());
+	}
+
+	TYPED_TEST(ShardTest, WorkerRejectsMalformedRequests)
+	{
+		ShardWorker<TypeParam> worker(this->dimensions);
+
+		for (auto &&request : std::vector<bytes>{{}, {0xFF}, {1, 2, 3}})
+		{
+			auto response = worker.handle(request);
+			ASSERT_FALSE(response.empty());
+			ASSERT_NE(0, response[0]);
+		}
+	}
+
+	TYPED_TEST(ShardTest, ServerSurvivesBrokenFrames)
+	{
+		auto store = this->make_store(TransportKind::UnixSocketThread, 1);
+
+		auto record = this->get_random_vector();
+		store->insert(1, TO_ARRAY(record), {1, 1});
+
+		auto address = sockaddr_un{AF_UNIX};
+		std::strcpy(address.sun_path, this->socket_path(0).c_str());
+
+		// a length far over the limit, then a length with a truncated body
+		for (auto &&frame : std::vector<bytes>{{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F}, {0x10, 0, 0, 0, 0, 0, 0, 0, 1, 2}})
+		{
+			auto connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			ASSERT_EQ(0, ::connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+			ASSERT_EQ((ssize_t)frame.size(), ::send(connection, TO_ARRAY(frame), frame.size(), MSG_NOSIGNAL));
+			::shutdown(connection, SHUT_WR);
+
+			// the server closes the connection without answering
+			byte response;
+			EXPECT_EQ(0, ::recv(connection, &response, 1, 0));
+			::close(connection);
+		}
+
+		EXPECT_EQ(1u, store->size());
+		EXPECT_EQ(1u, store->search(TO_ARRAY(record), 1).size());
+	}
+
+	TYPED_TEST(ShardTest, ServerJoinsGoneClients)
+	{
+		auto store = this->make_store(TransportKind::UnixSocketThread, 1);
+
+		auto record = this->get_random_vector();
+		store->insert(1, TO_ARRAY(record), {1, 1});
+
+		// short-lived clients, the handlers that are done get joined whenever another client connects
+		for (auto i = 0; i < 100; i++)
+		{
+			UnixSocketTransport transport(this->socket_path(0));
+		}
+
+		// once the server catches up, a new client finds only the store's handler and its own
+		for (auto i = 0; i < 100 && this->servers[0]->handler_count() > 2; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			UnixSocketTransport transport(this->socket_path(0));
+		}
+		EXPECT_GE(2u, this->servers[0]->handler_count());
+		EXPECT_EQ(1u, store->search(TO_ARRAY(record), 1).size());
+	}
+
+	TYPED_TEST(ShardTest, ConnectTimeout)
+	{
+		EXPECT_THROW({ UnixSocketTransport transport(this->socket_path(99), 10); }, Exception);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,204 @@
+#include "batch.hpp"
+#include "scheme.hpp"
+#include "sketch.hpp"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+
+#include <set>
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	template <typename TypeParam>
+	class SketchTest : public testing::Test
+	{
+		public:
+		const int dimensions = 40;
+		const int rows		 = 500;
+		const int clusters	 = 10;
+
+		protected:
+		Scheme<TypeParam> scheme = Scheme<TypeParam>(1.0);
+		DCPE::key<TypeParam> key;
+
+		std::vector<TypeParam> messages;
+		std::unique_ptr<CiphertextBatch<TypeParam>> batch;
+
+		SketchTest()
+		{
+			key = scheme.keygen();
+
+			// points around a few far apart centers, so that nearest neighbors are well defined
+			std::vector<TypeParam> centers(clusters * dimensions);
+			for (auto &&value : centers)
+			{
+				value = -1000.0 + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * 2000.0;
+			}
+			messages.resize(rows * dimensions);
+			for (auto i = 0; i < rows; i++)
+			{
+				for (auto j = 0; j < dimensions; j++)
+				{
+					messages[i * dimensions + j] = centers[(i % clusters) * dimensions + j] + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * 100.0;
+				}
+			}
+
+			batch = std::make_unique<CiphertextBatch<TypeParam>>(rows, dimensions);
+			encrypt_batch(scheme, key, TO_ARRAY(messages), batch->view());
+		}
+
+		std::vector<Neighbor<TypeParam>> full_scan(const TypeParam* query, int k)
+		{
+			std::vector<Neighbor<TypeParam>> result;
+			for (auto i = 0; i < rows; i++)
+			{
+				result.push_back({(ull)i, squared_distance(batch->row(i), query, dimensions)});
+			}
+			std::sort(result.begin(), result.end());
+			result.resize(k);
+			return result;
+		}
+
+		double recall(SketchFilter<TypeParam>& filter, int k, size_t candidates)
+		{
+			auto found = 0;
+			for (auto q = 0; q < 20; q++)
+			{
+				auto query	  = batch->row(rand() % rows);
+				auto expected = full_scan(query, k);
+				auto actual	  = filter.search(query, k, candidates);
+
+				std::set<ull> ids;
+				for (auto &&neighbor : actual)
+				{
+					ids.insert(neighbor.id);
+				}
+				for (auto &&neighbor : expected)
+				{
+					found += ids.count(neighbor.id);
+				}
+			}
+			return (double)found / (20 * k);
+		}
+	};
+
+	using testing::Types;
+
+	typedef Types<float, double> ValidVectorTypes;
+	TYPED_TEST_SUITE(SketchTest, ValidVectorTypes);
+
+	TYPED_TEST(SketchTest, InvalidParameters)
+	{
+		EXPECT_THROW(SketchFilter<TypeParam>(this->batch->view(), SketchKind::Signs, 0), Exception);
+		EXPECT_THROW(SketchFilter<TypeParam>(this->batch->view(), SketchKind::Signs, 100), Exception);
+		EXPECT_THROW(SketchFilter<TypeParam>(this->batch->view(), SketchKind::Projections, -1), Exception);
+		EXPECT_NO_THROW(SketchFilter<TypeParam>(this->batch->view(), SketchKind::Projections, 100));
+
+		SketchFilter<TypeParam> filter(this->batch->view());
+		EXPECT_THROW(filter.search(this->batch->row(0), 0, 10), Exception);
+	}
+
+	TYPED_TEST(SketchTest, SketchBytes)
+	{
+		SketchFilter<TypeParam> signs(this->batch->view(), SketchKind::Signs, 128);
+		EXPECT_EQ(this->rows * 128uL / 8, signs.sketch_bytes());
+
+		SketchFilter<TypeParam> projections(this->batch->view(), SketchKind::Projections, 16);
+		EXPECT_EQ(this->rows * CiphertextBatch<TypeParam>::stride_for(16) * sizeof(TypeParam), projections.sketch_bytes());
+	}
+
+	TYPED_TEST(SketchTest, PrefilterCount)
+	{
+		for (auto &&kind : {SketchKind::Signs, SketchKind::Projections})
+		{
+			SketchFilter<TypeParam> filter(this->batch->view(), kind, 64);
+
+			for (auto &&candidates : {1uL, 17uL, 250uL, (size_t)this->rows, 10000uL})
+			{
+				auto result = filter.prefilter(this->batch->row(3), candidates);
+
+				EXPECT_EQ(std::min(candidates, (size_t)this->rows), result.size());
+				EXPECT_EQ(result.size(), std::set<size_t>(result.begin(), result.end()).size());
+			}
+			EXPECT_EQ(0uL, filter.prefilter(this->batch->row(3), 0).size());
+		}
+	}
+
+	TYPED_TEST(SketchTest, QueryIsItsOwnCandidate)
+	{
+		for (auto &&kind : {SketchKind::Signs, SketchKind::Projections})
+		{
+			SketchFilter<TypeParam> filter(this->batch->view(), kind, 64);
+
+			for (auto i = 0; i < this->rows; i += 50)
+			{
+				// the rows of a cluster may share a sketch, so ask for more candidates than a cluster has
+				auto result = filter.search(this->batch->row(i), 1, 60);
+
+				ASSERT_EQ(1uL, result.size());
+				EXPECT_EQ((ull)i, result[0].id);
+				EXPECT_EQ(0.0, result[0].distance);
+			}
+		}
+	}
+
+	TYPED_TEST(SketchTest, AllCandidatesIsFullScan)
+	{
+		for (auto &&kind : {SketchKind::Signs, SketchKind::Projections})
+		{
+			SketchFilter<TypeParam> filter(this->batch->view(), kind, 64);
+
+			auto query	  = this->batch->row(7);
+			auto expected = this->full_scan(query, 10);
+			auto actual	  = filter.search(query, 10, this->rows);
+
+			ASSERT_EQ(expected.size(), actual.size());
+			for (size_t i = 0; i < expected.size(); i++)
+			{
+				EXPECT_EQ(expected[i].id, actual[i].id);
+				EXPECT_EQ(expected[i].distance, actual[i].distance);
+			}
+		}
+	}
+
+	TYPED_TEST(SketchTest, ResultsSorted)
+	{
+		SketchFilter<TypeParam> filter(this->batch->view());
+
+		auto result = filter.search(this->batch->row(11), 20, 100);
+
+		ASSERT_EQ(20uL, result.size());
+		EXPECT_TRUE(std::is_sorted(result.begin(), result.end()));
+	}
+
+	TYPED_TEST(SketchTest, Recall)
+	{
+		// a cluster has 50 rows, so a prefilter that only finds the right cluster already has full recall
+		SketchFilter<TypeParam> signs(this->batch->view(), SketchKind::Signs, 256);
+		EXPECT_LE(0.9, this->recall(signs, 10, 100));
+
+		SketchFilter<TypeParam> projections(this->batch->view(), SketchKind::Projections, 16);
+		EXPECT_LE(0.9, this->recall(projections, 10, 100));
+	}
+
+	TYPED_TEST(SketchTest, Deterministic)
+	{
+		SketchFilter<TypeParam> first(this->batch->view(), SketchKind::Signs, 64, 0x42);
+		SketchFilter<TypeParam> second(this->batch->view(), SketchKind::Signs, 64, 0x42);
+
+		auto a = first.prefilter(this->batch->row(5), 30);
+		auto b = second.prefilter(this->batch->row(5), 30);
+		EXPECT_EQ(a, b);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
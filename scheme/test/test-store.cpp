@@ -0,0 +1,419 @@
+#include "scheme.hpp"
+#include "store.hpp"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <set>
+#include <thread>
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	template <typename TypeParam>
+	class StoreTest : public testing::Test
+	{
+		public:
+		const int dimensions = 4;
+
+		protected:
+		std::vector<TypeParam> get_random_vector(TypeParam min = -1000.0, TypeParam max = +1000.0)
+		{
+			std::vector<TypeParam> result;
+			result.resize(dimensions);
+			for (auto i = 0; i < dimensions; i++)
+			{
+				result[i] = min + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * (max - min);
+			}
+			return result;
+		}
+
+		std::vector<std::vector<TypeParam>> fill(EncryptedStore<TypeParam>& store, int count)
+		{
+			std::vector<std::vector<TypeParam>> records;
+			for (auto i = 0; i < count; i++)
+			{
+				records.push_back(get_random_vector());
+				store.insert(i, TO_ARRAY(records.back()), {i, i});
+			}
+			return records;
+		}
+
+		std::vector<ull> brute_force(const std::vector<std::vector<TypeParam>>& records, const std::vector<bool>& removed, const std::vector<TypeParam>& query, int k)
+		{
+			std::vector<Neighbor<TypeParam>> all;
+			for (size_t i = 0; i < records.size(); i++)
+			{
+				if (!removed[i])
+				{
+					all.push_back({i, squared_distance(TO_ARRAY(records[i]), TO_ARRAY(query), dimensions)});
+				}
+			}
+			std::sort(all.begin(), all.end());
+
+			std::vector<ull> ids;
+			for (auto i = 0; i < k && i < (int)all.size(); i++)
+			{
+				ids.push_back(all[i].id);
+			}
+			return ids;
+		}
+
+		std::vector<ull> ids(const std::vector<Neighbor<TypeParam>>& neighbors)
+		{
+			std::vector<ull> ids;
+			for (auto &&neighbor : neighbors)
+			{
+				ids.push_back(neighbor.id);
+			}
+			return ids;
+		}
+	};
+
+	using testing::Types;
+
+	typedef Types<float, double> ValidVectorTypes;
+	TYPED_TEST_SUITE(StoreTest, ValidVectorTypes);
+
+	TYPED_TEST(StoreTest, Initialization)
+	{
+		EncryptedStore<TypeParam> store(this->dimensions);
+
+		ASSERT_EQ(0uL, store.size());
+		ASSERT_EQ(1uL, store.segments());
+		ASSERT_EQ(this->dimensions, store.get_dimensions());
+	}
+
+	TYPED_TEST(StoreTest, InvalidArguments)
+	{
+		EXPECT_THROW({ EncryptedStore<TypeParam> store(0); }, Exception);
+		EXPECT_THROW({ EncryptedStore<TypeParam> store(this->dimensions, 0); }, Exception);
+		EXPECT_THROW({ EncryptedStore<TypeParam> store(this->dimensions, 16, 1.5); }, Exception);
+
+		EncryptedStore<TypeParam> store(this->dimensions);
+		auto query = this->get_random_vector();
+		EXPECT_THROW({ store.search(TO_ARRAY(query), 0); }, Exception);
+	}
+
+	TYPED_TEST(StoreTest, InsertGet)
+	{
+		EncryptedStore<TypeParam> store(this->dimensions, 4);
+		auto records = this->fill(store, 10);
+
+		ASSERT_EQ(10uL, store.size());
+		ASSERT_EQ(3uL, store.segments());
+
+		std::vector<TypeParam> ciphertext;
+		ciphertext.resize(this->dimensions);
+		std::pair<ull, ull> nonce;
+		for (auto i = 0; i < 10; i++)
+		{
+			ASSERT_TRUE(store.get(i, TO_ARRAY(ciphertext), nonce));
+			ASSERT_EQ(records[i], ciphertext);
+			ASSERT_EQ(std::make_pair((ull)i, (ull)i), nonce);
+		}
+
+		ASSERT_FALSE(store.get(10, TO_ARRAY(ciphertext), nonce));
+	}
+
+	TYPED_TEST(StoreTest, SearchAcrossSegments)
+	{
+		const auto k = 5;
+
+		EncryptedStore<TypeParam> store(this->dimensions, 16);
+		auto records = this->fill(store, 100);
+		std::vector<bool> removed(records.size(), false);
+
+		for (auto run = 0; run < 20; run++)
+		{
+			auto query = this->get_random_vector();
+			ASSERT_EQ(this->brute_force(records, removed, query, k), this->ids(store.search(TO_ARRAY(query), k)));
+		}
+	}
+
+	TYPED_TEST(StoreTest, SearchFewerThanK)
+	{
+		EncryptedStore<TypeParam> store(this->dimensions);
+		this->fill(store, 3);
+
+		auto query = this->get_random_vector();
+		ASSERT_EQ(3uL, store.search(TO_ARRAY(query), 10).size());
+	}
+
+	TYPED_TEST(StoreTest, SearchRadius)
+	{
+		EncryptedStore<TypeParam> store(this->dimensions, 16);
+		auto records = this->fill(store, 100);
+		for (auto i = 0; i < 100; i += 3)
+		{
+			store.remove(i);
+		}
+
+		for (auto run = 0; run < 20; run++)
+		{
+			auto query	= this->get_random_vector();
+			auto radius = 200.0 + run * 50.0;
+
+			std::vector<ull> expected;
+			for (auto i = 0; i < 100; i++)
+			{
+				if (i % 3 != 0 && squared_distance(TO_ARRAY(records[i]), TO_ARRAY(query), this->dimensions) <= radius * radius)
+				{
+					expected.push_back(i);
+				}
+			}
+			std::sort(expected.begin(), expected.end());
+
+			for (auto &&block : {1, 3, this->dimensions, 100})
+			{
+				auto result = store.search_radius(TO_ARRAY(query), radius, block);
+				ASSERT_TRUE(std::is_sorted(result.begin(), result.end()));
+
+				auto ids = this->ids(result);
+				std::sort(ids.begin(), ids.end());
+				ASSERT_EQ(expected, ids);
+			}
+		}
+	}
+
+	TYPED_TEST(StoreTest, SearchRadiusInvalidArguments)
+	{
+		EncryptedStore<TypeParam> store(this->dimensions);
+		auto query = this->get_random_vector();
+
+		EXPECT_THROW(store.search_radius(TO_ARRAY(query), -1.0), Exception);
+		EXPECT_THROW(store.search_radius(TO_ARRAY(query), 1.0, 0), Exception);
+		ASSERT_TRUE(store.search_radius(TO_ARRAY(query), 1.0).empty());
+	}
+
+	TYPED_TEST(StoreTest, RemoveAndReplace)
+	{
+		const auto k = 5;
+
+		EncryptedStore<TypeParam> store(this->dimensions, 16, 0.25, false);
+		auto records = this->fill(store, 50);
+		std::vector<bool> removed(records.size(), false);
+
+		for (auto i = 0; i < 50; i += 3)
+		{
+			ASSERT_TRUE(store.remove(i));
+			ASSERT_FALSE(store.remove(i));
+			removed[i] = true;
+		}
+
+		records[1] = this->get_random_vector();
+		store.insert(1, TO_ARRAY(records[1]), {1, 1});
+
+		ASSERT_EQ(50uL - 17, store.size());
+		ASSERT_EQ(51uL, store.rows());
+
+		for (auto run = 0; run < 20; run++)
+		{
+			auto query = this->get_random_vector();
+			ASSERT_EQ(this->brute_force(records, removed, query, k), this->ids(store.search(TO_ARRAY(query), k)));
+		}
+	}
+
+	TYPED_TEST(StoreTest, Compact)
+	{
+		const auto k = 5;
+
+		EncryptedStore<TypeParam> store(this->dimensions, 16, 0.25, false);
+		auto records = this->fill(store, 100);
+		std::vector<bool> removed(records.size(), false);
+
+		for (auto i = 0; i < 100; i += 2)
+		{
+			store.remove(i);
+			removed[i] = true;
+		}
+
+		auto reclaimed = store.compact();
+
+		// the active segment (the last 4 records) is never compacted
+		ASSERT_EQ(48uL, reclaimed);
+		ASSERT_EQ(52uL, store.rows());
+		ASSERT_EQ(50uL, store.size());
+		ASSERT_EQ(0uL, store.compact());
+
+		for (auto run = 0; run < 20; run++)
+		{
+			auto query = this->get_random_vector();
+			ASSERT_EQ(this->brute_force(records, removed, query, k), this->ids(store.search(TO_ARRAY(query), k)));
+		}
+
+		std::vector<TypeParam> ciphertext;
+		ciphertext.resize(this->dimensions);
+		std::pair<ull, ull> nonce;
+		for (auto i = 1; i < 100; i += 2)
+		{
+			ASSERT_TRUE(store.get(i, TO_ARRAY(ciphertext), nonce));
+			ASSERT_EQ(records[i], ciphertext);
+		}
+
+		// records can still be removed after they were moved
+		ASSERT_TRUE(store.remove(1));
+		ASSERT_FALSE(store.get(1, TO_ARRAY(ciphertext), nonce));
+	}
+
+	TYPED_TEST(StoreTest, BackgroundCompaction)
+	{
+		EncryptedStore<TypeParam> store(this->dimensions, 16, 0.25, true);
+		this->fill(store, 100);
+
+		for (auto i = 0; i < 64; i++)
+		{
+			store.remove(i);
+		}
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (store.rows() > 36uL + 16 && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		ASSERT_LE(store.rows(), 36uL + 16);
+		ASSERT_EQ(36uL, store.size());
+	}
+
+	TYPED_TEST(StoreTest, ConcurrentReadersAndWriters)
+	{
+		const auto k = 5;
+
+		EncryptedStore<TypeParam> store(this->dimensions, 8, 0.25, true);
+		this->fill(store, 64);
+
+		std::atomic<bool> done = false;
+		std::vector<std::thread> readers;
+		for (auto i = 0; i < 2; i++)
+		{
+			readers.emplace_back(
+				[&, query = this->get_random_vector()]()
+				{
+					while (!done)
+					{
+						auto result = store.search(TO_ARRAY(query), k);
+						ASSERT_LE(result.size(), (size_t)k);
+						ASSERT_TRUE(std::is_sorted(result.begin(), result.end()));
+					}
+				});
+		}
+
+		for (auto i = 64; i < 1000; i++)
+		{
+			auto record = this->get_random_vector();
+			store.insert(i, TO_ARRAY(record), {i, i});
+			store.remove(i - 64);
+		}
+		store.compact();
+
+		done = true;
+		for (auto &&reader : readers)
+		{
+			reader.join();
+		}
+
+		ASSERT_EQ(64uL, store.size());
+	}
+
+	TYPED_TEST(StoreTest, EncryptedNearestNeighbor)
+	{
+		Scheme<TypeParam> scheme(1.0);
+		auto key = scheme.keygen();
+
+		EncryptedStore<TypeParam> store(this->dimensions, 16);
+		std::vector<TypeParam> ciphertext;
+		ciphertext.resize(this->dimensions);
+		std::vector<std::vector<TypeParam>> records;
+		for (auto i = 0; i < 50; i++)
+		{
+			records.push_back(this->get_random_vector());
+			auto nonce = scheme.encrypt(key, TO_ARRAY(records.back()), this->dimensions, TO_ARRAY(ciphertext));
+			store.insert(i, TO_ARRAY(ciphertext), nonce);
+		}
+
+		// a record is the nearest neighbor of itself, up to the approximation
+		for (auto i = 0; i < 50; i++)
+		{
+			scheme.encrypt(key, TO_ARRAY(records[i]), this->dimensions, TO_ARRAY(ciphertext));
+			ASSERT_EQ((ull)i, store.search(TO_ARRAY(ciphertext), 1)[0].id);
+		}
+	}
+
+	TYPED_TEST(StoreTest, EncryptedRadiusSearch)
+	{
+		const auto radius = 500.0;
+
+		Scheme<TypeParam> scheme(100.0);
+		auto key = scheme.keygen();
+
+		EncryptedStore<TypeParam> store(this->dimensions, 16);
+		std::vector<TypeParam> ciphertext;
+		ciphertext.resize(this->dimensions);
+		std::vector<std::vector<TypeParam>> records;
+		for (auto i = 0; i < 100; i++)
+		{
+			records.push_back(this->get_random_vector());
+			auto nonce = scheme.encrypt(key, TO_ARRAY(records.back()), this->dimensions, TO_ARRAY(ciphertext));
+			store.insert(i, TO_ARRAY(ciphertext), nonce);
+		}
+
+		for (auto run = 0; run < 20; run++)
+		{
+			auto query = this->get_random_vector();
+			scheme.encrypt(key, TO_ARRAY(query), this->dimensions, TO_ARRAY(ciphertext));
+
+			auto result	 = store.search_radius(TO_ARRAY(ciphertext), scheme.ciphertext_radius(key, radius));
+			auto certain = scheme.certain_radius(key, radius);
+
+			std::set<ull> found;
+			for (auto &&neighbor : result)
+			{
+				found.insert(neighbor.id);
+				if (neighbor.distance <= certain * certain)
+				{
+					ASSERT_LE(distance(records[neighbor.id], query), radius);
+				}
+			}
+
+			// no false negatives
+			for (auto i = 0; i < 100; i++)
+			{
+				if (distance(records[i], query) <= radius)
+				{
+					ASSERT_TRUE(found.count(i));
+				}
+			}
+		}
+	}
+
+	TEST(MergeNeighborsTest, Merge)
+	{
+		std::vector<std::vector<Neighbor<float>>> results = {
+			{{1, 1.0}, {3, 3.0}, {5, 5.0}},
+			{},
+			{{2, 2.0}, {4, 4.0}},
+		};
+
+		auto merged = merge_neighbors(results, 4);
+
+		ASSERT_EQ(4uL, merged.size());
+		for (auto i = 0; i < 4; i++)
+		{
+			ASSERT_EQ((ull)i + 1, merged[i].id);
+		}
+
+		ASSERT_EQ(5uL, merge_neighbors(results, 10).size());
+		ASSERT_TRUE(merge_neighbors(results, 0).empty());
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
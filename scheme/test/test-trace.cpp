@@ -0,0 +1,191 @@
+#include "scheme.hpp"
+#include "trace.hpp"
+
+#include "gtest/gtest.h"
+#include <set>
+#include <sstream>
+#include <thread>
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	class TraceTest : public testing::Test
+	{
+		protected:
+		TraceTest()
+		{
+			Tracer::clear();
+		}
+
+		std::vector<TraceEvent> named(const char* name)
+		{
+			std::vector<TraceEvent> result;
+			for (auto &&event : Tracer::events())
+			{
+				if (std::string(event.name) == name)
+				{
+					result.push_back(event);
+				}
+			}
+			return result;
+		}
+	};
+
+	TEST_F(TraceTest, Record)
+	{
+		Tracer::record("manual", 10, 20);
+
+		auto events = Tracer::events();
+		ASSERT_EQ(1uL, events.size());
+		ASSERT_STREQ("manual", events[0].name);
+		ASSERT_EQ(10uL, events[0].start);
+		ASSERT_EQ(20uL, events[0].end);
+	}
+
+	TEST_F(TraceTest, Scope)
+	{
+		auto before = Tracer::now();
+		{
+			TraceScope scope("scope");
+		}
+		auto after = Tracer::now();
+
+		auto events = named("scope");
+		ASSERT_EQ(1uL, events.size());
+		ASSERT_LE(before, events[0].start);
+		ASSERT_LE(events[0].start, events[0].end);
+		ASSERT_LE(events[0].end, after);
+	}
+
+	TEST_F(TraceTest, Clear)
+	{
+		Tracer::record("manual", 10, 20);
+		Tracer::clear();
+
+		ASSERT_TRUE(Tracer::events().empty());
+	}
+
+	TEST_F(TraceTest, RingBufferKeepsLatest)
+	{
+		const uint64_t total = TRACE_BUFFER_EVENTS + 100;
+		for (uint64_t i = 0; i < total; i++)
+		{
+			Tracer::record("manual", i, i + 1);
+		}
+
+		// the oldest slot is the one the next event goes to, so it is never reported
+		auto events = Tracer::events();
+		ASSERT_EQ((size_t)TRACE_BUFFER_EVENTS - 1, events.size());
+		ASSERT_EQ(total - TRACE_BUFFER_EVENTS + 1, events.front().start);
+		ASSERT_EQ(total - 1, events.back().start);
+	}
+
+	TEST_F(TraceTest, Threads)
+	{
+		std::vector<std::thread> threads;
+		for (auto t = 0; t < 4; t++)
+		{
+			threads.emplace_back([]()
+								 {
+									 for (auto i = 0; i < 100; i++)
+									 {
+										 TraceScope scope("worker");
+									 }
+								 });
+		}
+		for (auto &&thread : threads)
+		{
+			thread.join();
+		}
+
+		auto events = named("worker");
+		ASSERT_EQ(400uL, events.size());
+
+		std::set<uint32_t> ids;
+		for (auto &&event : events)
+		{
+			ids.insert(event.thread);
+		}
+		ASSERT_EQ(4uL, ids.size());
+	}
+
+	TEST_F(TraceTest, ReadWhileRecording)
+	{
+		std::atomic<bool> stop = false;
+		std::thread writer([&]()
+						   {
+							   while (!stop)
+							   {
+								   TraceScope scope("busy");
+							   }
+						   });
+
+		for (auto i = 0; i < 20; i++)
+		{
+			for (auto &&event : Tracer::events())
+			{
+				ASSERT_LE(event.start, event.end);
+			}
+		}
+
+		stop = true;
+		writer.join();
+	}
+
+	TEST_F(TraceTest, ChromeTrace)
+	{
+		Tracer::record("outer", 1000, 5500);
+		Tracer::record("with \"quotes\"", 2000, 2001);
+
+		std::stringstream out;
+		Tracer::write_chrome_trace(out);
+		auto json = out.str();
+
+		ASSERT_NE(std::string::npos, json.find("\"traceEvents\""));
+		ASSERT_NE(std::string::npos, json.find("\"name\":\"outer\",\"ph\":\"X\""));
+		ASSERT_NE(std::string::npos, json.find("\"ts\":1.000,\"dur\":4.500"));
+		ASSERT_NE(std::string::npos, json.find("with \\\"quotes\\\""));
+	}
+
+	TEST_F(TraceTest, FoldedStacks)
+	{
+		// outer [0, 100) contains inner [10, 40) which contains leaf [20, 25), and a second inner [50, 60)
+		Tracer::record("leaf", 20, 25);
+		Tracer::record("inner", 10, 40);
+		Tracer::record("inner", 50, 60);
+		Tracer::record("outer", 0, 100);
+		Tracer::record("other", 200, 300);
+
+		std::stringstream out;
+		Tracer::write_folded_stacks(out);
+
+		ASSERT_EQ("other 100\nouter 60\nouter;inner 35\nouter;inner;leaf 5\n", out.str());
+	}
+
+	TEST_F(TraceTest, InstrumentedScheme)
+	{
+		Scheme<double> scheme(1.0);
+		auto key = scheme.keygen();
+		std::vector<double> message = {1.0, 2.0, 3.0}, ciphertext(3);
+		scheme.encrypt(key, TO_ARRAY(message), 3, TO_ARRAY(ciphertext));
+
+#ifdef TRACING
+		ASSERT_EQ(1uL, named("Scheme::encrypt").size());
+		ASSERT_EQ(1uL, named("Scheme::compute_lambda_m").size());
+		ASSERT_EQ(1uL, named("normal_distribution").size());
+#else
+		// without TRACING the macros compile to nothing
+		ASSERT_TRUE(Tracer::events().empty());
+#endif
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -2,6 +2,7 @@
 #include "utility.hpp"
 
 #include "gtest/gtest.h"
+#include <atomic>
 #include <cmath>
 #include <numeric>
 
@@ -20,6 +21,50 @@ namespace DCPE
 	typedef Types<float, double> ValidVectorTypes;
 	TYPED_TEST_SUITE(UtilityTest, ValidVectorTypes);
 
+	TEST(HalfTest, RoundTrip)
+	{
+		for (auto &&value : {0.0f, -0.0f, 1.0f, -2.5f, 0.099975586f, 1024.0f, 65504.0f, 0x1.0p-14f, 0x1.0p-24f, -0x1.8p-20f})
+		{
+			ASSERT_EQ(value, (float)half(value));
+		}
+	}
+
+	TEST(HalfTest, Bits)
+	{
+		ASSERT_EQ(0x3C00, half(1.0f).bits);
+		ASSERT_EQ(0xC000, half(-2.0f).bits);
+		ASSERT_EQ(0x7BFF, half(65504.0f).bits);
+		ASSERT_EQ(0x0001, half(0x1.0p-24f).bits);
+		ASSERT_EQ(0x8000, half(-0.0f).bits);
+	}
+
+	TEST(HalfTest, Rounding)
+	{
+		// halfway between 1 and the next half (1 + 2^-10) rounds to even, just above it rounds up
+		ASSERT_EQ(1.0f, (float)half(1.0f + 0x1.0p-11f));
+		ASSERT_EQ(1.0f + 0x1.0p-10f, (float)half(1.0f + 0x1.0p-11f + 0x1.0p-20f));
+		ASSERT_EQ(1.0f + 0x1.0p-9f, (float)half(1.0f + 0x1.0p-10f + 0x1.0p-11f));
+		ASSERT_NEAR(3.14159f, (float)half(3.14159f), 0.002);
+	}
+
+	TEST(HalfTest, SpecialValues)
+	{
+		ASSERT_TRUE(std::isinf((float)half(1e6f)));
+		ASSERT_TRUE(std::isinf((float)half(-INFINITY)));
+		ASSERT_TRUE(std::isnan((float)half(NAN)));
+		ASSERT_EQ(0.0f, (float)half(1e-10f));
+	}
+
+	TEST(RandomTest, RandomBytes)
+	{
+		for (auto &&size : {0, 1, 16, 1000})
+		{
+			ASSERT_EQ((size_t)size, get_random_bytes(size).size());
+		}
+
+		ASSERT_NE(get_random_bytes(32), get_random_bytes(32));
+	}
+
 	TYPED_TEST(UtilityTest, UniformDifferentSeed)
 	{
 		const auto seed = 13uLL;
@@ -158,6 +203,56 @@ namespace DCPE
 		std::vector<TypeParam> b = {0.0, 2.0, 4.0, 5.0};
 		EXPECT_THROW({ distance<TypeParam>(a, b); }, Exception);
 	}
+
+	TYPED_TEST(UtilityTest, SquaredDistanceSimple)
+	{
+		std::vector<TypeParam> a = {1.0, 0.0, 5.0};
+		std::vector<TypeParam> b = {0.0, 2.0, 4.0};
+		auto result			= squared_distance<TypeParam>(TO_ARRAY(a), TO_ARRAY(b), 3);
+
+		ASSERT_NEAR(6.0, result, 0.0000001);
+	}
+
+	TEST(ParallelForTest, VisitsEachIndexOnce)
+	{
+		for (auto &&threads : {0u, 1u, 3u, 16u})
+		{
+			std::vector<std::atomic<int>> visits(100);
+			parallel_for(
+				0,
+				visits.size(),
+				[&](size_t i)
+				{
+					visits[i]++;
+				},
+				threads);
+
+			for (auto &&count : visits)
+			{
+				ASSERT_EQ(1, count);
+			}
+		}
+	}
+
+	TEST(ParallelForTest, EmptyRange)
+	{
+		parallel_for(5, 5, [](size_t) { FAIL(); });
+	}
+
+	TEST(ParallelForTest, RethrowsException)
+	{
+		EXPECT_THROW(
+			{
+				parallel_for(0, 10, [](size_t i)
+							 {
+								 if (i == 7)
+								 {
+									 throw Exception("boom");
+								 }
+							 });
+			},
+			Exception);
+	}
 }
 
 int main(int argc, char **argv)
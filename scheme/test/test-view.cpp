@@ -0,0 +1,219 @@
+#include "scheme.hpp"
+#include "view.hpp"
+
+#include "gtest/gtest.h"
+
+// change to run all tests from different seed
+const auto TEST_SEED = 0x13;
+
+namespace DCPE
+{
+	template <typename TypeParam>
+	class ViewTest : public testing::Test
+	{
+		public:
+		const int dimensions = 8;
+		const int rows		 = 64;
+
+		protected:
+		Scheme<TypeParam> scheme = Scheme<TypeParam>(1000.0);
+		DCPE::key<TypeParam> key;
+
+		std::vector<TypeParam> messages;
+		std::vector<TypeParam> ciphertexts;
+		std::vector<std::pair<ull, ull>> nonces;
+
+		ViewTest()
+		{
+			key = scheme.keygen();
+
+			messages.resize(rows * dimensions);
+			ciphertexts.resize(rows * dimensions);
+			for (auto &&value : messages)
+			{
+				value = -1000.0 + (static_cast<TypeParam>(rand()) / static_cast<double>(RAND_MAX)) * 2000.0;
+			}
+			for (auto i = 0; i < rows; i++)
+			{
+				nonces.push_back(scheme.encrypt(key, TO_ARRAY(messages) + i * dimensions, dimensions, TO_ARRAY(ciphertexts) + i * dimensions));
+			}
+		}
+
+		std::unique_ptr<DecryptedView<TypeParam>> view(size_t capacity = 1 << 10, size_t prefetch = 0)
+		{
+			return std::make_unique<DecryptedView<TypeParam>>(scheme, key, TO_ARRAY(ciphertexts), TO_ARRAY(nonces), rows, dimensions, capacity, prefetch);
+		}
+
+		void expect_row(const typename DecryptedView<TypeParam>::Row& row, int index)
+		{
+			ASSERT_EQ((size_t)dimensions, row->size());
+			for (auto i = 0; i < dimensions; i++)
+			{
+				EXPECT_NEAR(messages[index * dimensions + i], (*row)[i], 0.01);
+			}
+		}
+	};
+
+	using testing::Types;
+
+	typedef Types<float, double> ValidVectorTypes;
+	TYPED_TEST_SUITE(ViewTest, ValidVectorTypes);
+
+	TYPED_TEST(ViewTest, Initialization)
+	{
+		auto view = this->view();
+
+		ASSERT_EQ((size_t)this->rows, view->size());
+		ASSERT_EQ(0uL, view->get_hits());
+		ASSERT_EQ(0uL, view->get_misses());
+	}
+
+	TYPED_TEST(ViewTest, InvalidParameters)
+	{
+		EXPECT_THROW(this->view(0), Exception);
+		EXPECT_THROW(this->view(4, 4), Exception);
+		EXPECT_THROW(DecryptedView<TypeParam>(this->scheme, this->key, TO_ARRAY(this->ciphertexts), TO_ARRAY(this->nonces), this->rows, 0), Exception);
+	}
+
+	TYPED_TEST(ViewTest, MatchesDecrypt)
+	{
+		auto view = this->view();
+
+		std::vector<TypeParam> decrypted;
+		decrypted.resize(this->dimensions);
+		for (auto i = 0; i < this->rows; i++)
+		{
+			this->scheme.decrypt(this->key, TO_ARRAY(this->ciphertexts) + i * this->dimensions, this->dimensions, this->nonces[i], TO_ARRAY(decrypted));
+
+			auto row = view->get(i);
+			for (auto j = 0; j < this->dimensions; j++)
+			{
+				ASSERT_EQ(decrypted[j], (*row)[j]);
+			}
+		}
+	}
+
+	TYPED_TEST(ViewTest, At)
+	{
+		auto view = this->view();
+
+		for (auto i = 0; i < this->rows; i += 7)
+		{
+			for (auto j = 0; j < this->dimensions; j++)
+			{
+				EXPECT_NEAR(this->messages[i * this->dimensions + j], view->at(i, j), 0.01);
+			}
+		}
+	}
+
+	TYPED_TEST(ViewTest, OutOfRange)
+	{
+		auto view = this->view();
+
+		EXPECT_THROW(view->get(this->rows), Exception);
+		EXPECT_THROW(view->at(0, this->dimensions), Exception);
+		EXPECT_THROW(view->at(0, -1), Exception);
+		EXPECT_THROW(view->range(2, 1), Exception);
+		EXPECT_THROW(view->range(0, this->rows + 1), Exception);
+	}
+
+	TYPED_TEST(ViewTest, CacheHits)
+	{
+		auto view = this->view();
+
+		view->get(3);
+		view->get(3);
+		view->get(5);
+		view->get(3);
+
+		ASSERT_EQ(2uL, view->get_hits());
+		ASSERT_EQ(2uL, view->get_misses());
+	}
+
+	TYPED_TEST(ViewTest, LeastRecentlyUsedEviction)
+	{
+		auto view = this->view(2);
+
+		view->get(0);
+		view->get(1);
+		view->get(0); // 1 is now the least recently used
+		view->get(2); // evicts 1
+
+		ASSERT_EQ(1uL, view->get_hits());
+		ASSERT_EQ(3uL, view->get_misses());
+
+		view->get(0);
+		ASSERT_EQ(2uL, view->get_hits());
+
+		view->get(1);
+		ASSERT_EQ(4uL, view->get_misses());
+	}
+
+	TYPED_TEST(ViewTest, RowOutlivesEviction)
+	{
+		auto view = this->view(1);
+
+		auto row = view->get(0);
+		view->get(1);
+
+		this->expect_row(row, 0);
+	}
+
+	TYPED_TEST(ViewTest, Range)
+	{
+		auto view = this->view();
+
+		auto index = 10;
+		for (auto &&row : view->range(10, 20))
+		{
+			this->expect_row(row, index++);
+		}
+		ASSERT_EQ(20, index);
+		ASSERT_EQ(0uL, view->get_prefetched());
+	}
+
+	TYPED_TEST(ViewTest, EmptyRange)
+	{
+		auto view = this->view(8, 4);
+
+		for (auto &&row : view->range(5, 5))
+		{
+			FAIL() << "empty range yielded row of size " << row->size();
+		}
+	}
+
+	TYPED_TEST(ViewTest, RangeWithPrefetch)
+	{
+		auto view = this->view(16, 8);
+
+		auto index = 0;
+		for (auto &&row : view->range(0, this->rows))
+		{
+			this->expect_row(row, index++);
+		}
+		ASSERT_EQ(this->rows, index);
+
+		// every access is either a hit or a miss, prefetching only turns misses into hits
+		ASSERT_EQ((size_t)this->rows, view->get_hits() + view->get_misses());
+		ASSERT_LE(view->get_prefetched(), (size_t)this->rows);
+	}
+
+	TYPED_TEST(ViewTest, RandomAccessWithPrefetch)
+	{
+		auto view = this->view(16, 4);
+
+		for (auto i = 0; i < 200; i++)
+		{
+			auto index = rand() % this->rows;
+			this->expect_row(view->get(index), index);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	srand(TEST_SEED);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}